@@ -0,0 +1,292 @@
+// Solver Barnesa-Huta: drzewo ósemkowe budowane od nowa w każdym kroku, O(N log N)
+#pragma once
+
+#include <vector> // std::vector
+#include <cmath> // std::sqrt, std::fabs
+#include <algorithm> // std::max, std::min
+
+#include "body.h" // G, kDistanceToMeters
+#include "body_store.h" // BodyStore, FloatArray
+#include "direct_sum.h" // DirectAccelerationOf (porównanie dokładności)
+#include "thread_pool.h" // ThreadPool: równoległy obchód drzewa
+
+// Drzewo ósemkowe nad ciałami; węzły w płaskiej tablicy, dzieci węzła leżą obok siebie
+class Octree
+{
+public:
+    static const int kLeafSize = 8; // Maksymalna liczba ciał w liściu
+    static const int kMaxDepth = 32; // Ochrona przed nieskończonym podziałem (ciała w tym samym punkcie)
+
+    struct Node
+    {
+        float center[3]; // Środek sześcianu
+        float half; // Połowa długości boku
+        double com[3]; // Środek masy
+        double mass; // Masa całkowita
+        int firstChild; // Indeks pierwszego dziecka (-1 dla liścia)
+        int childCount; // Liczba niepustych dzieci
+        int begin, end; // Zakres ciał w tablicy order
+    };
+
+    std::vector<Node> nodes; // Węzły drzewa (korzeń pod indeksem 0)
+    std::vector<int> order; // Indeksy ciał posortowane wg węzłów
+
+    // Budowa drzewa z ciał biorących udział w oddziaływaniach
+    void Build(const BodyStore &bodies)
+    {
+        nodes.clear();
+        order.clear();
+        for (size_t i = 0; i < bodies.size(); ++i)
+        {
+            if (!bodies.initalizing[i])
+                order.push_back(int(i));
+        }
+        if (order.empty())
+            return;
+
+        // Sześcian obejmujący wszystkie ciała
+        float lo[3], hi[3];
+        float first[3] = {bodies.x[order[0]], bodies.y[order[0]], bodies.z[order[0]]};
+        for (int k = 0; k < 3; ++k)
+            lo[k] = hi[k] = first[k];
+        for (int idx : order)
+        {
+            float p[3] = {bodies.x[idx], bodies.y[idx], bodies.z[idx]};
+            for (int k = 0; k < 3; ++k)
+            {
+                lo[k] = std::min(lo[k], p[k]);
+                hi[k] = std::max(hi[k], p[k]);
+            }
+        }
+        float half = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            half = std::max(half, (hi[k] - lo[k]) * 0.5f);
+        half = half > 0.0f ? half * 1.001f : 1.0f; // Margines na błąd zaokrągleń
+
+        Node root;
+        for (int k = 0; k < 3; ++k)
+            root.center[k] = (lo[k] + hi[k]) * 0.5f;
+        root.half = half;
+        nodes.push_back(root);
+        scratch.resize(order.size());
+        BuildNode(bodies, 0, 0, int(order.size()), 0);
+    }
+
+    // Przyspieszenie ciała i z drzewa (wynik w acc[3]); theta to kąt otwarcia
+    void AccelerationOf(const BodyStore &bodies, size_t i, float theta, float acc[3]) const
+    {
+        acc[0] = acc[1] = acc[2] = 0.0f;
+        if (nodes.empty() || bodies.initalizing[i])
+            return;
+        const float p[3] = {bodies.x[i], bodies.y[i], bodies.z[i]};
+
+        double sum[3] = {0.0, 0.0, 0.0};
+        float theta2 = theta * theta;
+        int stack[8 * kMaxDepth + 8]; // Stos węzłów do odwiedzenia
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node &node = nodes[stack[--top]];
+            if (node.firstChild < 0) // Liść: suma bezpośrednia
+            {
+                for (int k = node.begin; k < node.end; ++k)
+                {
+                    int j = order[k];
+                    if (size_t(j) == i)
+                        continue;
+                    double dx = bodies.x[j] - p[0];
+                    double dy = bodies.y[j] - p[1];
+                    double dz = bodies.z[j] - p[2];
+                    double d2 = dx * dx + dy * dy + dz * dz;
+                    if (d2 > 0)
+                    {
+                        double w = bodies.mass[j] / (d2 * std::sqrt(d2)); // m / d^3
+                        sum[0] += dx * w;
+                        sum[1] += dy * w;
+                        sum[2] += dz * w;
+                    }
+                }
+                continue;
+            }
+
+            double dx = node.com[0] - p[0];
+            double dy = node.com[1] - p[1];
+            double dz = node.com[2] - p[2];
+            double d2 = dx * dx + dy * dy + dz * dz;
+            double size = 2.0 * node.half;
+            if (size * size < theta2 * d2 && !Contains(node, p)) // Węzeł dość daleko: monopol
+            {
+                double w = node.mass / (d2 * std::sqrt(d2)); // M / d^3
+                sum[0] += dx * w;
+                sum[1] += dy * w;
+                sum[2] += dz * w;
+            }
+            else // Otwórz węzeł
+            {
+                for (int ch = 0; ch < node.childCount; ++ch)
+                    stack[top++] = node.firstChild + ch;
+            }
+        }
+        double scale = G / (double(kDistanceToMeters) * kDistanceToMeters); // Odległości w km -> m
+        acc[0] = float(sum[0] * scale);
+        acc[1] = float(sum[1] * scale);
+        acc[2] = float(sum[2] * scale);
+    }
+
+    // Przyspieszenia wszystkich ciał (drzewo musi być zbudowane); ciała niezależne, więc równolegle
+    void Accelerations(const BodyStore &bodies, float theta, FloatArray &ax, FloatArray &ay, FloatArray &az, ThreadPool &pool = GlobalPool()) const
+    {
+        size_t n = bodies.size();
+        ax.resize(n);
+        ay.resize(n);
+        az.resize(n);
+        pool.ParallelFor(0, n, 256, [&](size_t i0, size_t i1)
+                         {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                float acc[3];
+                AccelerationOf(bodies, i, theta, acc);
+                ax[i] = acc[0];
+                ay[i] = acc[1];
+                az[i] = acc[2];
+            } });
+    }
+
+private:
+    std::vector<int> scratch; // Bufor pomocniczy do podziału na oktanty
+
+    static bool Contains(const Node &node, const float p[3])
+    {
+        return std::fabs(p[0] - node.center[0]) <= node.half &&
+               std::fabs(p[1] - node.center[1]) <= node.half &&
+               std::fabs(p[2] - node.center[2]) <= node.half;
+    }
+
+    // Rekurencyjny podział zakresu [begin, end) tablicy order na oktanty
+    void BuildNode(const BodyStore &bodies, int nodeIndex, int begin, int end, int depth)
+    {
+        nodes[nodeIndex].begin = begin;
+        nodes[nodeIndex].end = end;
+        nodes[nodeIndex].firstChild = -1;
+        nodes[nodeIndex].childCount = 0;
+
+        if (end - begin <= kLeafSize || depth >= kMaxDepth) // Liść
+        {
+            double mass = 0.0, com[3] = {0.0, 0.0, 0.0};
+            for (int k = begin; k < end; ++k)
+            {
+                int j = order[k];
+                mass += bodies.mass[j];
+                com[0] += double(bodies.mass[j]) * bodies.x[j];
+                com[1] += double(bodies.mass[j]) * bodies.y[j];
+                com[2] += double(bodies.mass[j]) * bodies.z[j];
+            }
+            SetMass(nodes[nodeIndex], mass, com, nodes[nodeIndex].center);
+            return;
+        }
+
+        // Sortowanie przez zliczanie do 8 oktantów
+        float center[3] = {nodes[nodeIndex].center[0], nodes[nodeIndex].center[1], nodes[nodeIndex].center[2]};
+        float half = nodes[nodeIndex].half;
+        int counts[8] = {0};
+        for (int k = begin; k < end; ++k)
+            ++counts[Octant(bodies, order[k], center)];
+        int offsets[9];
+        offsets[0] = begin;
+        for (int o = 0; o < 8; ++o)
+            offsets[o + 1] = offsets[o] + counts[o];
+        int fill[8];
+        for (int o = 0; o < 8; ++o)
+            fill[o] = offsets[o];
+        for (int k = begin; k < end; ++k)
+            scratch[fill[Octant(bodies, order[k], center)]++] = order[k];
+        std::copy(scratch.begin() + begin, scratch.begin() + end, order.begin() + begin);
+
+        // Dzieci węzła w jednym ciągłym bloku
+        int childCount = 0;
+        for (int o = 0; o < 8; ++o)
+            childCount += counts[o] > 0;
+        int firstChild = int(nodes.size());
+        nodes.resize(nodes.size() + childCount);
+        nodes[nodeIndex].firstChild = firstChild;
+        nodes[nodeIndex].childCount = childCount;
+
+        int child = firstChild;
+        for (int o = 0; o < 8; ++o)
+        {
+            if (counts[o] == 0)
+                continue;
+            Node &ch = nodes[child];
+            ch.half = half * 0.5f;
+            ch.center[0] = center[0] + ((o & 1) ? ch.half : -ch.half);
+            ch.center[1] = center[1] + ((o & 2) ? ch.half : -ch.half);
+            ch.center[2] = center[2] + ((o & 4) ? ch.half : -ch.half);
+            BuildNode(bodies, child, offsets[o], offsets[o + 1], depth + 1);
+            ++child;
+        }
+
+        // Masa i środek masy z dzieci
+        double mass = 0.0, com[3] = {0.0, 0.0, 0.0};
+        for (int ch = firstChild; ch < firstChild + childCount; ++ch)
+        {
+            mass += nodes[ch].mass;
+            for (int k = 0; k < 3; ++k)
+                com[k] += nodes[ch].mass * nodes[ch].com[k];
+        }
+        SetMass(nodes[nodeIndex], mass, com, center);
+    }
+
+    static int Octant(const BodyStore &bodies, int j, const float center[3])
+    {
+        return (bodies.x[j] > center[0] ? 1 : 0) | (bodies.y[j] > center[1] ? 2 : 0) | (bodies.z[j] > center[2] ? 4 : 0);
+    }
+
+    // Zapis masy i środka masy (dla masy zerowej środek geometryczny)
+    static void SetMass(Node &node, double mass, const double weighted[3], const float fallback[3])
+    {
+        node.mass = mass;
+        for (int k = 0; k < 3; ++k)
+            node.com[k] = mass > 0.0 ? weighted[k] / mass : fallback[k];
+    }
+};
+
+// Błąd względny przyspieszeń Barnesa-Huta w porównaniu z sumą bezpośrednią
+struct ForceError
+{
+    double mean = 0.0; // Średni błąd względny
+    double rms = 0.0; // Średnia kwadratowa błędu względnego
+    double max = 0.0; // Największy błąd względny
+    size_t samples = 0; // Liczba porównanych ciał
+};
+
+// Porównanie z sumą bezpośrednią na co najwyżej maxSamples ciałach (równomiernie wybranych)
+inline ForceError CompareBarnesHutToDirect(const BodyStore &bodies, float theta, size_t maxSamples = 1000)
+{
+    ForceError err;
+    Octree tree;
+    tree.Build(bodies);
+    size_t n = bodies.size();
+    size_t stride = std::max<size_t>(1, n / std::max<size_t>(1, maxSamples));
+    for (size_t i = 0; i < n; i += stride)
+    {
+        float direct[3], approx[3];
+        DirectAccelerationOf(bodies, i, direct);
+        tree.AccelerationOf(bodies, i, theta, approx);
+        double ref = std::sqrt(double(direct[0]) * direct[0] + double(direct[1]) * direct[1] + double(direct[2]) * direct[2]);
+        if (ref <= 0.0)
+            continue;
+        double ex = approx[0] - direct[0], ey = approx[1] - direct[1], ez = approx[2] - direct[2];
+        double rel = std::sqrt(ex * ex + ey * ey + ez * ez) / ref;
+        err.mean += rel;
+        err.rms += rel * rel;
+        err.max = std::max(err.max, rel);
+        ++err.samples;
+    }
+    if (err.samples > 0)
+    {
+        err.mean /= err.samples;
+        err.rms = std::sqrt(err.rms / err.samples);
+    }
+    return err;
+}
@@ -0,0 +1,376 @@
+// Mikrobenchmarki gorących ścieżek fizyki i siatki: przebieg po N = 10 .. 10^6, porównanie z zapisanym punktem odniesienia
+#include <vector> // std::vector
+#include <string> // std::string
+#include <map> // std::map: punkt odniesienia (nazwa, N) -> ns
+#include <fstream> // std::ifstream, std::ofstream
+#include <sstream> // std::istringstream
+#include <iostream> // std::cout
+#include <chrono> // std::chrono::steady_clock
+#include <functional> // std::function
+#include <algorithm> // std::min
+#include <cstdio> // std::printf
+#include <cstring> // std::strcmp
+#include <cstdlib> // std::atof, std::atoll
+
+#include "simulation.h" // World
+#include "direct_sum.h" // DirectAccelerations
+#include "barnes_hut.h" // Octree
+#include "particle_mesh.h" // ParticleMesh
+#include "collisions.h" // CollisionDetector
+#include "icosphere.h" // BuildIcosphere
+#include "spacetime_grid.h" // DeformGridCPU, AdaptiveGrid
+#include "initial_conditions.h" // GenerateBodies: powtarzalne zestawy ciał
+#include "profiler.h" // Czasy faz kroku
+#include "image_writer.h" // EncodePng: klatki renderowania offscreen
+#include "bvh.h" // BodyBvh: wybór ciał i zapytania przestrzenne
+
+// Ustawienia przebiegu (argumenty)
+struct BenchOptions
+{
+    size_t maxN = 1000000; // Największe N
+    double maxPairs = 2e8; // Limit par dla metod O(N^2) (większe N pominięte)
+    double minSeconds = 0.2; // Minimalny czas pomiaru jednej rundy
+    const char *only = nullptr; // Tylko benchmark o tej nazwie
+    const char *baseline = nullptr; // Porównanie z plikiem CSV
+    const char *saveBaseline = nullptr; // Zapis wyników jako nowy punkt odniesienia
+    double tolerance = 0.15; // Dopuszczalne spowolnienie względem punktu odniesienia
+};
+
+// Wynik jednego pomiaru
+struct BenchResult
+{
+    std::string name;
+    size_t n;
+    double secondsPerIteration;
+    double items; // Jednostek pracy na iterację (interakcje, ciała, wierzchołki, trójkąty)
+    const char *unit;
+
+    double NsPerItem() const
+    {
+        return secondsPerIteration * 1e9 / items;
+    }
+};
+
+// Najlepszy czas iteracji z trzech rund; runda powtarza fn, aż minie minSeconds.
+// Iteracja dłuższa niż kilka rund (duże N) mierzona tylko raz po rozgrzewce.
+double TimeIteration(const std::function<void()> &fn, double minSeconds)
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point warmup = Clock::now();
+    fn(); // Rozgrzewka: bufory, pamięć podręczna, wątki puli
+    int rounds = std::chrono::duration<double>(Clock::now() - warmup).count() > 5.0 * minSeconds ? 1 : 3;
+    double best = 1e300;
+    for (int round = 0; round < rounds; ++round)
+    {
+        long long iterations = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        do
+        {
+            fn();
+            ++iterations;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < minSeconds);
+        best = std::min(best, elapsed / double(iterations));
+    }
+    return best;
+}
+
+// Kula Plummera o N ciałach (ziarno stałe: te same dane w każdym przebiegu)
+BodyStore BenchBodies(size_t n)
+{
+    GeneratorConfig config;
+    config.kind = InitialConditions::Plummer;
+    config.count = n;
+    config.seed = 12345;
+    BodyStore bodies;
+    GenerateBodies(config, bodies);
+    return bodies;
+}
+
+std::map<std::pair<std::string, size_t>, double> LoadBaseline(const char *path)
+{
+    std::map<std::pair<std::string, size_t>, double> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#' || line.compare(0, 5, "name,") == 0)
+            continue;
+        std::istringstream fields(line);
+        std::string name, n, ns;
+        if (std::getline(fields, name, ',') && std::getline(fields, n, ',') && std::getline(fields, ns, ','))
+            baseline[{name, size_t(std::atoll(n.c_str()))}] = std::atof(ns.c_str());
+    }
+    return baseline;
+}
+
+int main(int argc, char **argv)
+{
+    // Argumenty: [--max-n N] [--max-pairs P] [--min-time S] [--quick] [--only NAME] [--threads N]
+    //            [--baseline F.csv] [--save-baseline F.csv] [--tolerance T]
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--max-n") == 0 && i + 1 < argc)
+            options.maxN = size_t(std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--max-pairs") == 0 && i + 1 < argc)
+            options.maxPairs = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+            options.minSeconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--quick") == 0)
+            options.minSeconds = 0.02;
+        else if (std::strcmp(argv[i], "--only") == 0 && i + 1 < argc)
+            options.only = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            GlobalPool().Resize(unsigned(std::atoi(argv[++i])));
+        else if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            options.baseline = argv[++i];
+        else if (std::strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc)
+            options.saveBaseline = argv[++i];
+        else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+            options.tolerance = std::atof(argv[++i]);
+    }
+    std::vector<size_t> sizes;
+    for (size_t n = 10; n <= options.maxN; n *= 10)
+        sizes.push_back(n);
+
+    std::cout << "Bench: simd " << SimdLevelName(BestSimdLevel()) << ", threads " << GlobalPool().size() << ", min time "
+              << options.minSeconds << " s" << std::endl;
+    std::map<std::pair<std::string, size_t>, double> baseline;
+    if (options.baseline)
+        baseline = LoadBaseline(options.baseline);
+
+    std::vector<BenchResult> results;
+    int regressions = 0;
+    auto report = [&](const std::string &name, size_t n, double seconds, double items, const char *unit)
+    {
+        BenchResult r{name, n, seconds, items, unit};
+        results.push_back(r);
+        std::printf("%-14s N %8zu  %10.4f ms/iter  %10.1f /s  %9.3f ns/%s", name.c_str(), n, seconds * 1e3, 1.0 / seconds,
+                    r.NsPerItem(), unit);
+        auto it = baseline.find({name, n});
+        if (it != baseline.end() && it->second > 0.0)
+        {
+            double change = r.NsPerItem() / it->second - 1.0;
+            bool regressed = change > options.tolerance;
+            regressions += regressed ? 1 : 0;
+            std::printf("  (baseline %.3f, %+.1f%%%s)", it->second, 100.0 * change, regressed ? " REGRESSION" : "");
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    };
+    auto enabled = [&](const char *name)
+    {
+        return !options.only || std::strcmp(options.only, name) == 0;
+    };
+    auto skip = [](const char *name, size_t n, const char *why)
+    {
+        std::printf("%-14s N %8zu  skipped (%s)\n", name, n, why);
+    };
+
+    for (size_t n : sizes)
+    {
+        BodyStore bodies = BenchBodies(n);
+        FloatArray ax(n), ay(n), az(n);
+        double pairs = double(n) * double(n - 1);
+
+        if (enabled("direct")) // Pętla sił par (suma bezpośrednia, najlepszy poziom SIMD)
+        {
+            if (pairs > options.maxPairs)
+                skip("direct", n, "O(N^2), see --max-pairs");
+            else
+                report("direct", n, TimeIteration([&]
+                                                  { DirectAccelerations(bodies, ax, ay, az); }, options.minSeconds),
+                       pairs, "pair");
+        }
+        if (enabled("barnes-hut")) // Budowa drzewa i siły (theta 0.5), na ciało
+        {
+            Octree tree;
+            report("barnes-hut", n, TimeIteration([&]
+                                                  {
+                tree.Build(bodies);
+                tree.Accelerations(bodies, 0.5f, ax, ay, az); }, options.minSeconds),
+                   double(n), "body");
+        }
+        if (enabled("particle-mesh")) // Siatka 64^3 (izolowana, bez części bliskiej): CIC, FFT, interpolacja
+        {
+            ParticleMesh mesh;
+            report("particle-mesh", n, TimeIteration([&]
+                                                     { mesh.Accelerations(bodies, ax, ay, az); }, options.minSeconds),
+                   double(n), "body");
+        }
+        if (enabled("collisions")) // Faza szeroka i wąska kolizji
+        {
+            CollisionDetector detector;
+            report("collisions", n, TimeIteration([&]
+                                                  { detector.FindContacts(bodies, GlobalPool()); }, options.minSeconds),
+                   double(n), "body");
+        }
+        if (enabled("bvh-refit")) // Refit granic BVH po kroku (budowa raz, poza pomiarem), na ciało
+        {
+            BodyBvh bvh;
+            bvh.Build(bodies);
+            report("bvh-refit", n, TimeIteration([&]
+                                                 { bvh.Refit(bodies); }, options.minSeconds),
+                   double(n), "body");
+        }
+        if (enabled("bvh-query")) // Wybór ciała: promień z daleka w ciało, 8 najbliższych sąsiadów i otoczenie 100 promieni
+        {
+            BodyBvh bvh;
+            bvh.Build(bodies);
+            const size_t queries = 256;
+            std::vector<BodyBvh::Neighbour> nearest;
+            std::vector<size_t> around;
+            report("bvh-query", n, TimeIteration([&]
+                                                 {
+                for (size_t q = 0; q < queries; ++q)
+                {
+                    size_t i = q * 7919 % n; // Ciała rozrzucone po całym zestawie
+                    const float point[3] = {bodies.x[i], bodies.y[i], bodies.z[i]};
+                    const float origin[3] = {point[0], point[1], point[2] + 1e6f}, dir[3] = {0.0f, 0.0f, -1.0f};
+                    bvh.Raycast(bodies, origin, dir);
+                    bvh.Nearest(bodies, point, 8, nearest, i);
+                    bvh.WithinRadius(bodies, point, 100.0f * bodies.radius[i], around);
+                } }, options.minSeconds),
+                   double(queries), "query");
+        }
+        if (enabled("bvh-ray-miss")) // Promień przez prostopadłościan korzenia, tuż pod jego ścianą: wybór w pustą przestrzeń
+        {
+            BodyBvh bvh;
+            bvh.Build(bodies);
+            const BodyBvh::Node &root = bvh.nodes[0];
+            const size_t rays = 256;
+            size_t misses = 0;
+            report("bvh-ray-miss", n, TimeIteration([&]
+                                                    {
+                misses = 0;
+                for (size_t q = 0; q < rays; ++q)
+                {
+                    float span = root.hi[1] - root.lo[1];
+                    const float origin[3] = {root.lo[0] - 1.0f, root.lo[1] + span * (float(q) + 0.5f) / float(rays),
+                                             root.hi[2] - 1e-3f * (root.hi[2] - root.lo[2])},
+                                dir[3] = {1.0f, 0.0f, 0.0f};
+                    misses += bvh.Raycast(bodies, origin, dir).body == BodyBvh::kNone ? 1 : 0;
+                } }, options.minSeconds),
+                   double(rays), "ray");
+            if (misses < rays / 2)
+                std::printf("%-14s N %8zu  only %zu of %zu rays missed\n", "bvh-ray-miss", n, misses, rays);
+        }
+        if (enabled("step") || enabled("integration")) // Pełny krok (leapfrog, Barnes-Hut); całkowanie z faz profilera
+        {
+            World world;
+            world.bodies = bodies;
+            world.solver = ForceSolver::BarnesHut;
+            world.integrator = Integrator::Leapfrog;
+            world.step(); // Siły startowe poza pomiarem
+            Profiler &profiler = GlobalProfiler();
+            profiler.Enable(false);
+            std::vector<Profiler::Phase> before, after;
+            double frames[Profiler::kHistory];
+            profiler.Snapshot(before, frames);
+            long long steps = 0;
+            double seconds = TimeIteration([&]
+                                           { world.step(); ++steps; }, options.minSeconds);
+            profiler.Snapshot(after, frames);
+            if (enabled("step"))
+                report("step", n, seconds, double(n), "body");
+            for (const Profiler::Phase &phase : after) // Czas fazy "integration" na krok (kicki, drifty, promienie)
+            {
+                if (std::strcmp(phase.name, "integration") != 0 || !enabled("integration"))
+                    continue;
+                double total = phase.total;
+                for (const Profiler::Phase &old : before)
+                    total -= std::strcmp(old.name, phase.name) == 0 ? old.total : 0.0;
+                report("integration", n, total / 1e3 / double(steps), double(n), "body");
+            }
+        }
+        if (enabled("step-mixed")) // Pełny krok w mieszanej precyzji (stan w double, siły w float względem środka masy)
+        {
+            World world;
+            world.bodies = bodies;
+            world.solver = ForceSolver::BarnesHut;
+            world.integrator = Integrator::Leapfrog;
+            world.precision = Precision::Mixed;
+            world.step();
+            report("step-mixed", n, TimeIteration([&]
+                                                  { world.step(); }, options.minSeconds),
+                   double(n), "body");
+        }
+        if (enabled("grid-deform")) // Ugięcie siatki na CPU (--cpu-grid): wierzchołek x ciało
+        {
+            std::vector<float> flat = CreateGridVertices(20000.0f, 25), packed, out;
+            PackGridBodies(bodies, packed);
+            double interactions = double(flat.size() / 3) * double(n);
+            if (interactions > options.maxPairs)
+                skip("grid-deform", n, "vertices x bodies, see --max-pairs");
+            else
+                report("grid-deform", n, TimeIteration([&]
+                                                       { DeformGridCPU(flat, packed, 0.0f, out); }, options.minSeconds),
+                       interactions, "vertex-body");
+        }
+        if (enabled("grid-adaptive")) // Przebudowa siatki adaptacyjnej po ruchu ciał
+        {
+            AdaptiveGrid grid;
+            BodyStore moved = bodies;
+            float shift = 0.0f;
+            report("grid-adaptive", n, TimeIteration([&]
+                                                     {
+                shift += 1.0f; // Wymusza przebudowę kafli przy ruszonych ciałach
+                for (size_t i = 0; i < moved.size(); ++i)
+                    moved.x[i] = bodies.x[i] + shift;
+                grid.Update(moved); }, options.minSeconds),
+                   double(n), "body");
+        }
+    }
+    if (enabled("icosphere")) // Teselacja sfery (poziomy LOD), na trójkąt
+    {
+        for (int s = 0; s <= 5; ++s)
+        {
+            size_t triangles = size_t(20) << (2 * s);
+            report("icosphere", triangles, TimeIteration([&]
+                                                         { BuildIcosphere(s); }, options.minSeconds),
+                   double(triangles), "triangle");
+        }
+    }
+    if (enabled("png-encode")) // Kodowanie klatki offscreen (filtry wierszy, deflate), na piksel
+    {
+        for (int height : {240, 720, 1080})
+        {
+            int width = height * 16 / 9;
+            std::vector<uint8_t> rgba(size_t(width) * height * 4, 0), png;
+            for (int y = 0; y < height; ++y) // Czarne tło, siatka i kilka kół: jak wyrenderowana scena
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    uint8_t *p = &rgba[(size_t(y) * width + x) * 4];
+                    bool grid = y > height / 2 && (x % 40 == 0 || y % 24 == 0);
+                    int dx = x % 200 - 100, dy = y % 150 - 75;
+                    uint8_t value = dx * dx + dy * dy < 900 ? uint8_t(255 - dx * dx / 8) : grid ? 64 : 0;
+                    p[0] = p[1] = p[2] = value;
+                    p[3] = 255;
+                }
+            }
+            size_t pixels = size_t(width) * height;
+            report("png-encode", pixels, TimeIteration([&]
+                                                       { EncodePng(rgba.data(), width, height, png); }, options.minSeconds),
+                   double(pixels), "pixel");
+        }
+    }
+
+    if (options.saveBaseline)
+    {
+        std::ofstream out(options.saveBaseline);
+        out << "# physics_bench baseline: ns per item (lower is better); regenerate with --save-baseline on the reference machine\n";
+        out << "name,n,ns_per_item,unit\n";
+        for (const BenchResult &r : results)
+            out << r.name << ',' << r.n << ',' << r.NsPerItem() << ',' << r.unit << '\n';
+        std::cout << "Baseline written to " << options.saveBaseline << std::endl;
+    }
+    if (regressions > 0)
+    {
+        std::cout << regressions << " regression(s) over " << options.tolerance * 100.0 << "% slower than baseline" << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+// Stan fizyczny ciała i stałe wspólne dla wszystkich solverów
+#pragma once
+
+#include <cmath> // std::pow
+
+// Stałe fizyczne
+const double G = 6.6743e-11; // Stała grawitacyjna (m^3 kg^-1 s^-2)
+const float c = 299792458.0; // Prędkość światła (m/s)
+const float sizeRatio = 30000.0f; // Współczynnik skalowania rozmiaru
+
+// Stałe kroku (zachowują dotychczasowe zachowanie sceny dla dt = 1 tick)
+const float kFixedDt = 1.0f; // Stały krok symulacji (1 tick = dawna jedna klatka)
+const float kVelocityScale = 96.0f; // Dzielnik przyspieszenia przy aktualizacji prędkości
+const float kPositionScale = 94.0f; // Dzielnik prędkości przy aktualizacji pozycji
+const float kDistanceToMeters = 1000.0f; // Jednostka pozycji to km, siła liczona w metrach
+const float kBounceFactor = -0.2f; // Mnożnik prędkości przy kolizji
+
+// G w jednostkach sceny (km, tick, kg): dx/dt = v/94 i dv/dt = a/96, więc u = v/94 i A = a/(96*94)
+const double kSceneG = G / (double(kDistanceToMeters) * kDistanceToMeters) / (double(kVelocityScale) * kPositionScale);
+
+// Promień kuli o danej masie i gęstości (w jednostkach sceny)
+inline float RadiusFromMass(float mass, float density)
+{
+    return float(std::pow(((3 * mass / density) / (4 * 3.14159265359)), (1.0f / 3.0f)) / sizeRatio);
+}
+
+// Stan fizyczny jednego ciała (bez zasobów renderujących)
+struct Body
+{
+    float position[3] = {0.0f, 0.0f, 0.0f}; // Pozycja (km)
+    float velocity[3] = {0.0f, 0.0f, 0.0f}; // Prędkość
+    float mass = 0.0f; // Masa (kg)
+    float density = 3344.0f; // Gęstość (kg/m^3)
+    float radius = 0.0f; // Promień obliczany z masy i gęstości
+
+    bool Initalizing = false; // Czy w trakcie umieszczania (wyłączone z oddziaływań)
+
+    Body() = default;
+    Body(float x, float y, float z, float vx, float vy, float vz, float mass, float density = 3344.0f)
+        : position{x, y, z}, velocity{vx, vy, vz}, mass(mass), density(density)
+    {
+        this->radius = RadiusFromMass(mass, density); // Oblicz promień
+    }
+};
@@ -0,0 +1,170 @@
+// Magazyn ciał w układzie struktura-tablic (SoA): osobne, wyrównane tablice dla każdego pola
+#pragma once
+
+#include <vector> // std::vector
+#include <cstddef> // size_t
+#include <cstdlib> // std::aligned_alloc, std::free
+#include <new> // std::bad_alloc
+#include <utility> // std::move
+
+#include "body.h" // Body
+
+// Alokator zwracający pamięć wyrównaną do Alignment bajtów (linia cache / rejestr AVX-512)
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n)
+    {
+        size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment; // Rozmiar musi być wielokrotnością wyrównania
+#ifdef _WIN32
+        void *p = _aligned_malloc(bytes, Alignment);
+#else
+        void *p = std::aligned_alloc(Alignment, bytes);
+#endif
+        if (!p)
+            throw std::bad_alloc();
+        return static_cast<T *>(p);
+    }
+
+    void deallocate(T *p, size_t)
+    {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+using FloatArray = std::vector<float, AlignedAllocator<float>>; // Wyrównana tablica floatów
+
+// Usuwa elementy o indeksach z listy removed, jakby usuwano je po kolei (każdy indeks ważny w chwili usunięcia).
+// Malejący ciąg indeksów (jedna partia usunięć) to jedno przejście kompaktujące zamiast przesuwania ogona za każdym razem.
+template <class Vector>
+void EraseIndices(Vector &v, const std::vector<size_t> &removed)
+{
+    size_t run = 0;
+    while (run < removed.size())
+    {
+        size_t end = run + 1; // Partia: indeksy ściśle malejące
+        while (end < removed.size() && removed[end] < removed[end - 1])
+            ++end;
+        size_t write = removed[end - 1], next = end; // Od najmniejszego indeksu partii
+        for (size_t read = write; read < v.size(); ++read)
+        {
+            if (next > run && read == removed[next - 1])
+            {
+                --next;
+                continue;
+            }
+            v[write++] = std::move(v[read]);
+        }
+        v.erase(v.begin() + write, v.end());
+        run = end;
+    }
+}
+
+// Stan fizyczny wszystkich ciał; indeks i we wszystkich tablicach opisuje to samo ciało
+struct BodyStore
+{
+    // Gorące dane: czytane przez solvery sił i integrację w każdym kroku
+    FloatArray x, y, z; // Pozycje (km)
+    FloatArray vx, vy, vz; // Prędkości
+    FloatArray mass; // Masy (kg)
+    FloatArray radius; // Promienie
+
+    // Zimne dane
+    FloatArray density; // Gęstości (kg/m^3)
+    std::vector<unsigned char> initalizing; // Czy ciało jest w trakcie umieszczania (wyłączone z oddziaływań)
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    void reserve(size_t n)
+    {
+        for (FloatArray *a : {&x, &y, &z, &vx, &vy, &vz, &mass, &radius, &density})
+            a->reserve(n);
+        initalizing.reserve(n);
+    }
+
+    // Nowe ciała (zerowe) na końcu; do równoległego wypełniania po indeksach
+    void resize(size_t n)
+    {
+        for (FloatArray *a : {&x, &y, &z, &vx, &vy, &vz, &mass, &radius, &density})
+            a->resize(n);
+        initalizing.resize(n);
+    }
+
+    void clear()
+    {
+        for (FloatArray *a : {&x, &y, &z, &vx, &vy, &vz, &mass, &radius, &density})
+            a->clear();
+        initalizing.clear();
+    }
+
+    // Dodaje ciało na koniec i zwraca jego indeks
+    size_t Add(const Body &b)
+    {
+        x.push_back(b.position[0]);
+        y.push_back(b.position[1]);
+        z.push_back(b.position[2]);
+        vx.push_back(b.velocity[0]);
+        vy.push_back(b.velocity[1]);
+        vz.push_back(b.velocity[2]);
+        mass.push_back(b.mass);
+        radius.push_back(b.radius);
+        density.push_back(b.density);
+        initalizing.push_back(b.Initalizing ? 1 : 0);
+        return size() - 1;
+    }
+
+    // Usuwa ciało i, zachowując kolejność pozostałych (indeksy > i maleją o 1)
+    void Remove(size_t i)
+    {
+        for (FloatArray *a : {&x, &y, &z, &vx, &vy, &vz, &mass, &radius, &density})
+            a->erase(a->begin() + i);
+        initalizing.erase(initalizing.begin() + i);
+    }
+
+    // Usunięcie wielu ciał jednym przejściem na tablicę (semantyka jak EraseIndices)
+    void RemoveIndices(const std::vector<size_t> &removed)
+    {
+        for (FloatArray *a : {&x, &y, &z, &vx, &vy, &vz, &mass, &radius, &density})
+            EraseIndices(*a, removed);
+        EraseIndices(initalizing, removed);
+    }
+
+    // Kopia ciała i jako pojedyncza struktura (poza gorącymi pętlami)
+    Body Get(size_t i) const
+    {
+        Body b;
+        b.position[0] = x[i];
+        b.position[1] = y[i];
+        b.position[2] = z[i];
+        b.velocity[0] = vx[i];
+        b.velocity[1] = vy[i];
+        b.velocity[2] = vz[i];
+        b.mass = mass[i];
+        b.density = density[i];
+        b.radius = radius[i];
+        b.Initalizing = initalizing[i] != 0;
+        return b;
+    }
+};
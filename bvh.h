@@ -0,0 +1,382 @@
+// Hierarchia prostopadłościanów otaczających (BVH) nad sferami ciał: budowa raz, potem tylko refit granic po ruchu.
+// Zapytania: promień (wybór ciała myszą), k najbliższych sąsiadów, ciała w zadanej odległości.
+#pragma once
+
+#include <vector> // std::vector
+#include <cmath> // std::sqrt
+#include <limits> // std::numeric_limits
+#include <algorithm> // std::min, std::max, std::nth_element, std::push_heap, std::pop_heap, std::sort_heap
+#include <cstddef> // size_t
+
+#include "body_store.h" // BodyStore
+#include "thread_pool.h" // ThreadPool, GlobalPool: równoległa budowa i refit poziomami
+
+class BodyBvh
+{
+public:
+    static const int kLeafSize = 4; // Najwięcej ciał w liściu
+    static const int kMaxDepth = 64; // Podział w medianie daje głębokość ~log2(N / kLeafSize)
+    static const size_t kNone = ~size_t(0);
+
+    struct Node
+    {
+        float lo[3], hi[3]; // Granice sfer ciał poddrzewa
+        int left; // Pierwsze dziecko (drugie: left + 1); -1 dla liścia
+        int begin, end; // Zakres ciał w tablicy order
+    };
+
+    struct RayHit
+    {
+        size_t body = kNone;
+        float t = std::numeric_limits<float>::infinity(); // Odległość wzdłuż promienia do powierzchni sfery
+    };
+
+    struct Neighbour
+    {
+        size_t body;
+        float distance; // Odległość środków
+    };
+
+    std::vector<Node> nodes; // Węzły poziomami (wszerz): dzieci leżą za rodzicami, poziom d to [levelBegin[d], levelBegin[d + 1])
+    std::vector<int> order; // Indeksy ciał ułożone wg liści
+    std::vector<int> levelBegin;
+    float rebuildRatio = 2.0f; // Budowa od nowa, gdy suma pól powierzchni węzłów urośnie tyle razy od ostatniej budowy
+    long long builds = 0, refits = 0;
+
+    // Refit granic po ruchu ciał; budowa od nowa, gdy zmieniła się liczba ciał albo drzewo za bardzo się rozlazło
+    void Update(const BodyStore &bodies, ThreadPool &pool = GlobalPool())
+    {
+        if (order.size() != bodies.size())
+        {
+            Build(bodies, pool);
+            return;
+        }
+        Refit(bodies, pool);
+        ++refits;
+        if (Cost() > rebuildRatio * builtCost)
+            Build(bodies, pool);
+    }
+
+    // Podział w medianie środków wzdłuż najdłuższej osi, poziom po poziomie (węzły poziomu równolegle)
+    void Build(const BodyStore &bodies, ThreadPool &pool = GlobalPool())
+    {
+        const int n = int(bodies.size());
+        nodes.clear();
+        levelBegin.assign(1, 0);
+        order.resize(size_t(n));
+        for (int i = 0; i < n; ++i)
+            order[size_t(i)] = i;
+        ++builds;
+        if (n == 0)
+        {
+            levelBegin.push_back(0);
+            builtCost = 0.0;
+            return;
+        }
+        nodes.push_back(Node{{0, 0, 0}, {0, 0, 0}, -1, 0, n});
+        std::vector<int> split;
+        for (int level = 0; level < kMaxDepth; ++level)
+        {
+            const int first = levelBegin.back(), last = int(nodes.size());
+            split.assign(size_t(last - first), -1);
+            pool.ParallelFor(size_t(first), size_t(last), 1, [&](size_t a, size_t b)
+                             {
+                for (size_t k = a; k < b; ++k)
+                    split[k - size_t(first)] = Split(bodies, nodes[k].begin, nodes[k].end); });
+            for (int k = first; k < last; ++k) // Dzieci kolejno za poziomem: następny poziom jest ciągły
+            {
+                int mid = split[size_t(k - first)];
+                if (mid < 0)
+                    continue;
+                Node &node = nodes[size_t(k)];
+                node.left = int(nodes.size());
+                int begin = node.begin, end = node.end;
+                nodes.push_back(Node{{0, 0, 0}, {0, 0, 0}, -1, begin, mid});
+                nodes.push_back(Node{{0, 0, 0}, {0, 0, 0}, -1, mid, end});
+            }
+            levelBegin.push_back(last);
+            if (int(nodes.size()) == last)
+                break;
+        }
+        if (levelBegin.back() != int(nodes.size())) // Przerwane na kMaxDepth: ostatni poziom zostaje liśćmi
+            levelBegin.push_back(int(nodes.size()));
+        Refit(bodies, pool);
+        builtCost = Cost();
+    }
+
+    // Granice od liści do korzenia; węzły jednego poziomu równolegle
+    void Refit(const BodyStore &bodies, ThreadPool &pool = GlobalPool())
+    {
+        for (int level = int(levelBegin.size()) - 2; level >= 0; --level)
+        {
+            pool.ParallelFor(size_t(levelBegin[size_t(level)]), size_t(levelBegin[size_t(level) + 1]), 256, [&](size_t a, size_t b)
+                             {
+                for (size_t k = a; k < b; ++k)
+                {
+                    Node &node = nodes[k];
+                    float lo[3], hi[3];
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        lo[d] = std::numeric_limits<float>::infinity();
+                        hi[d] = -std::numeric_limits<float>::infinity();
+                    }
+                    if (node.left < 0)
+                    {
+                        for (int s = node.begin; s < node.end; ++s)
+                        {
+                            size_t i = size_t(order[size_t(s)]);
+                            float p[3] = {bodies.x[i], bodies.y[i], bodies.z[i]}, r = bodies.radius[i];
+                            for (int d = 0; d < 3; ++d)
+                            {
+                                lo[d] = std::min(lo[d], p[d] - r);
+                                hi[d] = std::max(hi[d], p[d] + r);
+                            }
+                        }
+                    }
+                    else
+                    {
+                        for (const Node *child : {&nodes[size_t(node.left)], &nodes[size_t(node.left) + 1]})
+                        {
+                            for (int d = 0; d < 3; ++d)
+                            {
+                                lo[d] = std::min(lo[d], child->lo[d]);
+                                hi[d] = std::max(hi[d], child->hi[d]);
+                            }
+                        }
+                    }
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        node.lo[d] = lo[d];
+                        node.hi[d] = hi[d];
+                    }
+                } });
+        }
+    }
+
+    // Najbliższe trafienie promienia (dir znormalizowany) w sferę ciała, w odległości do maxT
+    RayHit Raycast(const BodyStore &bodies, const float origin[3], const float dir[3],
+                   float maxT = std::numeric_limits<float>::infinity()) const
+    {
+        RayHit hit;
+        hit.t = maxT;
+        if (nodes.empty())
+            return hit;
+        float inverse[3];
+        for (int d = 0; d < 3; ++d)
+            inverse[d] = 1.0f / dir[d]; // Zero daje nieskończoność: test płyt nadal działa
+        struct Pending
+        {
+            int node;
+            float enter; // Wejście promienia w prostopadłościan węzła
+        };
+        Pending stack[2 * kMaxDepth + 2];
+        int top = 0;
+        float enter = 0.0f;
+        if (!RayBox(nodes[0], origin, inverse, hit.t, enter))
+            return RayHit();
+        stack[top++] = Pending{0, enter};
+        while (top > 0)
+        {
+            Pending pending = stack[--top];
+            if (pending.enter > hit.t) // Trafienie znalezione po odłożeniu węzła jest bliżej
+                continue;
+            const Node &node = nodes[size_t(pending.node)];
+            if (node.left < 0)
+            {
+                for (int s = node.begin; s < node.end; ++s)
+                {
+                    size_t i = size_t(order[size_t(s)]);
+                    float oc[3] = {origin[0] - bodies.x[i], origin[1] - bodies.y[i], origin[2] - bodies.z[i]};
+                    float b = oc[0] * dir[0] + oc[1] * dir[1] + oc[2] * dir[2];
+                    float c = oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2] - bodies.radius[i] * bodies.radius[i];
+                    float disc = b * b - c;
+                    if (disc < 0.0f)
+                        continue;
+                    float root = std::sqrt(disc), t = -b - root;
+                    if (t < 0.0f)
+                        t = -b + root; // Początek promienia wewnątrz sfery
+                    if (t >= 0.0f && t < hit.t)
+                    {
+                        hit.t = t;
+                        hit.body = i;
+                    }
+                }
+                continue;
+            }
+            Pending near{node.left, 0.0f}, far{node.left + 1, 0.0f}; // Tylko dzieci trafione promieniem; bliższe zdejmowane pierwsze
+            bool nearHit = RayBox(nodes[size_t(near.node)], origin, inverse, hit.t, near.enter);
+            bool farHit = RayBox(nodes[size_t(far.node)], origin, inverse, hit.t, far.enter);
+            if (nearHit && farHit && near.enter > far.enter)
+                std::swap(near, far);
+            else if (!nearHit)
+            {
+                std::swap(near, far);
+                std::swap(nearHit, farHit);
+            }
+            if (farHit)
+                stack[top++] = far;
+            if (nearHit)
+                stack[top++] = near;
+        }
+        if (hit.body == kNone)
+            hit.t = std::numeric_limits<float>::infinity();
+        return hit;
+    }
+
+    // k ciał o środkach najbliżej punktu, rosnąco po odległości; exclude: pomijane ciało (np. samo zapytane)
+    void Nearest(const BodyStore &bodies, const float point[3], size_t k, std::vector<Neighbour> &out, size_t exclude = kNone) const
+    {
+        out.clear();
+        if (nodes.empty() || k == 0)
+            return;
+        auto farther = [](const Neighbour &a, const Neighbour &b)
+        { return a.distance < b.distance; }; // Kopiec: najdalszy z k na szczycie
+        float worst = std::numeric_limits<float>::infinity(); // Kwadrat odległości k-tego, gdy jest już k kandydatów
+        int stack[2 * kMaxDepth + 2];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node &node = nodes[size_t(stack[--top])];
+            if (BoxDistance2(node, point) > worst)
+                continue;
+            if (node.left < 0)
+            {
+                for (int s = node.begin; s < node.end; ++s)
+                {
+                    size_t i = size_t(order[size_t(s)]);
+                    if (i == exclude)
+                        continue;
+                    float dx = bodies.x[i] - point[0], dy = bodies.y[i] - point[1], dz = bodies.z[i] - point[2];
+                    float d2 = dx * dx + dy * dy + dz * dz;
+                    if (out.size() == k && d2 >= worst)
+                        continue;
+                    if (out.size() == k)
+                    {
+                        std::pop_heap(out.begin(), out.end(), farther);
+                        out.pop_back();
+                    }
+                    out.push_back(Neighbour{i, d2});
+                    std::push_heap(out.begin(), out.end(), farther);
+                    if (out.size() == k)
+                        worst = out.front().distance;
+                }
+                continue;
+            }
+            int near = node.left, far = node.left + 1;
+            if (BoxDistance2(nodes[size_t(near)], point) > BoxDistance2(nodes[size_t(far)], point))
+                std::swap(near, far);
+            stack[top++] = far;
+            stack[top++] = near;
+        }
+        std::sort_heap(out.begin(), out.end(), farther);
+        for (Neighbour &neighbour : out)
+            neighbour.distance = std::sqrt(neighbour.distance);
+    }
+
+    // Ciała o środkach w odległości najwyżej radius od punktu (kolejność dowolna)
+    void WithinRadius(const BodyStore &bodies, const float point[3], float radius, std::vector<size_t> &out) const
+    {
+        out.clear();
+        if (nodes.empty())
+            return;
+        const float radius2 = radius * radius;
+        int stack[2 * kMaxDepth + 2];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const Node &node = nodes[size_t(stack[--top])];
+            if (BoxDistance2(node, point) > radius2)
+                continue;
+            if (node.left >= 0)
+            {
+                stack[top++] = node.left;
+                stack[top++] = node.left + 1;
+                continue;
+            }
+            for (int s = node.begin; s < node.end; ++s)
+            {
+                size_t i = size_t(order[size_t(s)]);
+                float dx = bodies.x[i] - point[0], dy = bodies.y[i] - point[1], dz = bodies.z[i] - point[2];
+                if (dx * dx + dy * dy + dz * dz <= radius2)
+                    out.push_back(i);
+            }
+        }
+    }
+
+    // Suma pól powierzchni węzłów: koszt zapytań rośnie z nią, gdy refit rozciąga granice
+    double Cost() const
+    {
+        double sum = 0.0;
+        for (const Node &node : nodes)
+        {
+            double e[3] = {double(node.hi[0]) - node.lo[0], double(node.hi[1]) - node.lo[1], double(node.hi[2]) - node.lo[2]};
+            sum += e[0] * e[1] + e[1] * e[2] + e[2] * e[0];
+        }
+        return sum;
+    }
+
+private:
+    double builtCost = 0.0;
+
+    // Podział zakresu w medianie środków wzdłuż najdłuższej osi; -1, gdy zakres zostaje liściem
+    int Split(const BodyStore &bodies, int begin, int end)
+    {
+        if (end - begin <= kLeafSize)
+            return -1;
+        float lo[3], hi[3];
+        for (int d = 0; d < 3; ++d)
+        {
+            lo[d] = std::numeric_limits<float>::infinity();
+            hi[d] = -std::numeric_limits<float>::infinity();
+        }
+        for (int s = begin; s < end; ++s)
+        {
+            size_t i = size_t(order[size_t(s)]);
+            float p[3] = {bodies.x[i], bodies.y[i], bodies.z[i]};
+            for (int d = 0; d < 3; ++d)
+            {
+                lo[d] = std::min(lo[d], p[d]);
+                hi[d] = std::max(hi[d], p[d]);
+            }
+        }
+        int axis = 0;
+        for (int d = 1; d < 3; ++d)
+            axis = hi[d] - lo[d] > hi[axis] - lo[axis] ? d : axis;
+        const FloatArray &key = axis == 0 ? bodies.x : axis == 1 ? bodies.y : bodies.z;
+        int mid = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](int a, int b)
+                         { return key[size_t(a)] < key[size_t(b)]; });
+        return mid;
+    }
+
+    // Test płyt: false, gdy promień omija prostopadłościan albo wchodzi w niego dalej niż maxT; enter: odległość wejścia
+    static bool RayBox(const Node &node, const float origin[3], const float inverse[3], float maxT, float &enter)
+    {
+        enter = 0.0f;
+        float exit = maxT;
+        for (int d = 0; d < 3; ++d)
+        {
+            float t0 = (node.lo[d] - origin[d]) * inverse[d], t1 = (node.hi[d] - origin[d]) * inverse[d];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            enter = std::max(enter, t0);
+            exit = std::min(exit, t1);
+            if (!(enter <= exit)) // Także NaN z 0 * nieskończoność: promień na płaszczyźnie ściany
+                return false;
+        }
+        return true;
+    }
+
+    static float BoxDistance2(const Node &node, const float point[3])
+    {
+        float sum = 0.0f;
+        for (int d = 0; d < 3; ++d)
+        {
+            float excess = std::max(std::max(node.lo[d] - point[d], point[d] - node.hi[d]), 0.0f);
+            sum += excess * excess;
+        }
+        return sum;
+    }
+};
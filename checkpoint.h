@@ -0,0 +1,476 @@
+// Binarny zapis stanu (checkpoint): nagłówek z wersją i sekcje ułożone jak tablice BodyStore.
+// Odczyt przez mapowanie pliku (bez parsowania), zapis na osobnym wątku, gdy symulacja liczy dalej.
+#pragma once
+
+#include <vector> // std::vector
+#include <string> // std::string
+#include <thread> // std::thread
+#include <mutex> // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <cstdio> // std::FILE, std::fopen, std::rename
+#include <cstring> // std::memcpy, std::memcmp
+#include <cstdint> // uint32_t, uint64_t
+#include <chrono> // std::chrono::steady_clock: czas zapisu
+#include <utility> // std::move
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h> // CreateFileMapping, MapViewOfFile
+#else
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#endif
+
+#include "body_store.h" // BodyStore, FloatArray
+#include "simulation.h" // World, Integrator, ForceSolver, CollisionResponse
+#include "log.h" // LOG_INFO, LOG_ERROR: wynik zapisu w tle
+
+// Sekcje pliku: jedna tablica na pole, w kolejności wyliczenia
+enum CheckpointSection
+{
+    kSectionX,
+    kSectionY,
+    kSectionZ,
+    kSectionVx,
+    kSectionVy,
+    kSectionVz,
+    kSectionMass,
+    kSectionRadius,
+    kSectionDensity,
+    kSectionInitalizing, // uint8 na ciało
+    kSectionColor, // 4 floaty (RGBA) na ciało
+    kSectionGlow, // uint8 na ciało
+    kSectionId, // uint64 na ciało (trwałe identyfikatory)
+    kSectionPreciseX, // Sekcje double (tryb mieszany): tylko przy hasPrecise, inaczej offset 0
+    kSectionPreciseY,
+    kSectionPreciseZ,
+    kSectionPreciseVx,
+    kSectionPreciseVy,
+    kSectionPreciseVz,
+    kSectionCount
+};
+
+// Bajty na ciało w sekcji
+inline size_t CheckpointElementBytes(int section)
+{
+    switch (section)
+    {
+    case kSectionInitalizing:
+    case kSectionGlow:
+        return 1;
+    case kSectionColor:
+        return 4 * sizeof(float);
+    case kSectionId:
+        return sizeof(uint64_t);
+    case kSectionPreciseX:
+    case kSectionPreciseY:
+    case kSectionPreciseZ:
+    case kSectionPreciseVx:
+    case kSectionPreciseVy:
+    case kSectionPreciseVz:
+        return sizeof(double);
+    default:
+        return sizeof(float);
+    }
+}
+
+// Nagłówek na początku pliku (little-endian, jak na x86/ARM); sekcje wyrównane do 64 bajtów
+struct CheckpointHeader
+{
+    static const uint32_t kVersion = 2; // 2: tryb precyzji i sekcje double
+    static const uint32_t kByteOrderMark = 0x01020304u; // Inna kolejność bajtów = plik z obcej architektury
+
+    char magic[8]; // "PHYSCKPT"
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t headerBytes;
+    uint32_t sectionCount;
+    uint64_t bodyCount;
+    double time; // Czas symulacji (ticki)
+    int64_t stepCount;
+    uint32_t integrator; // Integrator
+    uint32_t solver; // ForceSolver
+    uint32_t collisionResponse; // CollisionResponse
+    float theta;
+    double hermiteEta, hermiteEtaStart;
+    int32_t hermiteMaxLevel;
+    uint32_t precision; // Precision
+    uint32_t hasPrecise; // 1 = sekcje double zapisane (początek układu względnego liczy się z nich od nowa)
+    uint32_t reserved;
+    uint64_t offsets[kSectionCount]; // Początek sekcji od początku pliku
+};
+
+// Stan do zapisu: własna kopia, więc zapis może trwać na innym wątku
+struct CheckpointData
+{
+    BodyStore bodies;
+    std::vector<uint64_t> ids; // Puste = 1..N
+    std::vector<float> colors; // 4 na ciało; puste = biały
+    std::vector<unsigned char> glow; // Puste = bez poświaty
+    double time = 0.0;
+    long long stepCount = 0;
+    Integrator integrator = Integrator::Euler;
+    ForceSolver solver = ForceSolver::Direct;
+    CollisionResponse collisionResponse = CollisionResponse::Bounce;
+    float theta = 0.5f;
+    double hermiteEta = 0.02, hermiteEtaStart = 0.01;
+    int hermiteMaxLevel = 20;
+    Precision precision = Precision::Single;
+    PreciseState precise; // Puste = bez sekcji double (np. zapis z migawki: tylko zaokrąglenie do float)
+
+    // Ustawienia solvera i integratora ze świata (ciała, czas i krok osobno, np. z migawki)
+    void SettingsFrom(const World &world)
+    {
+        integrator = world.integrator;
+        solver = world.solver;
+        collisionResponse = world.collisionResponse;
+        theta = world.theta;
+        hermiteEta = world.hermite.eta;
+        hermiteEtaStart = world.hermite.etaStart;
+        hermiteMaxLevel = world.hermite.maxLevel;
+        precision = world.precision;
+    }
+};
+
+// Czy sekcja istnieje w pliku (sekcje double tylko przy hasPrecise)
+inline bool CheckpointHasSection(int section, bool hasPrecise)
+{
+    return section < kSectionPreciseX || hasPrecise;
+}
+
+// Układ pliku dla bodyCount ciał; zwraca rozmiar pliku
+inline uint64_t CheckpointLayout(uint64_t bodyCount, bool hasPrecise, uint64_t (&offsets)[kSectionCount])
+{
+    uint64_t at = (sizeof(CheckpointHeader) + 63) & ~uint64_t(63);
+    for (int s = 0; s < kSectionCount; ++s)
+    {
+        offsets[s] = 0;
+        if (!CheckpointHasSection(s, hasPrecise))
+            continue;
+        offsets[s] = at;
+        at = (at + bodyCount * CheckpointElementBytes(s) + 63) & ~uint64_t(63);
+    }
+    return at;
+}
+
+// Zapis do path + ".tmp" i zamiana nazwy: przerwany zapis nie niszczy poprzedniego checkpointu
+inline bool WriteCheckpoint(const std::string &path, const CheckpointData &data)
+{
+    const BodyStore &b = data.bodies;
+    const uint64_t n = b.size();
+    CheckpointHeader header = {};
+    std::memcpy(header.magic, "PHYSCKPT", 8);
+    header.version = CheckpointHeader::kVersion;
+    header.byteOrder = CheckpointHeader::kByteOrderMark;
+    header.headerBytes = sizeof(CheckpointHeader);
+    header.sectionCount = kSectionCount;
+    header.bodyCount = n;
+    header.time = data.time;
+    header.stepCount = data.stepCount;
+    header.integrator = uint32_t(data.integrator);
+    header.solver = uint32_t(data.solver);
+    header.collisionResponse = uint32_t(data.collisionResponse);
+    header.theta = data.theta;
+    header.hermiteEta = data.hermiteEta;
+    header.hermiteEtaStart = data.hermiteEtaStart;
+    header.hermiteMaxLevel = data.hermiteMaxLevel;
+    header.precision = uint32_t(data.precision);
+    header.hasPrecise = data.precision == Precision::Mixed && data.precise.size() == n ? 1 : 0;
+    uint64_t fileBytes = CheckpointLayout(n, header.hasPrecise != 0, header.offsets);
+
+    std::vector<uint64_t> ids(data.ids);
+    if (ids.size() != n)
+    {
+        ids.resize(n);
+        for (uint64_t i = 0; i < n; ++i)
+            ids[i] = i + 1;
+    }
+    std::vector<float> colors(data.colors);
+    colors.resize(4 * n, 1.0f);
+    std::vector<unsigned char> glow(data.glow);
+    glow.resize(n, 0);
+    const void *sections[kSectionCount] = {b.x.data(), b.y.data(), b.z.data(), b.vx.data(), b.vy.data(), b.vz.data(),
+                                           b.mass.data(), b.radius.data(), b.density.data(), b.initalizing.data(),
+                                           colors.data(), glow.data(), ids.data(), data.precise.x.data(),
+                                           data.precise.y.data(), data.precise.z.data(), data.precise.vx.data(),
+                                           data.precise.vy.data(), data.precise.vz.data()};
+
+    std::string temporary = path + ".tmp";
+    std::FILE *file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+        return false;
+    static const char zeros[64] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t at = sizeof(header);
+    for (int s = 0; s < kSectionCount && ok; ++s)
+    {
+        if (!header.offsets[s])
+            continue;
+        ok = std::fwrite(zeros, 1, size_t(header.offsets[s] - at), file) == header.offsets[s] - at; // Wyrównanie
+        size_t bytes = size_t(n * CheckpointElementBytes(s));
+        ok = ok && (bytes == 0 || std::fwrite(sections[s], 1, bytes, file) == bytes);
+        at = header.offsets[s] + bytes;
+    }
+    ok = ok && std::fwrite(zeros, 1, size_t(fileBytes - at), file) == fileBytes - at;
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok)
+    {
+        std::remove(temporary.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str()); // rename na Windows nie nadpisuje
+#endif
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+// Plik checkpointu zmapowany tylko do odczytu; tablice wskazują wprost na strony pliku (ważne do Close)
+class MappedCheckpoint
+{
+public:
+    MappedCheckpoint() = default;
+    MappedCheckpoint(const MappedCheckpoint &) = delete;
+    MappedCheckpoint &operator=(const MappedCheckpoint &) = delete;
+
+    ~MappedCheckpoint()
+    {
+        Close();
+    }
+
+    // Mapuje plik i sprawdza nagłówek; przy błędzie opis w error
+    bool Open(const std::string &path, std::string &error)
+    {
+        Close();
+        if (!Map(path))
+        {
+            error = "cannot map " + path;
+            return false;
+        }
+        const CheckpointHeader *h = static_cast<const CheckpointHeader *>(base);
+        if (bytes < sizeof(CheckpointHeader) || std::memcmp(h->magic, "PHYSCKPT", 8) != 0)
+            error = "not a checkpoint file";
+        else if (h->byteOrder != CheckpointHeader::kByteOrderMark)
+            error = "checkpoint written on a machine with different byte order";
+        else if (h->version != CheckpointHeader::kVersion || h->headerBytes != sizeof(CheckpointHeader) || h->sectionCount != kSectionCount)
+            error = "unsupported checkpoint version " + std::to_string(h->version);
+        else if (h->integrator > uint32_t(Integrator::Hermite) || h->solver > uint32_t(ForceSolver::ParticleMesh) ||
+                 h->collisionResponse > uint32_t(CollisionResponse::Merge) || h->precision > uint32_t(Precision::Mixed) ||
+                 h->hasPrecise > 1)
+            error = "unsupported checkpoint"; // Wyliczenia spoza zakresu: LoadInto rzutuje je bez sprawdzania
+        else
+        {
+            for (int s = 0; s < kSectionCount && error.empty(); ++s)
+            {
+                if (!CheckpointHasSection(s, h->hasPrecise != 0))
+                    continue;
+                if (h->offsets[s] % 64 != 0 || h->offsets[s] + h->bodyCount * CheckpointElementBytes(s) > bytes)
+                    error = "truncated checkpoint";
+            }
+        }
+        if (!error.empty())
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if (!base)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+#else
+        munmap(base, bytes);
+#endif
+        base = nullptr;
+        bytes = 0;
+    }
+
+    const CheckpointHeader &Header() const
+    {
+        return *static_cast<const CheckpointHeader *>(base);
+    }
+
+    size_t size() const
+    {
+        return size_t(Header().bodyCount);
+    }
+
+    // Sekcja jako tablica T (wskaźnik do zmapowanej pamięci)
+    template <typename T>
+    const T *Section(int section) const
+    {
+        return reinterpret_cast<const T *>(static_cast<const char *>(base) + Header().offsets[section]);
+    }
+
+    // Ciała i ustawienia do świata: jedna kopia bloku na tablicę, bez parsowania
+    void LoadInto(World &world) const
+    {
+        const CheckpointHeader &h = Header();
+        BodyStore &b = world.bodies;
+        const size_t n = size();
+        FloatArray *arrays[] = {&b.x, &b.y, &b.z, &b.vx, &b.vy, &b.vz, &b.mass, &b.radius, &b.density};
+        for (int s = kSectionX; s <= kSectionDensity; ++s)
+        {
+            const float *p = Section<float>(s);
+            arrays[s]->assign(p, p + n);
+        }
+        const unsigned char *flags = Section<unsigned char>(kSectionInitalizing);
+        b.initalizing.assign(flags, flags + n);
+
+        world.time = h.time;
+        world.stepCount = h.stepCount;
+        world.integrator = Integrator(h.integrator);
+        world.solver = ForceSolver(h.solver);
+        world.collisionResponse = CollisionResponse(h.collisionResponse);
+        world.theta = h.theta;
+        world.hermite.eta = h.hermiteEta; // Stan kroków blokowych Hermite'a odtwarza się sam (nowy zbiór ciał)
+        world.hermite.etaStart = h.hermiteEtaStart;
+        world.hermite.maxLevel = h.hermiteMaxLevel;
+        world.precision = Precision(h.precision);
+        PreciseState precise; // Bez sekcji double: stan od nowa z float przy pierwszym kroku
+        if (h.hasPrecise)
+        {
+            DoubleArray *arrays[] = {&precise.x, &precise.y, &precise.z, &precise.vx, &precise.vy, &precise.vz};
+            for (int s = kSectionPreciseX; s <= kSectionPreciseVz; ++s)
+            {
+                const double *p = Section<double>(s);
+                arrays[s - kSectionPreciseX]->assign(p, p + n);
+            }
+        }
+        world.RestorePrecise(std::move(precise));
+    }
+
+private:
+    void *base = nullptr;
+    size_t bytes = 0;
+
+    bool Map(const std::string &path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+        {
+            base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            bytes = size_t(size.QuadPart);
+            CloseHandle(mapping); // Widok trzyma mapowanie
+        }
+        CloseHandle(file);
+#else
+        std::FILE *file = std::fopen(path.c_str(), "rb"); // Bez <unistd.h>: jego pause() zderza się z nazwami w main.cpp
+        if (!file)
+            return false;
+        int fd = fileno(file);
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                base = p;
+                bytes = size_t(st.st_size);
+                madvise(base, bytes, MADV_SEQUENTIAL); // Porady to wartości, nie flagi: dwa wywołania
+                madvise(base, bytes, MADV_WILLNEED); // Odczyt całości od razu
+            }
+        }
+        std::fclose(file); // Mapowanie zostaje po zamknięciu pliku
+#endif
+        return base != nullptr;
+    }
+};
+
+// Zapis w tle: Submit przejmuje kopię stanu i wraca od razu. Gdy poprzedni zapis jeszcze trwa,
+// czeka tylko najnowszy stan (starsze, niezapisane są zastępowane).
+class CheckpointWriter
+{
+public:
+    CheckpointWriter()
+    {
+        thread = std::thread([this]
+                             { Loop(); });
+    }
+
+    ~CheckpointWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+    void Submit(CheckpointData &&data, const std::string &path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = std::move(data);
+            pendingPath = path;
+            hasPending = true;
+        }
+        wake.notify_all();
+    }
+
+    // Czeka na zapis wszystkiego, co przyjęto; zwraca, czy ostatni zapis się udał
+    bool Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]
+                  { return !hasPending && !writing; });
+        return lastOk;
+    }
+
+    long long written = 0; // Udane zapisy (czytać po Wait)
+    double lastSeconds = 0.0; // Czas ostatniego zapisu
+
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    CheckpointData pending, current;
+    std::string pendingPath;
+    bool hasPending = false, writing = false, stop = false, lastOk = true;
+
+    void Loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [this]
+                      { return hasPending || stop; });
+            if (!hasPending)
+                return;
+            std::swap(current, pending);
+            std::string path = pendingPath;
+            hasPending = false;
+            writing = true;
+            lock.unlock();
+
+            auto start = std::chrono::steady_clock::now();
+            bool ok = WriteCheckpoint(path, current);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (ok)
+                LOG_INFO(General, "checkpoint %s: %zu bodies in %.3f s", path.c_str(), current.bodies.size(), seconds);
+            else
+                LOG_ERROR(General, "cannot write checkpoint %s", path.c_str());
+
+            lock.lock();
+            writing = false;
+            lastOk = ok;
+            lastSeconds = seconds;
+            written += ok ? 1 : 0;
+            idle.notify_all();
+        }
+    }
+};
@@ -0,0 +1,183 @@
+// Wykrywanie kolizji: faza szeroka na haszu przestrzennym, faza wąska na sferach
+#pragma once
+
+#include <vector> // std::vector
+#include <cmath> // std::sqrt, std::floor
+#include <cstdint> // uint64_t
+#include <algorithm> // std::sort, std::max
+
+#include "body_store.h" // BodyStore
+#include "thread_pool.h" // ThreadPool: faza wąska równolegle po komórkach
+
+// Para nachodzących na siebie ciał (a < b)
+struct CollisionEvent
+{
+    size_t a, b;
+    float depth; // Głębokość nachodzenia: ra + rb - odległość
+};
+
+// Jednorodna siatka komórek o boku ~2 * średni promień, sortowana zamiast tablicy haszującej.
+// Ciało trafia do każdej komórki, którą pokrywa jego AABB; para jest zgłaszana tylko w komórce
+// zawierającej minimalny róg części wspólnej AABB, więc bez duplikatów. Ciała większe niż
+// kMaxCellSpan komórek na oś są sprawdzane osobno ze wszystkimi (kilka gwiazd wśród tysięcy planet).
+// Koszt: O(N log N + kontakty) zamiast O(N^2).
+class CollisionDetector
+{
+public:
+    static const int kMaxCellSpan = 4; // Największe ciało wstawiane do siatki (komórek na oś)
+
+    // Wszystkie kontakty posortowane po (a, b); umieszczane ciała pominięte
+    const std::vector<CollisionEvent> &FindContacts(const BodyStore &bodies, ThreadPool &pool)
+    {
+        contacts.clear();
+        BuildCells(bodies);
+        FindCellContacts(bodies, pool);
+        FindLargeContacts(bodies);
+        std::sort(contacts.begin(), contacts.end(), [](const CollisionEvent &p, const CollisionEvent &q)
+                  { return p.a != q.a ? p.a < q.a : p.b < q.b; });
+        return contacts;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t key; // Spakowane współrzędne komórki (po 21 bitów)
+        size_t body;
+    };
+
+    std::vector<Entry> entries; // (komórka, ciało) posortowane po komórce
+    std::vector<size_t> runBegin; // Początki ciągów tej samej komórki w entries
+    std::vector<size_t> large; // Ciała za duże na siatkę
+    std::vector<std::vector<CollisionEvent>> chunkContacts; // Wyniki kawałków (łączone w stałej kolejności)
+    std::vector<CollisionEvent> contacts;
+    float cell = 1.0f;
+    float invCell = 1.0f;
+
+    static uint64_t Pack(long long ix, long long iy, long long iz)
+    {
+        const uint64_t mask = (uint64_t(1) << 21) - 1; // Zawijanie daleko poza zakresem tylko dodaje kandydatów
+        return ((uint64_t(ix) & mask) << 42) | ((uint64_t(iy) & mask) << 21) | (uint64_t(iz) & mask);
+    }
+
+    long long CellOf(float v) const
+    {
+        return (long long)std::floor(v * invCell);
+    }
+
+    void BuildCells(const BodyStore &bodies)
+    {
+        const size_t n = bodies.size();
+        double radiusSum = 0.0;
+        size_t active = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (!bodies.initalizing[i])
+            {
+                radiusSum += bodies.radius[i];
+                ++active;
+            }
+        }
+        cell = active > 0 && radiusSum > 0.0 ? float(2.0 * radiusSum / double(active)) : 1.0f;
+        invCell = 1.0f / cell;
+
+        entries.clear();
+        large.clear();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (bodies.initalizing[i])
+                continue;
+            float r = bodies.radius[i];
+            long long x0 = CellOf(bodies.x[i] - r), x1 = CellOf(bodies.x[i] + r);
+            long long y0 = CellOf(bodies.y[i] - r), y1 = CellOf(bodies.y[i] + r);
+            long long z0 = CellOf(bodies.z[i] - r), z1 = CellOf(bodies.z[i] + r);
+            if (x1 - x0 >= kMaxCellSpan || y1 - y0 >= kMaxCellSpan || z1 - z0 >= kMaxCellSpan)
+            {
+                large.push_back(i);
+                continue;
+            }
+            for (long long cx = x0; cx <= x1; ++cx)
+                for (long long cy = y0; cy <= y1; ++cy)
+                    for (long long cz = z0; cz <= z1; ++cz)
+                        entries.push_back(Entry{Pack(cx, cy, cz), i});
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry &p, const Entry &q)
+                  { return p.key != q.key ? p.key < q.key : p.body < q.body; });
+
+        runBegin.clear();
+        for (size_t e = 0; e < entries.size(); ++e)
+        {
+            if (e == 0 || entries[e].key != entries[e - 1].key)
+                runBegin.push_back(e);
+        }
+        runBegin.push_back(entries.size());
+    }
+
+    // Test sfer; zwraca true i wypełnia zdarzenie przy nachodzeniu
+    static bool Overlap(const BodyStore &bodies, size_t i, size_t j, CollisionEvent &ev)
+    {
+        float dx = bodies.x[j] - bodies.x[i];
+        float dy = bodies.y[j] - bodies.y[i];
+        float dz = bodies.z[j] - bodies.z[i];
+        float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        float reach = bodies.radius[i] + bodies.radius[j];
+        if (distance > 0 && reach > distance) // Kolizja (ciała w tym samym punkcie pomijane, jak dotąd)
+        {
+            ev = CollisionEvent{std::min(i, j), std::max(i, j), reach - distance};
+            return true;
+        }
+        return false;
+    }
+
+    void FindCellContacts(const BodyStore &bodies, ThreadPool &pool)
+    {
+        const size_t runs = runBegin.size() - 1;
+        const size_t grain = 256;
+        chunkContacts.resize((runs + grain - 1) / grain);
+        pool.ParallelFor(0, runs, grain, [&](size_t r0, size_t r1)
+                         {
+            std::vector<CollisionEvent> &out = chunkContacts[r0 / grain];
+            out.clear();
+            for (size_t r = r0; r < r1; ++r)
+            {
+                uint64_t key = entries[runBegin[r]].key;
+                for (size_t p = runBegin[r]; p < runBegin[r + 1]; ++p)
+                {
+                    size_t i = entries[p].body;
+                    for (size_t q = p + 1; q < runBegin[r + 1]; ++q)
+                    {
+                        size_t j = entries[q].body;
+                        // Minimalny róg części wspólnej AABB wyznacza jedyną komórkę zgłaszającą parę
+                        long long mx = CellOf(std::max(bodies.x[i] - bodies.radius[i], bodies.x[j] - bodies.radius[j]));
+                        long long my = CellOf(std::max(bodies.y[i] - bodies.radius[i], bodies.y[j] - bodies.radius[j]));
+                        long long mz = CellOf(std::max(bodies.z[i] - bodies.radius[i], bodies.z[j] - bodies.radius[j]));
+                        if (Pack(mx, my, mz) != key)
+                            continue;
+                        CollisionEvent ev;
+                        if (Overlap(bodies, i, j, ev))
+                            out.push_back(ev);
+                    }
+                }
+            } });
+        for (const std::vector<CollisionEvent> &chunk : chunkContacts)
+            contacts.insert(contacts.end(), chunk.begin(), chunk.end());
+    }
+
+    // Duże ciała: test z każdym innym ciałem (para dwóch dużych tylko raz)
+    void FindLargeContacts(const BodyStore &bodies)
+    {
+        for (size_t k = 0; k < large.size(); ++k)
+        {
+            size_t i = large[k];
+            for (size_t j = 0; j < bodies.size(); ++j)
+            {
+                if (j == i || bodies.initalizing[j])
+                    continue;
+                if (std::binary_search(large.begin(), large.end(), j) && j < i) // Para dużych już zgłoszona
+                    continue;
+                CollisionEvent ev;
+                if (Overlap(bodies, i, j, ev))
+                    contacts.push_back(ev);
+            }
+        }
+    }
+};
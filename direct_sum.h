@@ -0,0 +1,311 @@
+// Bezpośrednia suma sił grawitacji: O(N^2), solver referencyjny (skalarny i SIMD)
+#pragma once
+
+#include <cmath> // std::sqrt
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PHYSICS_X86_SIMD 1 // Jądra AVX2/AVX-512 wybierane w czasie działania
+#include <immintrin.h> // Intrinsics AVX2 / AVX-512
+#endif
+
+#include "body.h" // G, kDistanceToMeters
+#include "body_store.h" // BodyStore, FloatArray
+#include "thread_pool.h" // ThreadPool: równoległe bloki wierszy
+
+// Przyspieszenie grawitacyjne ciała i od wszystkich pozostałych (wynik w acc[3])
+inline void DirectAccelerationOf(const BodyStore &bodies, size_t i, float acc[3])
+{
+    acc[0] = acc[1] = acc[2] = 0.0f;
+    if (bodies.initalizing[i])
+        return;
+    const float px = bodies.x[i], py = bodies.y[i], pz = bodies.z[i];
+    for (size_t j = 0; j < bodies.size(); ++j)
+    {
+        if (j == i || bodies.initalizing[j]) // Pomijaj ten sam obiekt
+            continue;
+        float dx = bodies.x[j] - px; // Różnica x
+        float dy = bodies.y[j] - py; // Różnica y
+        float dz = bodies.z[j] - pz; // Różnica z
+        float distance = std::sqrt(dx * dx + dy * dy + dz * dz); // Odległość
+        if (distance > 0) // Jeśli nie nachodzą na siebie
+        {
+            double distance_m = double(distance) * kDistanceToMeters; // Konwersja do metrów
+            float acc1 = float(G * bodies.mass[j] / (distance_m * distance_m)); // Przyspieszenie
+            acc[0] += dx / distance * acc1;
+            acc[1] += dy / distance * acc1;
+            acc[2] += dz / distance * acc1;
+        }
+    }
+}
+
+// Poziom instrukcji wektorowych dla jądra sumy bezpośredniej
+enum class SimdLevel
+{
+    Scalar, // Zwykły kod C++
+    AVX2, // 8 oddziaływań na instrukcję
+    AVX512 // 16 oddziaływań na instrukcję
+};
+
+// Najlepszy poziom SIMD obsługiwany przez bieżący procesor
+inline SimdLevel DetectSimdLevel()
+{
+#ifdef PHYSICS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SimdLevel::AVX2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+// Wynik DetectSimdLevel zapamiętany przy pierwszym wywołaniu
+inline SimdLevel BestSimdLevel()
+{
+    static const SimdLevel level = DetectSimdLevel();
+    return level;
+}
+
+inline const char *SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX512:
+        return "avx512";
+    case SimdLevel::AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+// Spakowane ciała aktywne (bez umieszczanych) i akumulatory sum m*d/|d|^3
+struct DirectScratch
+{
+    FloatArray x, y, z, m; // Pozycje i masy aktywnych ciał
+    FloatArray acc; // Akumulatory bloków: [blok][x|y|z][ciało]
+    std::vector<size_t> blockBegin; // Pierwszy wiersz i każdego bloku (+ koniec)
+    std::vector<size_t> index; // Indeks w BodyStore dla każdego spakowanego ciała
+};
+
+// Akumulatory jednego bloku wierszy (każdy blok pisze tylko do własnych)
+struct DirectAcc
+{
+    float *sx, *sy, *sz;
+};
+
+// Oddziaływanie pary (i, j) wg trzeciej zasady dynamiki: dodaje do i, odejmuje od j
+inline void DirectPairScalar(const DirectScratch &s, DirectAcc a, size_t i, size_t j)
+{
+    float dx = s.x[j] - s.x[i];
+    float dy = s.y[j] - s.y[i];
+    float dz = s.z[j] - s.z[i];
+    float d2 = dx * dx + dy * dy + dz * dz;
+    if (d2 > 0.0f) // Ciała w tym samym punkcie nie oddziałują
+    {
+        float inv = 1.0f / std::sqrt(d2);
+        float inv3 = inv * inv * inv;
+        float wj = s.m[j] * inv3, wi = s.m[i] * inv3;
+        a.sx[i] += dx * wj;
+        a.sy[i] += dy * wj;
+        a.sz[i] += dz * wj;
+        a.sx[j] -= dx * wi;
+        a.sy[j] -= dy * wi;
+        a.sz[j] -= dz * wi;
+    }
+}
+
+// Jądro skalarne: każda para (i < j) z wierszy [iBegin, iEnd) liczona raz
+inline void DirectKernelScalar(const DirectScratch &s, size_t iBegin, size_t iEnd, DirectAcc a)
+{
+    size_t n = s.x.size();
+    for (size_t i = iBegin; i < iEnd; ++i)
+    {
+        for (size_t j = i + 1; j < n; ++j)
+            DirectPairScalar(s, a, i, j);
+    }
+}
+
+#ifdef PHYSICS_X86_SIMD
+// Jądro AVX2: ciało i kontra 8 kolejnych ciał j, rsqrt + jedna iteracja Newtona
+__attribute__((target("avx2,fma"))) inline void DirectKernelAVX2(const DirectScratch &s, size_t iBegin, size_t iEnd, DirectAcc a)
+{
+    size_t n = s.x.size();
+    const __m256 half = _mm256_set1_ps(0.5f), threeHalves = _mm256_set1_ps(1.5f), zero = _mm256_setzero_ps();
+    for (size_t i = iBegin; i < iEnd; ++i)
+    {
+        __m256 xi = _mm256_set1_ps(s.x[i]), yi = _mm256_set1_ps(s.y[i]), zi = _mm256_set1_ps(s.z[i]);
+        __m256 mi = _mm256_set1_ps(s.m[i]);
+        __m256 sx = zero, sy = zero, sz = zero;
+        size_t j = i + 1;
+        for (; j + 8 <= n; j += 8)
+        {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&s.x[j]), xi);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&s.y[j]), yi);
+            __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&s.z[j]), zi);
+            __m256 d2 = _mm256_fmadd_ps(dz, dz, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx)));
+            __m256 r = _mm256_rsqrt_ps(d2); // ~12 bitów
+            r = _mm256_mul_ps(r, _mm256_fnmadd_ps(_mm256_mul_ps(half, d2), _mm256_mul_ps(r, r), threeHalves)); // Newton: ~23 bity
+            r = _mm256_and_ps(r, _mm256_cmp_ps(d2, zero, _CMP_GT_OQ)); // d2 == 0 -> brak oddziaływania
+            __m256 r3 = _mm256_mul_ps(_mm256_mul_ps(r, r), r);
+            __m256 wj = _mm256_mul_ps(_mm256_loadu_ps(&s.m[j]), r3);
+            __m256 wi = _mm256_mul_ps(mi, r3);
+            sx = _mm256_fmadd_ps(dx, wj, sx);
+            sy = _mm256_fmadd_ps(dy, wj, sy);
+            sz = _mm256_fmadd_ps(dz, wj, sz);
+            _mm256_storeu_ps(&a.sx[j], _mm256_fnmadd_ps(dx, wi, _mm256_loadu_ps(&a.sx[j]))); // Trzecia zasada
+            _mm256_storeu_ps(&a.sy[j], _mm256_fnmadd_ps(dy, wi, _mm256_loadu_ps(&a.sy[j])));
+            _mm256_storeu_ps(&a.sz[j], _mm256_fnmadd_ps(dz, wi, _mm256_loadu_ps(&a.sz[j])));
+        }
+        alignas(32) float lane[3][8];
+        _mm256_store_ps(lane[0], sx);
+        _mm256_store_ps(lane[1], sy);
+        _mm256_store_ps(lane[2], sz);
+        for (int l = 0; l < 8; ++l)
+        {
+            a.sx[i] += lane[0][l];
+            a.sy[i] += lane[1][l];
+            a.sz[i] += lane[2][l];
+        }
+        for (; j < n; ++j) // Końcówka
+            DirectPairScalar(s, a, i, j);
+    }
+}
+
+// Jądro AVX-512: ciało i kontra 16 kolejnych ciał j
+__attribute__((target("avx512f"))) inline void DirectKernelAVX512(const DirectScratch &s, size_t iBegin, size_t iEnd, DirectAcc a)
+{
+    size_t n = s.x.size();
+    const __m512 half = _mm512_set1_ps(0.5f), threeHalves = _mm512_set1_ps(1.5f), zero = _mm512_setzero_ps();
+    for (size_t i = iBegin; i < iEnd; ++i)
+    {
+        __m512 xi = _mm512_set1_ps(s.x[i]), yi = _mm512_set1_ps(s.y[i]), zi = _mm512_set1_ps(s.z[i]);
+        __m512 mi = _mm512_set1_ps(s.m[i]);
+        __m512 sx = zero, sy = zero, sz = zero;
+        size_t j = i + 1;
+        for (; j + 16 <= n; j += 16)
+        {
+            __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(&s.x[j]), xi);
+            __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(&s.y[j]), yi);
+            __m512 dz = _mm512_sub_ps(_mm512_loadu_ps(&s.z[j]), zi);
+            __m512 d2 = _mm512_fmadd_ps(dz, dz, _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx)));
+            __mmask16 nonzero = _mm512_cmp_ps_mask(d2, zero, _CMP_GT_OQ); // d2 == 0 -> brak oddziaływania
+            __m512 r = _mm512_maskz_rsqrt14_ps(nonzero, d2); // ~14 bitów
+            r = _mm512_mul_ps(r, _mm512_fnmadd_ps(_mm512_mul_ps(half, d2), _mm512_mul_ps(r, r), threeHalves)); // Newton
+            __m512 r3 = _mm512_mul_ps(_mm512_mul_ps(r, r), r);
+            __m512 wj = _mm512_mul_ps(_mm512_loadu_ps(&s.m[j]), r3);
+            __m512 wi = _mm512_mul_ps(mi, r3);
+            sx = _mm512_fmadd_ps(dx, wj, sx);
+            sy = _mm512_fmadd_ps(dy, wj, sy);
+            sz = _mm512_fmadd_ps(dz, wj, sz);
+            _mm512_storeu_ps(&a.sx[j], _mm512_fnmadd_ps(dx, wi, _mm512_loadu_ps(&a.sx[j]))); // Trzecia zasada
+            _mm512_storeu_ps(&a.sy[j], _mm512_fnmadd_ps(dy, wi, _mm512_loadu_ps(&a.sy[j])));
+            _mm512_storeu_ps(&a.sz[j], _mm512_fnmadd_ps(dz, wi, _mm512_loadu_ps(&a.sz[j])));
+        }
+        alignas(64) float lane[3][16];
+        _mm512_store_ps(lane[0], sx);
+        _mm512_store_ps(lane[1], sy);
+        _mm512_store_ps(lane[2], sz);
+        for (int l = 0; l < 16; ++l)
+        {
+            a.sx[i] += lane[0][l];
+            a.sy[i] += lane[1][l];
+            a.sz[i] += lane[2][l];
+        }
+        for (; j < n; ++j) // Końcówka
+            DirectPairScalar(s, a, i, j);
+    }
+}
+#endif
+
+// Podział wierszy trójkąta par (i < j) na bloki o zbliżonej liczbie par.
+// Liczba bloków zależy tylko od n, więc suma jest identyczna dla każdej liczby wątków.
+inline void SplitDirectBlocks(size_t n, std::vector<size_t> &blockBegin)
+{
+    size_t blocks = std::min<size_t>(64, std::max<size_t>(1, n / 256));
+    double totalPairs = 0.5 * double(n) * double(n > 0 ? n - 1 : 0);
+    blockBegin.assign(1, 0);
+    double pairs = 0.0;
+    for (size_t i = 0; i < n && blockBegin.size() < blocks; ++i)
+    {
+        pairs += double(n - 1 - i);
+        if (pairs >= totalPairs * double(blockBegin.size()) / double(blocks))
+            blockBegin.push_back(i + 1);
+    }
+    blockBegin.push_back(n);
+}
+
+// Przyspieszenie grawitacyjne każdego ciała od wszystkich pozostałych (jądro wybrane wg procesora)
+inline void DirectAccelerations(const BodyStore &bodies, FloatArray &ax, FloatArray &ay, FloatArray &az, SimdLevel level = BestSimdLevel(), ThreadPool &pool = GlobalPool())
+{
+    static thread_local DirectScratch scratch; // Bufory wielokrotnego użytku
+    DirectScratch &s = scratch; // Referencja lokalna: lambdy w puli muszą widzieć bufory tego wątku
+    size_t n = bodies.size();
+    ax.assign(n, 0.0f);
+    ay.assign(n, 0.0f);
+    az.assign(n, 0.0f);
+
+    // Spakowanie aktywnych ciał
+    s.x.clear();
+    s.y.clear();
+    s.z.clear();
+    s.m.clear();
+    s.index.clear();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (bodies.initalizing[i])
+            continue;
+        s.x.push_back(bodies.x[i]);
+        s.y.push_back(bodies.y[i]);
+        s.z.push_back(bodies.z[i]);
+        s.m.push_back(bodies.mass[i]);
+        s.index.push_back(i);
+    }
+    size_t active = s.x.size();
+    SplitDirectBlocks(active, s.blockBegin);
+    size_t blocks = s.blockBegin.size() - 1;
+    s.acc.assign(blocks * 3 * active, 0.0f);
+
+    // Bloki wierszy równolegle; każdy blok ma własne akumulatory
+    pool.ParallelFor(0, blocks, 1, [&](size_t b0, size_t b1)
+                     {
+        for (size_t b = b0; b < b1; ++b)
+        {
+            float *base = s.acc.data() + b * 3 * active;
+            DirectAcc a{base, base + active, base + 2 * active};
+            size_t iBegin = s.blockBegin[b], iEnd = s.blockBegin[b + 1];
+            switch (level)
+            {
+#ifdef PHYSICS_X86_SIMD
+            case SimdLevel::AVX512:
+                DirectKernelAVX512(s, iBegin, iEnd, a);
+                break;
+            case SimdLevel::AVX2:
+                DirectKernelAVX2(s, iBegin, iEnd, a);
+                break;
+#endif
+            default:
+                DirectKernelScalar(s, iBegin, iEnd, a);
+                break;
+            }
+        } });
+
+    // Redukcja bloków w stałej kolejności, suma w double; a = G * m / d_m^2, odległości w km -> m
+    const double scale = G / (double(kDistanceToMeters) * kDistanceToMeters);
+    pool.ParallelFor(0, active, 4096, [&](size_t k0, size_t k1)
+                     {
+        for (size_t k = k0; k < k1; ++k)
+        {
+            double sx = 0.0, sy = 0.0, sz = 0.0;
+            for (size_t b = 0; b < blocks; ++b)
+            {
+                const float *base = s.acc.data() + b * 3 * active;
+                sx += base[k];
+                sy += base[active + k];
+                sz += base[2 * active + k];
+            }
+            ax[s.index[k]] = float(sx * scale);
+            ay[s.index[k]] = float(sy * scale);
+            az[s.index[k]] = float(sz * scale);
+        } });
+}
@@ -0,0 +1,42 @@
+// Ostrosłup widzenia z macierzy projection * view i test kuli (odrzucanie na CPU)
+#pragma once
+
+#include <cmath> // std::sqrt
+
+// Sześć płaszczyzn (a, b, c, d) skierowanych do wnętrza: punkt jest w środku, gdy a*x + b*y + c*z + d >= 0
+struct Frustum
+{
+    float planes[6][4];
+
+    // m: macierz projection * view w układzie kolumnowym (jak glm::value_ptr)
+    explicit Frustum(const float *m)
+    {
+        // Wiersz i macierzy: (m[i], m[4 + i], m[8 + i], m[12 + i]); metoda Gribba-Hartmanna
+        for (int p = 0; p < 6; ++p)
+        {
+            int row = p / 2; // 0 = x (lewa/prawa), 1 = y (dolna/górna), 2 = z (bliska/daleka)
+            float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+            float len2 = 0.0f;
+            for (int k = 0; k < 4; ++k)
+            {
+                planes[p][k] = m[4 * k + 3] + sign * m[4 * k + row];
+                if (k < 3)
+                    len2 += planes[p][k] * planes[p][k];
+            }
+            float inv = len2 > 0.0f ? 1.0f / std::sqrt(len2) : 0.0f; // Normalizacja: odległości w jednostkach świata
+            for (int k = 0; k < 4; ++k)
+                planes[p][k] *= inv;
+        }
+    }
+
+    // Czy kula (środek, promień) może być widoczna
+    bool SphereVisible(float x, float y, float z, float radius) const
+    {
+        for (const float *p : planes)
+        {
+            if (p[0] * x + p[1] * y + p[2] * z + p[3] < -radius)
+                return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,275 @@
+// Integrator Hermite'a 4. rzędu z hierarchicznymi krokami blokowymi (potęgi dwójki, kryterium Aarsetha)
+#pragma once
+
+#include <vector> // std::vector
+#include <cmath> // std::sqrt
+#include <cstdint> // int64_t
+#include <algorithm> // std::min, std::max
+
+#include "body.h" // kSceneG, kPositionScale
+#include "body_store.h" // BodyStore
+#include "thread_pool.h" // ThreadPool: siły aktywnych ciał równolegle
+
+// Stan integratora trzymany w jednostkach sceny: km i ticki.
+// Dawny krok v += a/96, x += v/94 oznacza dx/dt = v/94 i dv/dt = a/96, więc wewnętrzna
+// prędkość to u = v/94 [km/tick], a przyspieszenie A = a/(96*94) [km/tick^2].
+class HermiteIntegrator
+{
+public:
+    double eta = 0.02; // Dokładność kryterium Aarsetha
+    double etaStart = 0.01; // Dokładność pierwszego kroku (|a|/|j|)
+    int maxLevel = 20; // Najmniejszy krok = dt / 2^maxLevel
+
+    long long forceEvaluations = 0; // Ile razy policzono siłę na pojedyncze ciało
+    long long substeps = 0; // Ile podkroków blokowych wykonano
+
+    // Przesuwa wszystkie ciała o dt ticków; na końcu wszystkie są zsynchronizowane
+    void Advance(BodyStore &bodies, double dt, ThreadPool &pool)
+    {
+        if (!Matches(bodies) || dt != lastDt)
+            Initialize(bodies, dt, pool);
+
+        const int64_t end = int64_t(1) << maxLevel; // Koniec kroku w najmniejszych jednostkach
+        std::fill(t.begin(), t.end(), 0);
+        while (true)
+        {
+            // Najbliższy czas końca kroku i lista ciał aktywnych
+            int64_t tNext = end;
+            for (size_t k = 0; k < ids.size(); ++k)
+                tNext = std::min(tNext, t[k] + Span(level[k]));
+            if (tNext > end || ids.empty())
+                break;
+            active.clear();
+            for (size_t k = 0; k < ids.size(); ++k)
+            {
+                if (t[k] + Span(level[k]) == tNext)
+                    active.push_back(k);
+            }
+
+            Predict(tNext, dt);
+            Correct(tNext, dt, pool);
+            ++substeps;
+            if (tNext == end)
+                break;
+        }
+        WriteBack(bodies);
+    }
+
+private:
+    // Ciała biorące udział (bez umieszczanych) i ich stan w podwójnej precyzji
+    std::vector<size_t> ids; // Indeks w BodyStore
+    std::vector<double> x, u, a, j; // Pozycja, prędkość, przyspieszenie, zryw (po 3 na ciało)
+    std::vector<double> xp, up; // Wartości przewidziane na bieżący czas
+    std::vector<double> m; // Masy
+    std::vector<int64_t> t; // Czas ostatniej korekty (jednostki dt / 2^maxLevel)
+    std::vector<int> level; // Poziom kroku: dt_i = dt / 2^level
+    std::vector<size_t> active; // Ciała korygowane w bieżącym podkroku
+    std::vector<double> aNew, jNew; // Siły policzone dla aktywnych
+    size_t storeSize = 0; // Rozmiar BodyStore przy inicjalizacji
+    double lastDt = 0.0;
+
+    int64_t Span(int lvl) const
+    {
+        return int64_t(1) << (maxLevel - lvl);
+    }
+
+    // Czy BodyStore nie zmienił się od ostatniego kroku (kolizje, edycja, nowe ciała wymuszają restart)
+    bool Matches(const BodyStore &bodies) const
+    {
+        if (bodies.size() != storeSize)
+            return false;
+        size_t k = 0;
+        for (size_t i = 0; i < bodies.size(); ++i)
+        {
+            if (bodies.initalizing[i])
+                continue;
+            if (k >= ids.size() || ids[k] != i)
+                return false;
+            if (bodies.x[i] != float(x[3 * k]) || bodies.y[i] != float(x[3 * k + 1]) || bodies.z[i] != float(x[3 * k + 2]) ||
+                bodies.vx[i] != float(u[3 * k] * kPositionScale) || bodies.vy[i] != float(u[3 * k + 1] * kPositionScale) ||
+                bodies.vz[i] != float(u[3 * k + 2] * kPositionScale) || bodies.mass[i] != float(m[k]))
+                return false;
+            ++k;
+        }
+        return k == ids.size();
+    }
+
+    // Pełne przeliczenie sił i wybór początkowych poziomów kroku
+    void Initialize(const BodyStore &bodies, double dt, ThreadPool &pool)
+    {
+        ids.clear();
+        for (size_t i = 0; i < bodies.size(); ++i)
+        {
+            if (!bodies.initalizing[i])
+                ids.push_back(i);
+        }
+        size_t n = ids.size();
+        x.resize(3 * n);
+        u.resize(3 * n);
+        a.resize(3 * n);
+        j.resize(3 * n);
+        m.resize(n);
+        t.assign(n, 0);
+        level.assign(n, 0);
+        for (size_t k = 0; k < n; ++k)
+        {
+            size_t i = ids[k];
+            x[3 * k] = bodies.x[i];
+            x[3 * k + 1] = bodies.y[i];
+            x[3 * k + 2] = bodies.z[i];
+            u[3 * k] = double(bodies.vx[i]) / kPositionScale;
+            u[3 * k + 1] = double(bodies.vy[i]) / kPositionScale;
+            u[3 * k + 2] = double(bodies.vz[i]) / kPositionScale;
+            m[k] = bodies.mass[i];
+        }
+        xp = x;
+        up = u;
+        active.resize(n);
+        for (size_t k = 0; k < n; ++k)
+            active[k] = k;
+        ComputeForces(pool);
+        for (size_t k = 0; k < n; ++k)
+        {
+            for (int d = 0; d < 3; ++d)
+            {
+                a[3 * k + d] = aNew[3 * k + d];
+                j[3 * k + d] = jNew[3 * k + d];
+            }
+            double an = Norm(&a[3 * k]), jn = Norm(&j[3 * k]);
+            double dtCrit = jn > 0.0 ? etaStart * an / jn : dt;
+            level[k] = LevelFor(dtCrit, dt);
+        }
+        storeSize = bodies.size();
+        lastDt = dt;
+    }
+
+    // Przewidywanie (szereg Taylora do zrywu) pozycji i prędkości wszystkich ciał na czas tNext
+    void Predict(int64_t tNext, double dt)
+    {
+        double unit = dt / double(int64_t(1) << maxLevel);
+        for (size_t k = 0; k < ids.size(); ++k)
+        {
+            double h = double(tNext - t[k]) * unit;
+            for (int d = 0; d < 3; ++d)
+            {
+                size_t q = 3 * k + d;
+                xp[q] = x[q] + h * (u[q] + h * (a[q] / 2 + h * j[q] / 6));
+                up[q] = u[q] + h * (a[q] + h * j[q] / 2);
+            }
+        }
+    }
+
+    // Przyspieszenie i zryw aktywnych ciał od wszystkich pozostałych (pozycje przewidziane)
+    void ComputeForces(ThreadPool &pool)
+    {
+        aNew.resize(3 * ids.size());
+        jNew.resize(3 * ids.size());
+        size_t n = ids.size();
+        pool.ParallelFor(0, active.size(), 64, [&](size_t b, size_t e)
+                         {
+            for (size_t q = b; q < e; ++q)
+            {
+                size_t k = active[q];
+                double acc[3] = {0, 0, 0}, jerk[3] = {0, 0, 0};
+                for (size_t o = 0; o < n; ++o)
+                {
+                    if (o == k)
+                        continue;
+                    double r[3], v[3];
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        r[d] = xp[3 * o + d] - xp[3 * k + d];
+                        v[d] = up[3 * o + d] - up[3 * k + d];
+                    }
+                    double r2 = r[0] * r[0] + r[1] * r[1] + r[2] * r[2];
+                    if (r2 <= 0.0) // Ciała w tym samym punkcie nie oddziałują
+                        continue;
+                    double inv = 1.0 / std::sqrt(r2);
+                    double w = m[o] * inv * inv * inv;
+                    double rv = 3.0 * (r[0] * v[0] + r[1] * v[1] + r[2] * v[2]) / r2;
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        acc[d] += w * r[d];
+                        jerk[d] += w * (v[d] - rv * r[d]);
+                    }
+                }
+                for (int d = 0; d < 3; ++d)
+                {
+                    aNew[3 * k + d] = acc[d] * kSceneG;
+                    jNew[3 * k + d] = jerk[d] * kSceneG;
+                }
+            } });
+        forceEvaluations += (long long)active.size();
+    }
+
+    // Korektor Hermite'a dla aktywnych ciał i nowy poziom kroku
+    void Correct(int64_t tNext, double dt, ThreadPool &pool)
+    {
+        ComputeForces(pool);
+        double unit = dt / double(int64_t(1) << maxLevel);
+        for (size_t k : active)
+        {
+            double h = double(tNext - t[k]) * unit;
+            double h2 = h * h, h3 = h2 * h;
+            double a2End[3], a3[3];
+            for (int d = 0; d < 3; ++d)
+            {
+                size_t q = 3 * k + d;
+                double a0 = a[q], a1 = aNew[q], j0 = j[q], j1 = jNew[q];
+                double a2 = (-6.0 * (a0 - a1) - h * (4.0 * j0 + 2.0 * j1)) / h2; // Druga pochodna na początku
+                a3[d] = (12.0 * (a0 - a1) + 6.0 * h * (j0 + j1)) / h3; // Trzecia pochodna
+                x[q] = xp[q] + h2 * h2 * (a2 / 24.0 + h * a3[d] / 120.0);
+                u[q] = up[q] + h3 * (a2 / 6.0 + h * a3[d] / 24.0);
+                a[q] = a1;
+                j[q] = j1;
+                a2End[d] = a2 + h * a3[d]; // Druga pochodna na końcu kroku
+                xp[3 * k + d] = x[q];
+                up[3 * k + d] = u[q];
+            }
+
+            // Kryterium Aarsetha
+            double an = Norm(&a[3 * k]), jn = Norm(&j[3 * k]), sn = Norm(a2End), cn = Norm(a3);
+            double denom = jn * cn + sn * sn;
+            double dtCrit = denom > 0.0 ? std::sqrt(eta * (an * sn + jn * jn) / denom) : dt;
+            int wanted = LevelFor(dtCrit, dt);
+            t[k] = tNext;
+            if (wanted > level[k])
+                level[k] = wanted; // Mniejszy krok zawsze dozwolony
+            else if (wanted < level[k] && level[k] > 0 && t[k] % Span(level[k] - 1) == 0)
+                level[k] -= 1; // Większy krok najwyżej 2x i tylko na granicy bloku
+        }
+    }
+
+    // Najmniejszy poziom, którego krok nie przekracza dtCrit
+    int LevelFor(double dtCrit, double dt) const
+    {
+        int lvl = 0;
+        double h = dt;
+        while (h > dtCrit && lvl < maxLevel)
+        {
+            h *= 0.5;
+            ++lvl;
+        }
+        return lvl;
+    }
+
+    static double Norm(const double *v)
+    {
+        return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    }
+
+    // Zapis stanu z powrotem do BodyStore (prędkość w jednostkach sceny: v = u * 94)
+    void WriteBack(BodyStore &bodies) const
+    {
+        for (size_t k = 0; k < ids.size(); ++k)
+        {
+            size_t i = ids[k];
+            bodies.x[i] = float(x[3 * k]);
+            bodies.y[i] = float(x[3 * k + 1]);
+            bodies.z[i] = float(x[3 * k + 2]);
+            bodies.vx[i] = float(u[3 * k] * kPositionScale);
+            bodies.vy[i] = float(u[3 * k + 1] * kPositionScale);
+            bodies.vz[i] = float(u[3 * k + 2] * kPositionScale);
+        }
+    }
+};
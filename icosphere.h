@@ -0,0 +1,84 @@
+// Indeksowane ikosfery (kilka poziomów szczegółowości) i wybór poziomu z promienia na ekranie
+#pragma once
+
+#include <vector> // std::vector
+#include <map> // std::map: wierzchołki środków krawędzi
+#include <cmath> // std::sqrt
+#include <cstdint> // uint32_t, uint64_t
+
+// Siatka indeksowana: wierzchołki (x, y, z) na sferze jednostkowej i trójkąty
+struct IndexedMesh
+{
+    std::vector<float> vertices; // Współrzędne (3 na wierzchołek)
+    std::vector<uint32_t> indices; // Indeksy (3 na trójkąt)
+};
+
+// Ikosfera: dwudziestościan dzielony subdivisions razy (20 * 4^s trójkątów, bez zdublowanych wierzchołków)
+inline IndexedMesh BuildIcosphere(int subdivisions)
+{
+    IndexedMesh mesh;
+    const float t = (1.0f + std::sqrt(5.0f)) / 2.0f; // Złoty podział
+    const float base[12][3] = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+                               {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+    auto addVertex = [&mesh](float x, float y, float z) -> uint32_t
+    {
+        float len = std::sqrt(x * x + y * y + z * z); // Rzut na sferę jednostkową
+        mesh.vertices.insert(mesh.vertices.end(), {x / len, y / len, z / len});
+        return uint32_t(mesh.vertices.size() / 3 - 1);
+    };
+    for (const float *v : base)
+        addVertex(v[0], v[1], v[2]);
+    mesh.indices = {0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11, 1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+                    3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9, 4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1};
+
+    for (int s = 0; s < subdivisions; ++s)
+    {
+        std::map<uint64_t, uint32_t> midpoints; // Krawędź (mniejszy, większy indeks) -> wierzchołek środka
+        auto midpoint = [&](uint32_t a, uint32_t b) -> uint32_t
+        {
+            uint64_t key = a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+            auto it = midpoints.find(key);
+            if (it != midpoints.end())
+                return it->second;
+            const float *pa = &mesh.vertices[3 * a], *pb = &mesh.vertices[3 * b];
+            uint32_t m = addVertex((pa[0] + pb[0]) / 2, (pa[1] + pb[1]) / 2, (pa[2] + pb[2]) / 2);
+            midpoints.emplace(key, m);
+            return m;
+        };
+        std::vector<uint32_t> next;
+        next.reserve(mesh.indices.size() * 4);
+        for (size_t f = 0; f < mesh.indices.size(); f += 3)
+        {
+            uint32_t a = mesh.indices[f], b = mesh.indices[f + 1], c = mesh.indices[f + 2];
+            uint32_t ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+            next.insert(next.end(), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+        }
+        mesh.indices.swap(next);
+    }
+    return mesh;
+}
+
+// Poziomy szczegółowości: poziom l to ikosfera podzielona l razy
+const int kSphereLodLevels = 5; // 20, 80, 320, 1280, 5120 trójkątów
+
+// Poziom dla promienia rzutu na ekran w pikselach: wyższy poziom co 4x większy promień
+inline int LodForScreenRadius(float pixels)
+{
+    int level = 0;
+    for (float limit = 4.0f; pixels > limit && level < kSphereLodLevels - 1; limit *= 4.0f)
+        ++level;
+    return level;
+}
+
+// Wszystkie poziomy jednej sfery jednostkowej, liczone raz i współdzielone
+inline const std::vector<IndexedMesh> &SphereLodCache()
+{
+    static const std::vector<IndexedMesh> cache = []
+    {
+        std::vector<IndexedMesh> levels;
+        for (int l = 0; l < kSphereLodLevels; ++l)
+            levels.push_back(BuildIcosphere(l));
+        return levels;
+    }();
+    return cache;
+}
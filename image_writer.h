@@ -0,0 +1,429 @@
+// Zapis sekwencji klatek (PNG, PPM albo surowe RGB) na wątkach roboczych: kodowanie nie blokuje renderowania
+#pragma once
+
+#include <vector> // std::vector
+#include <deque> // std::deque: kolejka klatek do zakodowania
+#include <string> // std::string
+#include <thread> // std::thread
+#include <mutex> // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <chrono> // std::chrono: czas kodowania
+#include <cstdio> // std::FILE, std::fopen, std::snprintf
+#include <cstdlib> // std::abs
+#include <cstdint> // uint8_t, uint32_t
+#include <cstring> // std::strrchr, std::strcmp
+#include <algorithm> // std::min, std::max, std::upper_bound, std::copy
+#include <utility> // std::move
+
+#include "log.h" // LOG_INFO, LOG_ERROR
+
+enum class ImageFormat
+{
+    Png, // Bezstratnie skompresowane (deflate ze stałymi kodami Huffmana)
+    Ppm, // Nagłówek P6 i surowe RGB
+    Raw // Same wiersze RGB od góry, bez nagłówka
+};
+
+// Format z rozszerzenia ścieżki; nieznane rozszerzenie: PNG
+inline ImageFormat ImageFormatFromPath(const std::string &path)
+{
+    const char *dot = std::strrchr(path.c_str(), '.');
+    if (dot && std::strcmp(dot, ".ppm") == 0)
+        return ImageFormat::Ppm;
+    if (dot && std::strcmp(dot, ".raw") == 0)
+        return ImageFormat::Raw;
+    return ImageFormat::Png;
+}
+
+namespace image_detail
+{
+    // Bity deflate od najmłodszego
+    struct BitWriter
+    {
+        std::vector<uint8_t> &out;
+        uint64_t bits = 0;
+        int count = 0;
+
+        explicit BitWriter(std::vector<uint8_t> &out) : out(out) {}
+
+        void Put(uint32_t value, int n)
+        {
+            bits |= uint64_t(value) << count;
+            count += n;
+            while (count >= 8)
+            {
+                out.push_back(uint8_t(bits));
+                bits >>= 8;
+                count -= 8;
+            }
+        }
+
+        // Kod Huffmana zapisywany od najstarszego bitu
+        void PutCode(uint32_t code, int n)
+        {
+            uint32_t reversed = 0;
+            for (int b = 0; b < n; ++b)
+                reversed |= ((code >> b) & 1u) << (n - 1 - b);
+            Put(reversed, n);
+        }
+
+        void Flush()
+        {
+            if (count > 0)
+                out.push_back(uint8_t(bits));
+            bits = 0;
+            count = 0;
+        }
+    };
+
+    // Stały kod Huffmana literału albo długości (RFC 1951, 3.2.6)
+    inline void PutLiteral(BitWriter &w, uint32_t symbol)
+    {
+        if (symbol < 144)
+            w.PutCode(0x30 + symbol, 8);
+        else if (symbol < 256)
+            w.PutCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280)
+            w.PutCode(symbol - 256, 7);
+        else
+            w.PutCode(0xC0 + symbol - 280, 8);
+    }
+
+    inline void PutMatch(BitWriter &w, uint32_t length, uint32_t distance)
+    {
+        static const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const uint16_t distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                                  513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+        static const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        int l = int(std::upper_bound(lengthBase, lengthBase + 29, length) - lengthBase) - 1;
+        PutLiteral(w, 257 + l);
+        w.Put(length - lengthBase[l], lengthExtra[l]);
+        int d = int(std::upper_bound(distanceBase, distanceBase + 30, distance) - distanceBase) - 1;
+        w.PutCode(uint32_t(d), 5);
+        w.Put(distance - distanceBase[d], distanceExtra[d]);
+    }
+
+    // Strumień zlib: jeden blok deflate ze stałymi kodami, LZ77 z tablicą mieszającą (jeden kandydat na pozycję).
+    // Wyrenderowane klatki to głównie tło i powtarzalne wiersze po filtrze, więc to wystarcza i jest szybkie.
+    inline void Deflate(const std::vector<uint8_t> &data, std::vector<uint8_t> &out)
+    {
+        const size_t kWindow = 32768, kMaxMatch = 258, kHashBits = 15;
+        out.push_back(0x78); // CM = 8, okno 32 KB
+        out.push_back(0x01); // Najszybszy poziom, FCHECK
+        BitWriter w(out);
+        w.Put(1, 1); // BFINAL
+        w.Put(1, 2); // BTYPE = stałe kody
+        std::vector<int32_t> head(size_t(1) << kHashBits, -1);
+        auto hash = [&](size_t i)
+        { return ((uint32_t(data[i]) << 16 | uint32_t(data[i + 1]) << 8 | data[i + 2]) * 2654435761u) >> (32 - kHashBits); };
+        const size_t n = data.size();
+        size_t i = 0;
+        while (i < n)
+        {
+            size_t length = 0, distance = 0;
+            if (i + 3 <= n)
+            {
+                uint32_t h = hash(i);
+                int32_t candidate = head[h];
+                head[h] = int32_t(i);
+                if (candidate >= 0 && i - size_t(candidate) <= kWindow)
+                {
+                    size_t limit = std::min(kMaxMatch, n - i);
+                    const uint8_t *a = &data[i], *b = &data[size_t(candidate)];
+                    while (length < limit && a[length] == b[length])
+                        ++length;
+                    distance = i - size_t(candidate);
+                }
+            }
+            if (length >= 3)
+            {
+                PutMatch(w, uint32_t(length), uint32_t(distance));
+                for (size_t k = i + 1; k < i + length && k + 3 <= n; ++k) // Pozycje wewnątrz dopasowania też są kandydatami
+                    head[hash(k)] = int32_t(k);
+                i += length;
+            }
+            else
+                PutLiteral(w, data[i++]);
+        }
+        PutLiteral(w, 256); // Koniec bloku
+        w.Flush();
+        uint32_t a = 1, b = 0; // Adler-32
+        for (size_t k = 0; k < n;)
+        {
+            size_t end = std::min(n, k + 5552); // Bez przepełnienia przed modulo
+            for (; k < end; ++k)
+            {
+                a += data[k];
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        uint32_t adler = (b << 16) | a;
+        for (int s = 24; s >= 0; s -= 8)
+            out.push_back(uint8_t(adler >> s));
+    }
+
+    inline uint32_t Crc32(const uint8_t *data, size_t n, uint32_t crc = 0)
+    {
+        static const std::vector<uint32_t> table = []
+        {
+            std::vector<uint32_t> t(256);
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < n; ++i)
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    inline void PutChunk(std::vector<uint8_t> &png, const char *type, const std::vector<uint8_t> &data)
+    {
+        uint32_t length = uint32_t(data.size());
+        for (int s = 24; s >= 0; s -= 8)
+            png.push_back(uint8_t(length >> s));
+        size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        uint32_t crc = Crc32(&png[start], png.size() - start);
+        for (int s = 24; s >= 0; s -= 8)
+            png.push_back(uint8_t(crc >> s));
+    }
+
+    // Predyktor Paeth (PNG, filtr 4)
+    inline int Paeth(int a, int b, int c)
+    {
+        int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+    }
+
+    // Wiersz y obrazu (od góry) jako RGB; piksele z glReadPixels: RGBA, wiersze od dołu
+    inline void RowRgb(const uint8_t *rgba, int width, int height, int y, uint8_t *rgb)
+    {
+        const uint8_t *src = rgba + size_t(height - 1 - y) * width * 4;
+        for (int x = 0; x < width; ++x)
+        {
+            rgb[3 * x] = src[4 * x];
+            rgb[3 * x + 1] = src[4 * x + 1];
+            rgb[3 * x + 2] = src[4 * x + 2];
+        }
+    }
+}
+
+// PNG RGB 8 bitów; filtr wiersza wybrany po najmniejszej sumie modułów (heurystyka z libpng)
+inline void EncodePng(const uint8_t *rgba, int width, int height, std::vector<uint8_t> &png)
+{
+    using namespace image_detail;
+    const size_t stride = size_t(width) * 3;
+    std::vector<uint8_t> filtered, previous(stride, 0), current(stride), candidate(stride), best(stride);
+    filtered.reserve((stride + 1) * height);
+    for (int y = 0; y < height; ++y)
+    {
+        RowRgb(rgba, width, height, y, current.data());
+        long bestCost = -1;
+        uint8_t bestFilter = 0;
+        for (uint8_t filter : {0, 1, 2, 4})
+        {
+            long cost = 0;
+            for (size_t i = 0; i < stride; ++i)
+            {
+                int left = i >= 3 ? current[i - 3] : 0, up = previous[i], upLeft = i >= 3 ? previous[i - 3] : 0;
+                int predicted = filter == 0 ? 0 : filter == 1 ? left : filter == 2 ? up : Paeth(left, up, upLeft);
+                candidate[i] = uint8_t(current[i] - predicted);
+                cost += candidate[i] < 128 ? candidate[i] : 256 - candidate[i]; // Bajt ze znakiem
+            }
+            if (bestCost < 0 || cost < bestCost)
+            {
+                bestCost = cost;
+                bestFilter = filter;
+                best.swap(candidate);
+            }
+        }
+        filtered.push_back(bestFilter);
+        filtered.insert(filtered.end(), best.begin(), best.end());
+        previous.swap(current);
+    }
+
+    static const uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    png.assign(kSignature, kSignature + 8);
+    std::vector<uint8_t> header;
+    for (uint32_t v : {uint32_t(width), uint32_t(height)})
+        for (int s = 24; s >= 0; s -= 8)
+            header.push_back(uint8_t(v >> s));
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bitów, RGB, deflate, filtry adaptacyjne, bez przeplotu
+    PutChunk(png, "IHDR", header);
+    std::vector<uint8_t> compressed;
+    Deflate(filtered, compressed);
+    PutChunk(png, "IDAT", compressed);
+    PutChunk(png, "IEND", {});
+}
+
+// Obraz w podanym formacie (piksele jak w EncodePng)
+inline void EncodeImage(ImageFormat format, const uint8_t *rgba, int width, int height, std::vector<uint8_t> &out)
+{
+    if (format == ImageFormat::Png)
+    {
+        EncodePng(rgba, width, height, out);
+        return;
+    }
+    char header[32];
+    size_t start = format == ImageFormat::Ppm ? size_t(std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height)) : 0;
+    size_t stride = size_t(width) * 3;
+    out.resize(start + stride * height);
+    std::copy(header, header + start, out.begin());
+    for (int y = 0; y < height; ++y)
+        image_detail::RowRgb(rgba, width, height, y, &out[start + stride * y]);
+}
+
+// Klatki RGBA (wiersze od dołu, jak z glReadPixels) kodowane i zapisywane przez kilka wątków; nazwa pliku z wzorca
+// printf z numerem klatki. Kolejka ograniczona: gdy kodowanie nie nadąża, Submit czeka zamiast zbierać klatki w pamięci.
+class ImageSequenceWriter
+{
+public:
+    static const size_t kMaxQueuedPerWorker = 2; // Klatki czekające na wątek roboczy
+
+    ~ImageSequenceWriter()
+    {
+        Close();
+    }
+
+    // workers = 0: połowa rdzeni, najwyżej 4
+    bool Open(const std::string &pattern, int width, int height, unsigned workers = 0)
+    {
+        Close();
+        char probe[512];
+        if (std::snprintf(probe, sizeof(probe), pattern.c_str(), 0) <= 0)
+            return false;
+        this->pattern = pattern;
+        this->width = width;
+        this->height = height;
+        format = ImageFormatFromPath(pattern);
+        if (workers == 0)
+            workers = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+        maxQueued = kMaxQueuedPerWorker * workers;
+        ok = true;
+        stop = false;
+        frames = 0;
+        bytes = 0;
+        encodeSeconds = 0.0;
+        for (unsigned w = 0; w < workers; ++w)
+            threads.emplace_back([this]
+                                 { Loop(); });
+        return true;
+    }
+
+    size_t FrameBytes() const { return size_t(width) * height * 4; }
+
+    // Bufor na klatkę RGBA z puli (bez alokacji w stanie ustalonym)
+    std::vector<uint8_t> AcquireBuffer()
+    {
+        std::vector<uint8_t> buffer;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!spare.empty())
+            {
+                buffer = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        buffer.resize(FrameBytes());
+        return buffer;
+    }
+
+    void Submit(long long index, std::vector<uint8_t> &&rgba)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [this]
+                   { return queue.size() < maxQueued; });
+        queue.push_back({index, std::move(rgba)});
+        wake.notify_one();
+    }
+
+    // Koduje zaległe klatki i kończy wątki; zwraca, czy wszystko się zapisało
+    bool Close()
+    {
+        if (threads.empty())
+            return ok;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+        threads.clear();
+        spare.clear();
+        if (ok)
+            LOG_INFO(Render, "frames %s: %lld images, %.1f MB, encoding %.2f s per image on %zu threads", pattern.c_str(), frames,
+                     bytes / 1e6, frames > 0 ? encodeSeconds / frames : 0.0, maxQueued / kMaxQueuedPerWorker);
+        else
+            LOG_ERROR(Render, "cannot write frames %s", pattern.c_str());
+        return ok;
+    }
+
+    long long frames = 0; // Zapisane klatki (czytać po Close)
+    uint64_t bytes = 0;
+    double encodeSeconds = 0.0; // Suma czasów kodowania i zapisu wszystkich wątków
+
+private:
+    struct Pending
+    {
+        long long index;
+        std::vector<uint8_t> rgba;
+    };
+
+    std::string pattern;
+    int width = 0, height = 0;
+    ImageFormat format = ImageFormat::Png;
+    size_t maxQueued = kMaxQueuedPerWorker;
+    bool ok = true;
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake, space;
+    std::deque<Pending> queue;
+    std::vector<std::vector<uint8_t>> spare; // Bufory zwrócone przez wątki robocze
+    bool stop = false;
+
+    void Loop()
+    {
+        std::vector<uint8_t> encoded;
+        for (;;)
+        {
+            Pending frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]
+                          { return !queue.empty() || stop; });
+                if (queue.empty())
+                    return;
+                frame = std::move(queue.front());
+                queue.pop_front();
+            }
+            space.notify_one();
+            auto start = std::chrono::steady_clock::now();
+            EncodeImage(format, frame.rgba.data(), width, height, encoded);
+            char path[512];
+            std::snprintf(path, sizeof(path), pattern.c_str(), int(frame.index)); // Wzorzec z jednym %d
+            std::FILE *file = std::fopen(path, "wb");
+            bool written = file && std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+            written = file && std::fclose(file) == 0 && written;
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::lock_guard<std::mutex> lock(mutex);
+            ok = ok && written;
+            frames += written ? 1 : 0;
+            bytes += written ? encoded.size() : 0;
+            encodeSeconds += seconds;
+            spare.push_back(std::move(frame.rgba));
+        }
+    }
+};
@@ -0,0 +1,293 @@
+// Generatory warunków początkowych do testów skali: kula Plummera, dysk wykładniczy, zimny kolaps, pierścienie Keplera
+#pragma once
+
+#include <vector> // std::vector
+#include <cmath> // std::sqrt, std::log, std::pow
+#include <cstring> // std::strcmp
+#include <cstdint> // uint64_t
+#include <algorithm> // std::min
+
+#include "body.h" // kSceneG, kPositionScale, RadiusFromMass
+#include "body_store.h" // BodyStore
+#include "thread_pool.h" // ThreadPool: ciała generowane równolegle
+
+enum class InitialConditions
+{
+    Plummer, // Kula Plummera w równowadze (Aarseth, Hénon, Wielen 1974)
+    Disk, // Dysk wykładniczy z krzywą rotacji wokół masy centralnej
+    Collapse, // Jednorodna kula w spoczynku (zimny kolaps)
+    Rings // Cząstki na kołowych orbitach Keplera wokół masy centralnej
+};
+
+inline const char *InitialConditionsName(InitialConditions kind)
+{
+    switch (kind)
+    {
+    case InitialConditions::Disk:
+        return "disk";
+    case InitialConditions::Collapse:
+        return "collapse";
+    case InitialConditions::Rings:
+        return "rings";
+    default:
+        return "plummer";
+    }
+}
+
+// Generator o podanej nazwie; false, gdy nazwa nieznana
+inline bool InitialConditionsFromName(const char *name, InitialConditions &kind)
+{
+    for (InitialConditions k : {InitialConditions::Plummer, InitialConditions::Disk, InitialConditions::Collapse, InitialConditions::Rings})
+    {
+        if (std::strcmp(name, InitialConditionsName(k)) == 0)
+        {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parametry generatora w jednostkach sceny (km, kg); masa centralna tylko dla dysku i pierścieni
+struct GeneratorConfig
+{
+    InitialConditions kind = InitialConditions::Plummer;
+    size_t count = 10000; // Liczba ciał (z masą centralną)
+    uint64_t seed = 1;
+    float scale = 5000.0f; // Promień Plummera, promień kuli, skala dysku albo promień zewnętrznego pierścienia (km)
+    double totalMass = 0.0; // Masa ciał poza centralnym (0 = 1e25 kg; pierścienie: 1e-3 masy centralnej)
+    double centralMass = 1.989e25; // Jak gwiazda sceny domyślnej
+    float density = 5515.0f;
+    float center[3] = {0.0f, 0.0f, -350.0f}; // Środek układu (jak gwiazda sceny domyślnej)
+    int rings = 8; // Liczba pierścieni
+    float dispersion = 0.05f; // Dysk: rozrzut prędkości względem prędkości kołowej
+};
+
+// Niezależny strumień liczb losowych na ciało (SplitMix64): wynik nie zależy od liczby wątków ani podziału pracy
+class BodyRandom
+{
+public:
+    BodyRandom(uint64_t seed, uint64_t index) : state(Mix(seed ^ Mix(index + 0x9E3779B97F4A7C15ull))) {}
+
+    // Jednostajnie w (0, 1)
+    double Uniform()
+    {
+        return (double(Next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    // Rozkład normalny (Box-Muller)
+    double Gaussian()
+    {
+        return std::sqrt(-2.0 * std::log(Uniform())) * std::cos(6.283185307179586 * Uniform());
+    }
+
+    // Losowy kierunek na sferze jednostkowej
+    void Direction(double (&d)[3])
+    {
+        double cosTheta = 2.0 * Uniform() - 1.0, phi = 6.283185307179586 * Uniform();
+        double sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+        d[0] = sinTheta * std::cos(phi);
+        d[1] = cosTheta;
+        d[2] = sinTheta * std::sin(phi);
+    }
+
+private:
+    uint64_t state;
+
+    static uint64_t Mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t Next()
+    {
+        state += 0x9E3779B97F4A7C15ull;
+        return Mix(state);
+    }
+};
+
+// Prędkość kołowa wokół masy m w odległości r (km) jako prędkość ciała (v = 94 u)
+inline double CircularVelocity(double m, double r)
+{
+    return r > 0.0 ? std::sqrt(kSceneG * m / r) * kPositionScale : 0.0;
+}
+
+// Zmodyfikowane funkcje Bessela I0, I1, K0, K1 z szeregów potęgowych (Abramowitz, Stegun 9.6.10-9.6.13).
+// Dla 0 < y <= 5 (krzywa dysku) błąd względny ~1e-12; std::cyl_bessel_* nie ma w libc++.
+inline void BesselIK01(double y, double &i0, double &i1, double &k0, double &k1)
+{
+    const double kEulerGamma = 0.57721566490153286;
+    const double q = 0.25 * y * y, logHalf = std::log(0.5 * y);
+    double t0 = 1.0, t1 = 1.0; // (y²/4)^k / (k!)² i (y²/4)^k / (k! (k+1)!)
+    double harmonic = 0.0; // H_k
+    double sumK0 = 0.0, sumK1 = 0.0; // Sumy z funkcją digamma: psi(k+1) = H_k - gamma
+    i0 = 0.0;
+    i1 = 0.0;
+    for (int k = 0; k < 40; ++k)
+    {
+        double harmonicNext = harmonic + 1.0 / (k + 1);
+        i0 += t0;
+        i1 += t1;
+        sumK0 += t0 * harmonic;
+        sumK1 += t1 * (harmonic + harmonicNext - 2.0 * kEulerGamma);
+        if (t0 < 1e-17 * i0)
+            break;
+        t0 *= q / double((k + 1) * (k + 1));
+        t1 *= q / double((k + 1) * (k + 2));
+        harmonic = harmonicNext;
+    }
+    i1 *= 0.5 * y;
+    k0 = -(logHalf + kEulerGamma) * i0 + sumK0;
+    k1 = 1.0 / y + logHalf * i1 - 0.25 * y * sumK1;
+}
+
+// Dopisuje config.count ciał na koniec out. Płaszczyzna dysku i pierścieni to x-z (jak scena domyślna), oś y pionowa.
+inline void GenerateBodies(const GeneratorConfig &config, BodyStore &out, ThreadPool &pool = GlobalPool())
+{
+    const size_t first = out.size(), n = config.count;
+    if (n == 0)
+        return;
+    const bool central = config.kind == InitialConditions::Disk || config.kind == InitialConditions::Rings;
+    const size_t generated = central ? n - 1 : n; // Ciała poza centralnym
+    double totalMass = config.totalMass > 0.0 ? config.totalMass
+                       : config.kind == InitialConditions::Rings ? 1e-3 * config.centralMass
+                                                                  : 1e25;
+    const double m = generated > 0 ? totalMass / generated : 0.0;
+    const double a = config.scale;
+    const float radius = RadiusFromMass(float(m), config.density);
+    out.resize(first + n);
+
+    // Dysk wykładniczy (Freeman 1970): v^2 = 2 G Md / a * y^2 [I0 K0 - I1 K1](y), y = R / 2a; tablica do R = 10 a
+    const int kCurvePoints = 2048;
+    std::vector<double> diskCurve;
+    if (config.kind == InitialConditions::Disk)
+    {
+        diskCurve.resize(kCurvePoints + 1);
+        for (int k = 0; k <= kCurvePoints; ++k)
+        {
+            double y = 5.0 * k / kCurvePoints;
+            double term = 0.0;
+            if (k > 0)
+            {
+                double i0, i1, k0, k1;
+                BesselIK01(y, i0, i1, k0, k1);
+                term = y * y * (i0 * k0 - i1 * k1);
+            }
+            diskCurve[k] = 2.0 * kSceneG * totalMass / a * std::max(term, 0.0);
+        }
+    }
+
+    const size_t grain = 4096; // Stałe kawałki: sumy środka masy nie zależą od liczby wątków
+    std::vector<double> partial(((n + grain - 1) / grain) * 6, 0.0); // Masa * (x, y, z, vx, vy, vz) na kawałek
+    pool.ParallelFor(0, n, grain, [&](size_t i0, size_t i1)
+                     {
+        double *sum = &partial[(i0 / grain) * 6];
+        for (size_t i = i0; i < i1; ++i)
+        {
+            BodyRandom rng(config.seed, i);
+            double p[3] = {0.0, 0.0, 0.0}, v[3] = {0.0, 0.0, 0.0}, dir[3];
+            double mass = m;
+            if (central && i == 0) // Masa centralna w środku, w spoczynku
+                mass = config.centralMass;
+            else if (config.kind == InitialConditions::Plummer)
+            {
+                double r;
+                do // Promień z odwrotnej dystrybuanty masy; obcięcie na 10 a
+                    r = a / std::sqrt(std::pow(rng.Uniform(), -2.0 / 3.0) - 1.0);
+                while (r > 10.0 * a);
+                double q, g;
+                do // Prędkość w jednostkach ucieczki: g(q) = q^2 (1 - q^2)^3.5, metoda odrzucania
+                {
+                    q = rng.Uniform();
+                    g = 0.1 * rng.Uniform();
+                } while (g > q * q * std::pow(1.0 - q * q, 3.5));
+                double speed = q * std::sqrt(2.0) * std::pow(1.0 + r * r / (a * a), -0.25) * CircularVelocity(totalMass, a);
+                rng.Direction(dir);
+                for (int d = 0; d < 3; ++d)
+                    p[d] = r * dir[d];
+                rng.Direction(dir);
+                for (int d = 0; d < 3; ++d)
+                    v[d] = speed * dir[d];
+            }
+            else if (config.kind == InitialConditions::Collapse)
+            {
+                double r = a * std::cbrt(rng.Uniform()); // Jednorodnie w objętości
+                rng.Direction(dir);
+                for (int d = 0; d < 3; ++d)
+                    p[d] = r * dir[d];
+            }
+            else if (config.kind == InitialConditions::Disk)
+            {
+                double R;
+                do // Gęstość powierzchniowa exp(-R/a): R ma rozkład gamma(2)
+                    R = -a * std::log(rng.Uniform() * rng.Uniform());
+                while (R > 10.0 * a);
+                double phi = 6.283185307179586 * rng.Uniform();
+                double height = 0.1 * a * std::atanh(2.0 * rng.Uniform() - 1.0); // Profil pionowy sech^2
+                double t = std::min(R / (10.0 * a), 1.0) * kCurvePoints; // Krzywa rotacji: masa centralna + dysk
+                int k = std::min(int(t), kCurvePoints - 1);
+                double u2 = kSceneG * config.centralMass / R + diskCurve[k] + (diskCurve[k + 1] - diskCurve[k]) * (t - k);
+                double vc = std::sqrt(u2) * kPositionScale;
+                double sigma = config.dispersion * vc;
+                double vr = sigma * rng.Gaussian(), vt = vc + sigma * rng.Gaussian(), vy = 0.5 * sigma * rng.Gaussian();
+                double c = std::cos(phi), s = std::sin(phi);
+                p[0] = R * c;
+                p[1] = height;
+                p[2] = R * s;
+                v[0] = vr * c - vt * s;
+                v[1] = vy;
+                v[2] = vr * s + vt * c;
+            }
+            else // Pierścienie: równe odstępy od 0.3 a do a, ciała po kolei na pierścienie
+            {
+                int rings = std::max(config.rings, 1);
+                int ring = int((i - 1) % size_t(rings));
+                double R = a * (rings > 1 ? 0.3 + 0.7 * ring / (rings - 1) : 1.0);
+                double phi = 6.283185307179586 * rng.Uniform();
+                double vc = CircularVelocity(config.centralMass, R);
+                double c = std::cos(phi), s = std::sin(phi);
+                p[0] = R * c;
+                p[2] = R * s;
+                v[0] = -vc * s;
+                v[2] = vc * c;
+            }
+
+            out.x[first + i] = float(p[0]);
+            out.y[first + i] = float(p[1]);
+            out.z[first + i] = float(p[2]);
+            out.vx[first + i] = float(v[0]);
+            out.vy[first + i] = float(v[1]);
+            out.vz[first + i] = float(v[2]);
+            out.mass[first + i] = float(mass);
+            out.density[first + i] = config.density;
+            out.radius[first + i] = mass == m ? radius : RadiusFromMass(float(mass), config.density);
+            out.initalizing[first + i] = 0;
+            sum[0] += mass * p[0];
+            sum[1] += mass * p[1];
+            sum[2] += mass * p[2];
+            sum[3] += mass * v[0];
+            sum[4] += mass * v[1];
+            sum[5] += mass * v[2];
+        } });
+
+    // Środek masy w config.center, całkowity pęd zero
+    double com[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (size_t k = 0; k < partial.size(); ++k)
+        com[k % 6] += partial[k];
+    double mTotal = totalMass + (central ? config.centralMass : 0.0);
+    for (double &value : com)
+        value /= mTotal;
+    pool.ParallelFor(first, first + n, grain, [&](size_t i0, size_t i1)
+                     {
+        for (size_t i = i0; i < i1; ++i)
+        {
+            out.x[i] = float(out.x[i] - com[0] + config.center[0]);
+            out.y[i] = float(out.y[i] - com[1] + config.center[1]);
+            out.z[i] = float(out.z[i] - com[2] + config.center[2]);
+            out.vx[i] = float(out.vx[i] - com[3]);
+            out.vy[i] = float(out.vy[i] - com[4]);
+            out.vz[i] = float(out.vz[i] - com[5]);
+        } });
+}
@@ -0,0 +1,44 @@
+// Schematy symplektyczne jako polityki: ciąg kroków kick/drift wybierany w czasie kompilacji
+#pragma once
+
+// Krok schematu: kick(kKick[0]) drift(kDrift[0]) kick(kKick[1]) ... drift(kDrift[kStages-1]) kick(kKick[kStages]).
+// Współczynniki są ułamkami dt; zerowy kick jest pomijany (bez liczenia sił).
+// Jeśli ostatni kick jest niezerowy, siły z końca kroku służą do pierwszego kicka następnego (FSAL).
+
+// Współczynniki potrójnego skoku: w1 = 1 / (2 - 2^(1/3)), w0 = 1 - 2 w1
+constexpr double kTripleJumpW1 = 1.3512071919596578;
+constexpr double kTripleJumpW0 = 1.0 - 2.0 * kTripleJumpW1;
+
+// Dawny krok: semi-implicit Euler (prędkość, potem pozycja), 1. rząd
+struct EulerScheme
+{
+    static constexpr int kStages = 1;
+    static constexpr double kKick[] = {1.0, 0.0};
+    static constexpr double kDrift[] = {1.0};
+};
+
+// Leapfrog KDK (Störmer-Verlet), 2. rząd, jedno liczenie sił na krok
+struct LeapfrogScheme
+{
+    static constexpr int kStages = 1;
+    static constexpr double kKick[] = {0.5, 0.5};
+    static constexpr double kDrift[] = {1.0};
+};
+
+// Yoshida 4. rzędu: potrójny skok złożony z leapfrogów KDK, trzy liczenia sił na krok
+struct Yoshida4Scheme
+{
+    static constexpr int kStages = 3;
+    static constexpr double kKick[] = {kTripleJumpW1 / 2, (kTripleJumpW1 + kTripleJumpW0) / 2,
+                                       (kTripleJumpW0 + kTripleJumpW1) / 2, kTripleJumpW1 / 2};
+    static constexpr double kDrift[] = {kTripleJumpW1, kTripleJumpW0, kTripleJumpW1};
+};
+
+// Forest-Ruth 4. rzędu w postaci DKD (zaczyna i kończy pozycją), trzy liczenia sił na krok
+struct ForestRuthScheme
+{
+    static constexpr int kStages = 4;
+    static constexpr double kKick[] = {0.0, kTripleJumpW1, kTripleJumpW0, kTripleJumpW1, 0.0};
+    static constexpr double kDrift[] = {kTripleJumpW1 / 2, (1.0 - kTripleJumpW1) / 2, (1.0 - kTripleJumpW1) / 2,
+                                        kTripleJumpW1 / 2};
+};
@@ -0,0 +1,93 @@
+// Całki ruchu (energia, moment pędu) do śledzenia dryfu integratora
+#pragma once
+
+#include <vector> // std::vector
+#include <cmath> // std::sqrt, std::fabs
+
+#include "body.h" // kSceneG, kPositionScale
+#include "body_store.h" // BodyStore
+#include "thread_pool.h" // ThreadPool: energia potencjalna równolegle
+
+// Wartości w jednostkach sceny (km, tick): prędkość u = v/94, stała G skalowana jak w kroku fizyki
+struct Invariants
+{
+    double kinetic = 0.0;
+    double potential = 0.0;
+    double angularMomentum[3] = {0.0, 0.0, 0.0};
+
+    double Energy() const
+    {
+        return kinetic + potential;
+    }
+    double AngularMomentumNorm() const
+    {
+        return std::sqrt(angularMomentum[0] * angularMomentum[0] + angularMomentum[1] * angularMomentum[1] +
+                         angularMomentum[2] * angularMomentum[2]);
+    }
+};
+
+// O(N^2) dla energii potencjalnej; umieszczane ciała pominięte. Wynik nie zależy od liczby wątków.
+inline Invariants ComputeInvariants(const BodyStore &bodies, ThreadPool &pool = GlobalPool())
+{
+    const size_t n = bodies.size();
+    const size_t grain = 64;
+    std::vector<double> partial((n + grain - 1) / grain, 0.0); // Suma na kawałek, redukcja w stałej kolejności
+    pool.ParallelFor(0, n, grain, [&](size_t i0, size_t i1)
+                     {
+        double sum = 0.0;
+        for (size_t i = i0; i < i1; ++i)
+        {
+            if (bodies.initalizing[i])
+                continue;
+            for (size_t j = i + 1; j < n; ++j)
+            {
+                if (bodies.initalizing[j])
+                    continue;
+                double dx = double(bodies.x[j]) - bodies.x[i];
+                double dy = double(bodies.y[j]) - bodies.y[i];
+                double dz = double(bodies.z[j]) - bodies.z[i];
+                double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+                if (r > 0)
+                    sum -= kSceneG * double(bodies.mass[i]) * bodies.mass[j] / r;
+            }
+        }
+        partial[i0 / grain] = sum; });
+
+    Invariants inv;
+    for (double p : partial)
+        inv.potential += p;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (bodies.initalizing[i])
+            continue;
+        double m = bodies.mass[i];
+        double ux = double(bodies.vx[i]) / kPositionScale, uy = double(bodies.vy[i]) / kPositionScale,
+               uz = double(bodies.vz[i]) / kPositionScale;
+        inv.kinetic += 0.5 * m * (ux * ux + uy * uy + uz * uz);
+        inv.angularMomentum[0] += m * (double(bodies.y[i]) * uz - double(bodies.z[i]) * uy);
+        inv.angularMomentum[1] += m * (double(bodies.z[i]) * ux - double(bodies.x[i]) * uz);
+        inv.angularMomentum[2] += m * (double(bodies.x[i]) * uy - double(bodies.y[i]) * ux);
+    }
+    return inv;
+}
+
+// Względny dryf energii i momentu pędu względem stanu początkowego
+struct InvariantDrift
+{
+    double energy = 0.0;
+    double angularMomentum = 0.0;
+};
+
+inline InvariantDrift DriftFrom(const Invariants &start, const Invariants &now)
+{
+    InvariantDrift d;
+    double e0 = start.Energy();
+    d.energy = e0 != 0.0 ? (now.Energy() - e0) / std::fabs(e0) : 0.0;
+    double dl[3];
+    for (int k = 0; k < 3; ++k)
+        dl[k] = now.angularMomentum[k] - start.angularMomentum[k];
+    double l0 = start.AngularMomentumNorm();
+    double dln = std::sqrt(dl[0] * dl[0] + dl[1] * dl[1] + dl[2] * dl[2]);
+    d.angularMomentum = l0 != 0.0 ? dln / l0 : dln;
+    return d;
+}
@@ -0,0 +1,504 @@
+// Logowanie asynchroniczne: poziomy i kategorie, pierścień bez blokad, formatowanie i zapis na osobnym wątku
+#pragma once
+
+#include <atomic> // std::atomic
+#include <thread> // std::thread
+#include <mutex> // std::once_flag: wątek zapisu startuje przy pierwszym wpisie
+#include <chrono> // std::chrono
+#include <cstdio> // std::snprintf, std::fputs, stderr
+#include <cstring> // std::memcpy, std::strchr, std::strcmp
+#include <cstdint> // uint64_t, int64_t
+#include <memory> // std::unique_ptr
+#include <algorithm> // std::min
+#include <type_traits> // std::is_integral, std::is_floating_point
+
+// Poziomy poniżej tego progu znikają w czasie kompilacji (makra LOG_* rozwijają się do martwego kodu)
+#ifndef PHYSICS_LOG_MIN_LEVEL
+#define PHYSICS_LOG_MIN_LEVEL 1 // 0 = Trace, 1 = Debug, 2 = Info, 3 = Warn, 4 = Error
+#endif
+
+enum class LogLevel
+{
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error
+};
+
+enum class LogCategory
+{
+    General,
+    Physics,
+    Collisions,
+    Grid,
+    Input,
+    Render,
+    Count
+};
+
+inline const char *LogLevelName(LogLevel level)
+{
+    static const char *names[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR"};
+    return names[int(level)];
+}
+
+inline const char *LogCategoryName(LogCategory category)
+{
+    static const char *names[] = {"general", "physics", "collisions", "grid", "input", "render"};
+    return names[int(category)];
+}
+
+// Nazwa z linii poleceń; nieznana = Info
+inline LogLevel LogLevelFromName(const char *name)
+{
+    for (int l = 0; l <= int(LogLevel::Error); ++l)
+    {
+        const char *candidate = LogLevelName(LogLevel(l));
+        bool same = true;
+        for (size_t k = 0; same && (candidate[k] || name[k]); ++k)
+            same = (name[k] | 0x20) == (candidate[k] | 0x20); // Bez rozróżniania wielkości liter
+        if (same)
+            return LogLevel(l);
+    }
+    return LogLevel::Info;
+}
+
+// Kategoria z linii poleceń; nieznana = Count
+inline LogCategory LogCategoryFromName(const char *name)
+{
+    for (int c = 0; c < int(LogCategory::Count); ++c)
+    {
+        if (std::strcmp(LogCategoryName(LogCategory(c)), name) == 0)
+            return LogCategory(c);
+    }
+    return LogCategory::Count;
+}
+
+// Wpis w pierścieniu: format (literał) i argumenty w postaci binarnej; tekst powstaje dopiero na wątku zapisu.
+// Argumenty const char* są kopiowane (obcięte do miejsca w strings), więc mogą wskazywać na bufory tymczasowe.
+struct LogRecord
+{
+    static const int kMaxArgs = 6;
+    static const int kStringBytes = 240; // Miejsce na kopie napisów (np. log kompilacji shadera)
+
+    enum ArgType : unsigned char
+    {
+        Int,
+        Unsigned,
+        Double,
+        String,
+        Pointer
+    };
+
+    union Arg
+    {
+        int64_t i;
+        uint64_t u;
+        double d;
+        unsigned short offset; // Początek napisu w strings
+        const void *p;
+    };
+
+    double seconds; // Czas od startu loggera
+    const char *format;
+    LogLevel level;
+    LogCategory category;
+    unsigned char argCount;
+    unsigned char stringUsed;
+    ArgType types[kMaxArgs];
+    Arg args[kMaxArgs];
+    char strings[kStringBytes];
+};
+
+namespace log_detail
+{
+    inline void Store(LogRecord &r, int k, const char *s)
+    {
+        const size_t last = LogRecord::kStringBytes - 1; // Ostatni bajt zawsze '\0': pusty napis, gdy miejsce się skończyło
+        size_t room = last - r.stringUsed;
+        size_t n = 0;
+        while (s && s[n] && n + 1 < room)
+            ++n;
+        r.types[k] = LogRecord::String;
+        r.args[k].offset = r.stringUsed;
+        r.strings[last] = '\0';
+        if (room > 0)
+        {
+            std::memcpy(r.strings + r.stringUsed, s ? s : "", n);
+            r.strings[r.stringUsed + n] = '\0';
+            r.stringUsed = (unsigned char)(r.stringUsed + n + 1);
+        }
+    }
+    inline void Store(LogRecord &r, int k, char *s) { Store(r, k, (const char *)s); }
+
+    template <typename T>
+    void Store(LogRecord &r, int k, T v)
+    {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "log arguments: numbers, enums, C strings, pointers");
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            r.types[k] = LogRecord::Double;
+            r.args[k].d = double(v);
+        }
+        else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value)
+        {
+            r.types[k] = LogRecord::Int;
+            r.args[k].i = int64_t(v);
+        }
+        else
+        {
+            r.types[k] = LogRecord::Unsigned;
+            r.args[k].u = uint64_t(v);
+        }
+    }
+    template <typename T>
+    void Store(LogRecord &r, int k, T *p)
+    {
+        r.types[k] = LogRecord::Pointer;
+        r.args[k].p = p;
+    }
+
+    inline void StoreAll(LogRecord &, int) {}
+    template <typename T, typename... Rest>
+    void StoreAll(LogRecord &r, int k, T v, Rest... rest)
+    {
+        if (k >= LogRecord::kMaxArgs)
+            return;
+        Store(r, k, v);
+        r.argCount = (unsigned char)(k + 1);
+        StoreAll(r, k + 1, rest...);
+    }
+}
+
+// Logger procesu. Producenci (dowolne wątki) tylko filtrują i kopiują wpis do pierścienia MPSC;
+// wątek zapisu formatuje i pisze na stderr partiami. Pełny pierścień = wpis odrzucony (licznik dropped).
+// Na kategorię: próbkowanie (co N-ty wpis) i limit wpisów na sekundę; nadwyżki są tylko liczone.
+class Logger
+{
+public:
+    static const size_t kCapacity = 4096; // Wpisów w pierścieniu (potęga dwójki)
+
+    Logger()
+    {
+        for (size_t k = 0; k < kCapacity; ++k)
+            cells[k].sequence.store(k, std::memory_order_relaxed);
+        for (CategoryState &c : categories)
+        {
+            c.sampleEvery.store(1, std::memory_order_relaxed);
+            c.perSecond.store(200, std::memory_order_relaxed);
+        }
+    }
+
+    ~Logger()
+    {
+        stop.store(true, std::memory_order_release);
+        if (writer.joinable())
+            writer.join(); // Wątek zapisu opróżnia pierścień przed wyjściem
+    }
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    void SetLevel(LogLevel level)
+    {
+        minLevel.store(int(level), std::memory_order_relaxed);
+    }
+
+    // Co N-ty wpis kategorii trafia do pierścienia (1 = wszystkie)
+    void SetSampling(LogCategory category, unsigned every)
+    {
+        categories[int(category)].sampleEvery.store(every > 0 ? every : 1, std::memory_order_relaxed);
+    }
+
+    // Najwyżej N wpisów kategorii na sekundę (0 = bez limitu); błędy nie są limitowane
+    void SetRateLimit(LogCategory category, unsigned perSecond)
+    {
+        categories[int(category)].perSecond.store(perSecond, std::memory_order_relaxed);
+    }
+
+    void SetRateLimitAll(unsigned perSecond)
+    {
+        for (int c = 0; c < int(LogCategory::Count); ++c)
+            SetRateLimit(LogCategory(c), perSecond);
+    }
+
+    // Szybki test przed zebraniem argumentów
+    bool Enabled(LogLevel level) const
+    {
+        return int(level) >= minLevel.load(std::memory_order_relaxed);
+    }
+
+    template <typename... Args>
+    void Write(LogLevel level, LogCategory category, const char *format, Args... args)
+    {
+        if (!Admit(level, category))
+            return;
+        size_t position = tail.load(std::memory_order_relaxed);
+        Cell *cell;
+        for (;;) // Kolejka ograniczona Vyukova: numer sekwencji komórki mówi, czy jest wolna
+        {
+            cell = &cells[position & (kCapacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(sequence) - intptr_t(position);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed); // Pełny: nie czekamy
+                return;
+            }
+            else
+            {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+        LogRecord &r = cell->record;
+        r.seconds = Seconds();
+        r.format = format;
+        r.level = level;
+        r.category = category;
+        r.argCount = 0;
+        r.stringUsed = 0;
+        log_detail::StoreAll(r, 0, args...);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        std::call_once(writerStarted, [this]
+                       { writer = std::thread([this]
+                                              { Drain(); }); });
+    }
+
+    // Czeka, aż wątek zapisu opróżni pierścień (np. przed zakończeniem programu)
+    void Flush()
+    {
+        if (!writer.joinable())
+            return;
+        while (head.load(std::memory_order_acquire) != tail.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::fflush(stderr);
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    struct CategoryState
+    {
+        std::atomic<unsigned> sampleEvery;
+        std::atomic<unsigned> perSecond;
+        std::atomic<uint64_t> seen{0}; // Do próbkowania
+        std::atomic<int64_t> window{-1}; // Bieżąca sekunda limitu
+        std::atomic<unsigned> inWindow{0};
+        std::atomic<uint64_t> suppressed{0}; // Odrzucone przez limit (zgłaszane zbiorczo)
+    };
+
+    std::unique_ptr<Cell[]> cells{new Cell[kCapacity]};
+    alignas(64) std::atomic<size_t> tail{0}; // Producenci
+    alignas(64) std::atomic<size_t> head{0}; // Tylko wątek zapisu
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<int> minLevel{int(LogLevel::Info)};
+    CategoryState categories[int(LogCategory::Count)];
+    std::atomic<bool> stop{false};
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::once_flag writerStarted;
+    std::thread writer;
+
+    double Seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    bool Admit(LogLevel level, LogCategory category)
+    {
+        if (!Enabled(level))
+            return false;
+        if (level == LogLevel::Error)
+            return true;
+        CategoryState &c = categories[int(category)];
+        unsigned every = c.sampleEvery.load(std::memory_order_relaxed);
+        if (every > 1 && c.seen.fetch_add(1, std::memory_order_relaxed) % every != 0)
+            return false;
+        unsigned limit = c.perSecond.load(std::memory_order_relaxed);
+        if (limit == 0)
+            return true;
+        int64_t second = int64_t(Seconds());
+        int64_t window = c.window.load(std::memory_order_relaxed);
+        if (window != second && c.window.compare_exchange_strong(window, second, std::memory_order_relaxed))
+            c.inWindow.store(0, std::memory_order_relaxed); // Nowa sekunda (wyścig kilku wpisów na granicy jest nieistotny)
+        if (c.inWindow.fetch_add(1, std::memory_order_relaxed) < limit)
+            return true;
+        c.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void Drain()
+    {
+        char line[1024];
+        for (;;)
+        {
+            bool stopping = stop.load(std::memory_order_acquire);
+            size_t written = 0;
+            for (;;)
+            {
+                size_t position = head.load(std::memory_order_relaxed);
+                Cell &cell = cells[position & (kCapacity - 1)];
+                if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+                    break; // Pusto albo producent jeszcze pisze
+                Format(cell.record, line, sizeof(line));
+                cell.sequence.store(position + kCapacity, std::memory_order_release);
+                head.store(position + 1, std::memory_order_release);
+                std::fputs(line, stderr);
+                ++written;
+            }
+            written += ReportLosses(line, sizeof(line));
+            if (written > 0)
+                std::fflush(stderr); // Jeden flush na partię, nie na wpis
+            if (stopping)
+                return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    size_t ReportLosses(char *line, size_t size)
+    {
+        size_t written = 0;
+        uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0)
+        {
+            std::snprintf(line, size, "[%9.3f] WARN  log: %llu messages dropped (ring full)\n", Seconds(), (unsigned long long)lost);
+            std::fputs(line, stderr);
+            ++written;
+        }
+        for (int c = 0; c < int(LogCategory::Count); ++c)
+        {
+            uint64_t suppressed = categories[c].suppressed.load(std::memory_order_relaxed);
+            if (suppressed == 0 || categories[c].window.load(std::memory_order_relaxed) == int64_t(Seconds()))
+                continue; // Zgłaszane po zamknięciu sekundy
+            categories[c].suppressed.fetch_sub(suppressed, std::memory_order_relaxed);
+            std::snprintf(line, size, "[%9.3f] WARN  %s: %llu messages over rate limit\n", Seconds(),
+                          LogCategoryName(LogCategory(c)), (unsigned long long)suppressed);
+            std::fputs(line, stderr);
+            ++written;
+        }
+        return written;
+    }
+
+    // printf na wątku zapisu: każdy specyfikator formatowany osobno z odpowiednim typem argumentu
+    static void Format(const LogRecord &r, char *line, size_t size)
+    {
+        int n = std::snprintf(line, size, "[%9.3f] %-5s %s: ", r.seconds, LogLevelName(r.level), LogCategoryName(r.category));
+        size_t used = n > 0 ? size_t(n) : 0;
+        int arg = 0;
+        for (const char *f = r.format; *f && used + 1 < size;)
+        {
+            if (*f != '%')
+            {
+                line[used++] = *f++;
+                continue;
+            }
+            if (f[1] == '%')
+            {
+                line[used++] = '%';
+                f += 2;
+                continue;
+            }
+            char spec[16];
+            size_t k = 0;
+            spec[k++] = *f++;
+            while (*f && !std::strchr("diouxXeEfgGcsp", *f) && k < sizeof(spec) - 2)
+                spec[k++] = *f++;
+            char conversion = *f ? *f++ : 's';
+            // Modyfikatory długości są zastępowane własnymi (argumenty są już 64-bitowe)
+            size_t keep = 0;
+            for (size_t m = 0; m < k; ++m)
+            {
+                if (!std::strchr("hlLqjzt", spec[m]))
+                    spec[keep++] = spec[m];
+            }
+            k = keep;
+            int written = 0;
+            size_t room = size - used;
+            if (arg >= r.argCount)
+            {
+                written = std::snprintf(line + used, room, "<?>");
+            }
+            else
+            {
+                const LogRecord::Arg &a = r.args[arg];
+                switch (r.types[arg])
+                {
+                case LogRecord::Int:
+                case LogRecord::Unsigned:
+                    if (conversion == 'c')
+                    {
+                        spec[k++] = 'c';
+                        spec[k] = '\0';
+                        written = std::snprintf(line + used, room, spec, int(a.i));
+                    }
+                    else if (std::strchr("eEfgG", conversion))
+                    {
+                        spec[k++] = conversion;
+                        spec[k] = '\0';
+                        written = std::snprintf(line + used, room, spec, r.types[arg] == LogRecord::Int ? double(a.i) : double(a.u));
+                    }
+                    else
+                    {
+                        spec[k++] = 'l';
+                        spec[k++] = 'l';
+                        spec[k++] = conversion == 's' ? 'd' : conversion;
+                        spec[k] = '\0';
+                        if (r.types[arg] == LogRecord::Int)
+                            written = std::snprintf(line + used, room, spec, (long long)a.i);
+                        else
+                            written = std::snprintf(line + used, room, spec, (unsigned long long)a.u);
+                    }
+                    break;
+                case LogRecord::Double:
+                    spec[k++] = std::strchr("eEfgG", conversion) ? conversion : 'g';
+                    spec[k] = '\0';
+                    written = std::snprintf(line + used, room, spec, a.d);
+                    break;
+                case LogRecord::String:
+                    spec[k++] = 's';
+                    spec[k] = '\0';
+                    written = std::snprintf(line + used, room, spec, r.strings + a.offset);
+                    break;
+                case LogRecord::Pointer:
+                    written = std::snprintf(line + used, room, "%p", a.p);
+                    break;
+                }
+            }
+            ++arg;
+            used += written > 0 ? std::min(size_t(written), room - 1) : 0;
+        }
+        if (used + 1 >= size)
+            used = size - 2;
+        line[used++] = '\n';
+        line[used] = '\0';
+    }
+};
+
+// Wspólny logger procesu (jak GlobalPool)
+inline Logger &GlobalLogger()
+{
+    static Logger logger;
+    return logger;
+}
+
+// Makra: poziom poniżej PHYSICS_LOG_MIN_LEVEL jest usuwany przez kompilator razem z argumentami
+#define PHYSICS_LOG(level, category, ...)                                                                   \
+    do                                                                                                      \
+    {                                                                                                       \
+        if (int(level) >= PHYSICS_LOG_MIN_LEVEL && GlobalLogger().Enabled(level))                           \
+            GlobalLogger().Write(level, category, __VA_ARGS__);                                             \
+    } while (0)
+#define LOG_TRACE(category, ...) PHYSICS_LOG(LogLevel::Trace, LogCategory::category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) PHYSICS_LOG(LogLevel::Debug, LogCategory::category, __VA_ARGS__)
+#define LOG_INFO(category, ...) PHYSICS_LOG(LogLevel::Info, LogCategory::category, __VA_ARGS__)
+#define LOG_WARN(category, ...) PHYSICS_LOG(LogLevel::Warn, LogCategory::category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) PHYSICS_LOG(LogLevel::Error, LogCategory::category, __VA_ARGS__)
@@ -5,22 +5,56 @@
 #include <glm/gtc/matrix_transform.hpp> // GLM: funkcje transformacji
 #include <glm/gtc/type_ptr.hpp> // GLM: dostęp do danych wektorów jako ciąg floatów
 #include <vector> // std::vector: dynamiczna tablica
-#include <iostream> // std::cout, std::cerr
+#include <iostream> // std::cout: raporty trybu headless
+#include <chrono> // std::chrono: pomiar wydajności w trybie headless
+#include <cstring> // std::strcmp
+#include <cstdlib> // std::atoll, std::atof, std::atoi
+#include <cstddef> // offsetof: układ bufora instancji
+#include <cstdio> // std::snprintf: tekst podsumowania profilera
+#include <string> // std::string
+
+#include "simulation.h" // World: fizyka niezależna od okna
+#include "sim_thread.h" // Fizyka na osobnym wątku, migawki i polecenia
+#include "icosphere.h" // Ikosfery LOD dla ciał
+#include "frustum.h" // Odrzucanie ciał poza widokiem
+#include "spacetime_grid.h" // Płaska siatka i ugięcie od mas
+#include "profiler.h" // Czasy faz klatki i zapis śladu
+#include "log.h" // Logowanie asynchroniczne (LOG_INFO, LOG_ERROR, ...)
+#include "checkpoint.h" // Zapis i wczytanie stanu (--load, --save, F5)
+#include "initial_conditions.h" // Generowane sceny do testów skali (--generate)
+#include "trajectory.h" // Nagrywanie i odtwarzanie trajektorii (--record, --play)
+#include "slot_map.h" // Rejestr obiektów z trwałymi uchwytami
+#include "offscreen.h" // Renderowanie bez okna do sekwencji obrazów (--offscreen, --frames)
+#include "shared_state.h" // Eksport stanu ciał do pamięci współdzielonej (--shm)
+#include "bvh.h" // BVH nad ciałami: wybór ciała i zapytania przestrzenne
 
 // Źródło kodu shadera wierzchołków
 const char *vertexShaderSource = R"glsl(
 #version 330 core // Wersja GLSL
-layout(location=0) in vec3 aPos; // Pozycja wierzchołka
+layout(location=0) in vec3 aPos; // Pozycja wierzchołka (płaska siatka albo już ugięta na CPU)
 uniform mat4 model; // Macierz modelu
 uniform mat4 view; // Macierz widoku
 uniform mat4 projection; // Macierz projekcji
+uniform bool deform; // Czy liczyć ugięcie siatki tutaj (false = wierzchołki ugięte na CPU)
+uniform samplerBuffer gridBodies; // Ciała: xyz = pozycja (km), w = promień Schwarzschilda (m)
+uniform int bodyCount; // Liczba ciał w gridBodies
+uniform float verticalShift; // Przesunięcie pionowe siatki
 out float lightIntensity; // Przekazywanie natężenia światła do fragment shadera
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0); // Transformacja pozycji wierzchołka
-    vec3 worldPos = (model * vec4(aPos, 1.0)).xyz; // Pozycja w świecie
-    vec3 normal = normalize(aPos); // Normalna (zakładana ze współrzędnych)
-    vec3 dirToCenter = normalize(-worldPos); // Kierunek do środka układu
-    lightIntensity = max(dot(normal, dirToCenter), 0.15); // Obliczenie natężenia
+    vec3 pos = aPos;
+    if (deform) {
+        // Ta sama kolejność działań co GridDisplacement w spacetime_grid.h
+        float displacement = 0.0;
+        for (int j = 0; j < bodyCount; ++j) {
+            vec4 b = texelFetch(gridBodies, j);
+            float dx = b.x - aPos.x, dy = b.y - aPos.y, dz = b.z - aPos.z;
+            float distance_m = sqrt(dx * dx + dy * dy + dz * dz) * 1000.0;
+            displacement += 2.0 * sqrt(max(b.w * (distance_m - b.w), 0.0)) * 2.0;
+        }
+        pos.y = displacement + verticalShift;
+    }
+    gl_Position = projection * view * model * vec4(pos, 1.0); // Transformacja pozycji wierzchołka
+    lightIntensity = 1.0; // Siatka bez oświetlenia
 })glsl";
 
 // Źródło kodu shadera fragmentów
@@ -44,9 +78,65 @@ void main() {
     }
 })glsl";
 
+// Shader sfer rysowanych instancyjnie: jedna siatka jednostkowa, pozycja/promień/kolor/glow z bufora instancji
+const char *sphereVertexShaderSource = R"glsl(
+#version 330 core // Wersja GLSL
+layout(location=0) in vec3 aPos; // Wierzchołek sfery jednostkowej
+layout(location=1) in vec4 iPosRadius; // Pozycja instancji (xyz) i promień (w)
+layout(location=2) in vec4 iColor; // Kolor instancji
+layout(location=3) in float iGlow; // Flaga glow instancji (0 lub 1)
+uniform mat4 view; // Macierz widoku
+uniform mat4 projection; // Macierz projekcji
+out float lightIntensity; // Natężenie światła dla fragment shadera
+out vec4 objectColor; // Kolor obiektu
+flat out int GLOW; // Flaga efektu poświaty
+void main() {
+    vec3 worldPos = iPosRadius.xyz + aPos * iPosRadius.w; // Skalowanie promieniem i przesunięcie
+    gl_Position = projection * view * vec4(worldPos, 1.0); // Transformacja pozycji wierzchołka
+    vec3 normal = normalize(aPos); // Normalna sfery jednostkowej
+    vec3 dirToCenter = normalize(-worldPos); // Kierunek do środka układu
+    lightIntensity = max(dot(normal, dirToCenter), 0.15); // Obliczenie natężenia
+    objectColor = iColor;
+    GLOW = iGlow > 0.5 ? 1 : 0;
+})glsl";
+
+const char *sphereFragmentShaderSource = R"glsl(
+#version 330 core // Wersja GLSL
+in float lightIntensity; // Wejście z vertex shadera
+in vec4 objectColor; // Kolor obiektu
+flat in int GLOW; // Flaga efektu poświaty
+out vec4 FragColor; // Kolor wyjściowy fragmentu
+void main() {
+    if (GLOW == 1) {
+        FragColor = vec4(objectColor.rgb * 100000, objectColor.a); // Efekt glow
+    } else {
+        float fade = smoothstep(0.0, 10.0, lightIntensity*10); // Wygładzanie
+        FragColor = vec4(objectColor.rgb * fade, objectColor.a); // Kolor z oświetleniem
+    }
+})glsl";
+
+// Nakładka profilera: prostokąty w układzie ekranu (NDC), bez oświetlenia
+const char *overlayVertexShaderSource = R"glsl(
+#version 330 core // Wersja GLSL
+layout(location=0) in vec2 aPos; // Pozycja w NDC
+layout(location=1) in vec4 aColor; // Kolor prostokąta
+out vec4 color;
+void main() {
+    gl_Position = vec4(aPos, 0.0, 1.0);
+    color = aColor;
+})glsl";
+
+const char *overlayFragmentShaderSource = R"glsl(
+#version 330 core // Wersja GLSL
+in vec4 color;
+out vec4 FragColor; // Kolor wyjściowy fragmentu
+void main() {
+    FragColor = color;
+})glsl";
+
 // Flagi sterujące pętlą główną
 bool running = true; // Czy kontynuować program?
-bool pause = true; // Czy symulacja jest zatrzymana?
+bool paused = true; // Czy symulacja jest zatrzymana?
 
 // Wektory kamery
 glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 1.0f); // Pozycja kamery
@@ -62,307 +152,1299 @@ float pitch = 0.0; // Kąt pionowy
 float deltaTime = 0.0; // Czas pomiędzy klatkami
 float lastFrame = 0.0; // Czas ostatniej klatki
 
-// Stałe fizyczne
-const double G = 6.6743e-11; // Stała grawitacyjna (m^3 kg^-1 s^-2)
-const float c = 299792458.0; // Prędkość światła (m/s)
+// Stan symulacji
 float initMass = float(pow(10, 22)); // Masa początkowa obiektu
-float sizeRatio = 30000.0f; // Współczynnik skalowania rozmiaru
+const float kTicksPerSecond = 60.0f; // Ile kroków fizyki na sekundę czasu rzeczywistego
+const int kMaxStepsPerFrame = 8; // Limit nadrabianych kroków naraz (ochrona przed spiralą opóźnień)
+bool placing = false; // Czy ostatnio dodane ciało jest umieszczane (lewy przycisk wciśnięty)
+bool cpuGrid = false; // Ugięcie siatki na CPU (ścieżka referencyjna) zamiast w shaderze
+bool uniformGrid = false; // Jednorodna siatka zamiast adaptacyjnej
+bool profile = false; // Nakładka profilera i czasy faz w tytule okna
+const char *tracePath = nullptr; // Ślad Chrome (JSON) zapisywany przy wyjściu
+const char *traceCsvPath = nullptr; // Te same zdarzenia jako CSV
+const char *loadPath = nullptr; // Checkpoint wczytywany zamiast sceny domyślnej
+const char *savePath = nullptr; // Plik checkpointu (okno: F5, domyślnie kDefaultCheckpoint; headless: zapis na końcu)
+const char *kDefaultCheckpoint = "checkpoint.phys";
+long long checkpointEvery = 0; // Headless: zapis w tle co N kroków (0 = wcale)
+bool generate = false; // Scena z generatora zamiast domyślnej
+GeneratorConfig generator; // Rodzaj, liczba ciał, ziarno i skala generowanej sceny
+const char *recordPath = nullptr; // Nagranie trajektorii
+long long recordEvery = 10; // Klatka nagrania co tyle kroków
+unsigned recordBits = 16; // Bity na współrzędną w nagraniu
+const char *playPath = nullptr; // Odtwarzanie nagrania zamiast symulacji
+double playSpeed = 1.0; // Prędkość odtwarzania (1 = tempo symulacji na żywo; ujemna = wstecz)
+double playCursor = 0.0; // Pozycja odtwarzania (w klatkach nagrania)
+size_t playFrames = 0; // Liczba klatek odtwarzanego nagrania
+int renderWidth = 800, renderHeight = 600; // Rozmiar obrazu (okno albo --offscreen WxH)
+bool offscreen = false; // Renderowanie do plików bez okna
+const char *framesPath = "frame_%05d.png"; // Offscreen: wzorzec nazw klatek (printf z numerem; .png, .ppm albo .raw)
+long long frameCount = 600; // Offscreen: liczba klatek
+int frameSteps = 1; // Offscreen: kroki fizyki na klatkę (1 = tempo okna przy kTicksPerSecond klatkach na sekundę)
+unsigned frameWorkers = 0; // Offscreen: wątki kodujące obrazy (0 = połowa rdzeni, najwyżej 4)
+const char *shmName = nullptr; // Nazwa segmentu POSIX z klatkami stanu dla zewnętrznych czytelników
+unsigned shmSlots = 8; // Klatki w pierścieniu pamięci współdzielonej
 
 // Deklaracje funkcji pomocniczych
-GLFWwindow *StartGLU(); // Inicjalizacja GLFW + GLEW\GLuint CreateShaderProgram(const char *vertexSource, const char *fragmentSource); // Kompilacja i linkowanie shaderów
-void CreateVBOVAO(GLuint &VAO, GLuint &VBO, const float *vertices, size_t vertexCount); // Ustawienie VBO i VAOoid UpdateCam(GLuint shaderProgram, glm::vec3 cameraPos); // Aktualizacja macierzy widoku
+GLFWwindow *StartGLU(); // Inicjalizacja GLFW + GLEW
+bool StartOffscreen(OffscreenContext &context, OffscreenTarget &target); // Kontekst EGL + FBO zamiast okna
+void SetupGLState(); // Wspólne ustawienia OpenGL (głębia, mieszanie, viewport)
+GLuint CreateShaderProgram(const char *vertexSource, const char *fragmentSource); // Kompilacja i linkowanie shaderów
+void CreateVBOVAO(GLuint &VAO, GLuint &VBO, const float *vertices, size_t vertexCount); // Ustawienie VBO i VAO
+glm::mat4 UpdateCam(GLuint shaderProgram, glm::vec3 cameraPos); // Aktualizacja macierzy widoku (zwraca ją)
 void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods); // Obsługa klawiatury
 void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods); // Obsługa przycisków myszy
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset); // Obsługa scrolla myszy
 
 void mouse_callback(GLFWwindow *window, double xpos, double ypos); // Ruch myszy
-glm::vec3 sphericalToCartesian(float r, float theta, float phi); // Konwersja współrzędnych sferycznych
 void DrawGrid(GLuint shaderProgram, GLuint gridVAO, size_t vertexCount); // Rysowanie siatki
 
-// Klasa reprezentująca obiekt fizyczny
+// Klasa reprezentująca wygląd ciała (stan fizyczny żyje w World)
 class Object
 {
 public:
-    GLuint VAO, VBO; // Identyfikatory VAO i VBO w OpenGL
-    glm::vec3 position = glm::vec3(400, 300, 0); // Pozycja początkowa
-    glm::vec3 velocity = glm::vec3(0, 0, 0); // Prędkość początkowa
-    size_t vertexCount; // Ilość współrzędnych w VBO
+    static const size_t kNoBody = ~size_t(0);
+
+    size_t body = kNoBody; // Indeks ciała w bieżącej migawce (kNoBody: jeszcze nie dotarło do symulacji)
+    bool simulated = false; // Czy ciało było już w migawce (zniknięcie oznacza zlepienie)
     glm::vec4 color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f); // Domyślny kolor (czerwony)
 
-    bool Initalizing = false; // Czy w trakcie inicjalizacji
     bool Launched = false; // Czy został wystrzelony
     bool target = false; // Czy jest celem
 
-    float mass; // Masa obiektu
-    float density; // Gęstość (kg/m^3)
-    float radius; // Promień obliczany z masy i gęstości
-
-    glm::vec3 LastPos = position; // Ostatnia zapamiętana pozycja
+    glm::vec3 LastPos; // Ostatnia zapamiętana pozycja
     bool glow; // Czy ma efekt glow
 
-    // Konstruktor inicjalizujący wszystkie pola
-    Object(glm::vec3 initPosition, glm::vec3 initVelocity, float mass, float density = 3344, glm::vec4 color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), bool Glow = false)
+    // Konstruktor inicjalizujący wszystkie pola (same dane; zasoby OpenGL ma renderer: siatka sfery jest wspólna)
+    Object(glm::vec4 color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), bool Glow = false)
     {
-        this->position = initPosition; // Ustaw pozycję
-        this->velocity = initVelocity; // Ustaw prędkość
-        this->mass = mass; // Ustaw masę
-        this->density = density; // Ustaw gęstość
-        this->radius = pow(((3 * this->mass / this->density) / (4 * 3.14159265359)), (1.0f / 3.0f)) / sizeRatio; // Oblicz promień
         this->color = color; // Ustaw kolor
         this->glow = Glow; // Ustaw flagę glow
+    }
+};
 
-        // generate vertices (centered at origin)
-        std::vector<float> vertices = Draw(); // Wygeneruj wierzchołki sfery
-        vertexCount = vertices.size(); // Zapamiętaj liczbę
+// Dane jednej instancji sfery w buforze GPU
+struct SphereInstance
+{
+    float posRadius[4]; // Pozycja (xyz) i promień (w)
+    float color[4]; // Kolor RGBA
+    float glow; // 1 = poświata
+};
 
-        CreateVBOVAO(VAO, VBO, vertices.data(), vertexCount); // Utwórz VAO i VBO
+// Wszystkie ciała rysowane instancyjnie ze wspólnych ikosfer: jedno wywołanie na poziom szczegółowości.
+// Ciała poza ostrosłupem widzenia są odrzucane na CPU, poziom zależy od promienia na ekranie.
+class SphereBatch
+{
+public:
+    GLuint VAO = 0, meshVBO = 0, meshEBO = 0, instanceVBO = 0;
+    size_t capacity = 0; // Pojemność bufora instancji (liczba instancji)
+    float viewportHeight = 600.0f; // Wysokość obrazu w pikselach (do wyboru poziomu)
+    std::vector<SphereInstance> instances; // Widoczne instancje pogrupowane po poziomie
+    size_t levelBegin[kSphereLodLevels + 1] = {}; // Zakres instancji poziomu l: [levelBegin[l], levelBegin[l + 1])
+    size_t culled = 0; // Ile ciał odrzucono w ostatniej klatce
+
+    void Create()
+    {
+        std::vector<float> vertices; // Wszystkie poziomy w jednym VBO/EBO
+        std::vector<uint32_t> indices;
+        for (int l = 0; l < kSphereLodLevels; ++l)
+        {
+            const IndexedMesh &mesh = SphereLodCache()[l];
+            baseVertex[l] = GLint(vertices.size() / 3);
+            firstIndex[l] = indices.size();
+            indexCount[l] = GLsizei(mesh.indices.size());
+            vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+        }
+        CreateVBOVAO(VAO, meshVBO, vertices.data(), vertices.size()); // Atrybut 0: wierzchołek sfery
+        glBindVertexArray(VAO);
+        glGenBuffers(1, &meshEBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &instanceVBO);
+        for (GLuint a = 1; a <= 3; ++a)
+        {
+            glEnableVertexAttribArray(a);
+            glVertexAttribDivisor(a, 1); // Jedna wartość na instancję
+        }
+        glBindVertexArray(0);
     }
 
-    // Generowanie wierzchołków sfery
-    std::vector<float> Draw()
+    // Odrzucenie niewidocznych, wybór poziomu i wysłanie bufora instancji
+    void Upload(const BodyStore &bodies, const SlotMap<Object> &objects, const glm::mat4 &projection, const glm::mat4 &view,
+                const glm::vec3 &eye)
     {
-        std::vector<float> vertices; // Kontener na współrzędne
-        int stacks = 10; // Ilość poziomów
-        int sectors = 10; // Ilość segmentów
+        Cull(bodies, objects, projection, view, eye);
+        UploadInstances();
+    }
 
-        // generate circumference points using integer steps
-        for (float i = 0.0f; i <= stacks; ++i)
+    // Instancje widocznych ciał pogrupowane po poziomie szczegółowości
+    void Cull(const BodyStore &bodies, const SlotMap<Object> &objects, const glm::mat4 &projection, const glm::mat4 &view,
+              const glm::vec3 &eye)
+    {
+        ProfileScope scope("cull");
+        glm::mat4 viewProjection = projection * view;
+        Frustum frustum(glm::value_ptr(viewProjection));
+        float pixelScale = projection[1][1] * viewportHeight * 0.5f; // Piksele na jednostkę promienia w odległości 1
+
+        levelOf.resize(objects.size());
+        size_t count[kSphereLodLevels] = {};
+        culled = 0;
+        for (size_t k = 0; k < objects.size(); ++k)
         {
-            float theta1 = (i / stacks) * glm::pi<float>(); // Kąt pionowy startowy
-            float theta2 = (i + 1) / stacks * glm::pi<float>(); // Kąt pionowy kolejny
-            for (float j = 0.0f; j < sectors; ++j)
+            size_t b = objects.At(k).body;
+            if (b == Object::kNoBody)
             {
-                float phi1 = j / sectors * 2 * glm::pi<float>(); // Kąt poziomy startowy
-                float phi2 = (j + 1) / sectors * 2 * glm::pi<float>(); // Kąt poziomy kolejny
-                glm::vec3 v1 = sphericalToCartesian(this->radius, theta1, phi1); // Punkt 1
-                glm::vec3 v2 = sphericalToCartesian(this->radius, theta1, phi2); // Punkt 2
-                glm::vec3 v3 = sphericalToCartesian(this->radius, theta2, phi1); // Punkt 3
-                glm::vec3 v4 = sphericalToCartesian(this->radius, theta2, phi2); // Punkt 4
-
-                // Triangle 1: v1-v2-v3
-                vertices.insert(vertices.end(), {v1.x, v1.y, v1.z}); // Wierzchołek 1
-                vertices.insert(vertices.end(), {v2.x, v2.y, v2.z}); // Wierzchołek 2
-                vertices.insert(vertices.end(), {v3.x, v3.y, v3.z}); // Wierzchołek 3
-
-                // Triangle 2: v2-v4-v3
-                vertices.insert(vertices.end(), {v2.x, v2.y, v2.z}); // Wierzchołek 2
-                vertices.insert(vertices.end(), {v4.x, v4.y, v4.z}); // Wierzchołek 4
-                vertices.insert(vertices.end(), {v3.x, v3.y, v3.z}); // Wierzchołek 3
+                levelOf[k] = -1;
+                continue;
             }
+            float x = bodies.x[b], y = bodies.y[b], z = bodies.z[b], r = bodies.radius[b];
+            if (!frustum.SphereVisible(x, y, z, r))
+            {
+                levelOf[k] = -1;
+                ++culled;
+                continue;
+            }
+            float distance = glm::length(glm::vec3(x, y, z) - eye);
+            int level = distance > r ? LodForScreenRadius(r * pixelScale / distance) : kSphereLodLevels - 1;
+            levelOf[k] = (signed char)level;
+            ++count[level];
+        }
+        size_t fill[kSphereLodLevels]; // Sortowanie przez zliczanie po poziomie
+        levelBegin[0] = 0;
+        for (int l = 0; l < kSphereLodLevels; ++l)
+        {
+            fill[l] = levelBegin[l];
+            levelBegin[l + 1] = levelBegin[l] + count[l];
+        }
+        instances.resize(levelBegin[kSphereLodLevels]);
+        for (size_t k = 0; k < objects.size(); ++k)
+        {
+            if (levelOf[k] < 0)
+                continue;
+            const Object &obj = objects.At(k);
+            SphereInstance &inst = instances[fill[levelOf[k]]++];
+            inst.posRadius[0] = bodies.x[obj.body];
+            inst.posRadius[1] = bodies.y[obj.body];
+            inst.posRadius[2] = bodies.z[obj.body];
+            inst.posRadius[3] = bodies.radius[obj.body];
+            inst.color[0] = obj.color.r;
+            inst.color[1] = obj.color.g;
+            inst.color[2] = obj.color.b;
+            inst.color[3] = obj.color.a;
+            inst.glow = obj.glow || obj.target ? 1.0f : 0.0f; // Wybrane ciało świeci
         }
-        return vertices; // Zwróć tablicę współrzędnych
     }
 
-    // Aktualizacja pozycji na podstawie prędkości
-    void UpdatePos()
+    // Wysłanie bufora instancji (stary bufor porzucany)
+    void UploadInstances()
+    {
+        ProfileScope scope("upload");
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (instances.size() > capacity)
+            capacity = std::max<size_t>(instances.size(), capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(SphereInstance), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(SphereInstance), instances.data());
+    }
+
+    void Draw() const
+    {
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        GLsizei stride = sizeof(SphereInstance);
+        for (int l = 0; l < kSphereLodLevels; ++l)
+        {
+            GLsizei n = GLsizei(levelBegin[l + 1] - levelBegin[l]);
+            if (n == 0)
+                continue;
+            size_t base = levelBegin[l] * sizeof(SphereInstance); // Atrybuty instancji od początku grupy poziomu
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void *)(base + offsetof(SphereInstance, posRadius)));
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void *)(base + offsetof(SphereInstance, color)));
+            glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void *)(base + offsetof(SphereInstance, glow)));
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount[l], GL_UNSIGNED_INT,
+                                              (void *)(firstIndex[l] * sizeof(uint32_t)), n, baseVertex[l]);
+        }
+        glBindVertexArray(0);
+    }
+
+    void Destroy()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &meshVBO);
+        glDeleteBuffers(1, &meshEBO);
+        glDeleteBuffers(1, &instanceVBO);
+    }
+
+private:
+    GLint baseVertex[kSphereLodLevels] = {}; // Pierwszy wierzchołek poziomu w VBO
+    size_t firstIndex[kSphereLodLevels] = {}; // Pierwszy indeks poziomu w EBO
+    GLsizei indexCount[kSphereLodLevels] = {}; // Liczba indeksów poziomu
+    std::vector<signed char> levelOf; // Poziom obiektu w bieżącej klatce (-1 = odrzucony)
+};
+
+// Czasy GPU z GL_TIMESTAMP: zapytania z kilku ostatnich klatek w pierścieniu, odczyt dopiero gdy gotowe
+// (GL_QUERY_RESULT_AVAILABLE), więc pomiar nigdy nie czeka na GPU. Wyniki trafiają do profilera jako fazy GPU.
+class GpuTimers
+{
+public:
+    static const int kFrames = 4; // Ile klatek może czekać na wynik
+    static const int kScopes = 8; // Zakresy na klatkę
+
+    void Create()
+    {
+        glGenQueries(kFrames * kScopes * 2, &queries[0][0]);
+        GLint64 gpuNow = 0; // Wspólna oś czasu: przesunięcie zegara GPU względem profilera
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        offset = GlobalProfiler().Now() - double(gpuNow) / 1000.0;
+    }
+
+    void Begin(const char *name)
     {
-        this->position[0] += this->velocity[0] / 94; // Przesunięcie x
-        this->position[1] += this->velocity[1] / 94; // Przesunięcie y
-        this->position[2] += this->velocity[2] / 94; // Przesunięcie z
-        this->radius = pow(((3 * this->mass / this->density) / (4 * 3.14159265359)), (1.0f / 3.0f)) / sizeRatio; // Aktualizacja promienia
+        if (!GlobalProfiler().Enabled() || used[slot] >= kScopes)
+            return;
+        names[slot][used[slot]] = name;
+        glQueryCounter(queries[slot][2 * used[slot]], GL_TIMESTAMP);
+        open = true;
     }
-    // Aktualizacja bufora wierzchołków
-    void UpdateVertices()
+
+    void End()
     {
-        // generate new vertices with current radius
-        std::vector<float> vertices = Draw(); // Wygeneruj nowe
+        if (!open)
+            return;
+        glQueryCounter(queries[slot][2 * used[slot] + 1], GL_TIMESTAMP);
+        ++used[slot];
+        open = false;
+    }
 
-        // update VBO with new vertex data
-        glBindBuffer(GL_ARRAY_BUFFER, VBO); // Wybierz VBO
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW); // Załaduj dane
+    // Koniec klatki: odczyt gotowych klatek (od najstarszej) i przejście do następnego miejsca w pierścieniu
+    void EndFrame()
+    {
+        slot = (slot + 1) % kFrames;
+        for (int k = 0; k < kFrames; ++k)
+        {
+            int s = (slot + k) % kFrames; // Od najstarszej
+            if (used[s] == 0)
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[s][2 * used[s] - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+            {
+                if (s == slot) // GPU spóźnia się o cały pierścień: wyniki tej klatki przepadają
+                    used[s] = 0;
+                break; // Późniejsze klatki i tak nie są gotowe
+            }
+            for (int q = 0; q < used[s]; ++q)
+            {
+                GLuint64 begin = 0, end = 0;
+                glGetQueryObjectui64v(queries[s][2 * q], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(queries[s][2 * q + 1], GL_QUERY_RESULT, &end);
+                GlobalProfiler().RecordGpu(names[s][q], double(begin) / 1000.0 + offset, double(end - begin) / 1000.0);
+            }
+            used[s] = 0;
+        }
     }
-    // Zwraca pozycję obiektu
-    glm::vec3 GetPos() const
+
+    void Destroy()
     {
-        return this->position; // Zwróć wektor pozycji
+        glDeleteQueries(kFrames * kScopes * 2, &queries[0][0]);
     }
-    // Dodaje przyspieszenie
-    void accelerate(float x, float y, float z)
+
+private:
+    GLuint queries[kFrames][kScopes * 2] = {}; // Pary (początek, koniec) zakresów
+    const char *names[kFrames][kScopes] = {};
+    int used[kFrames] = {}; // Zakresy zapisane w klatce (0 = nic do odczytu)
+    int slot = 0; // Bieżąca klatka w pierścieniu
+    bool open = false;
+    double offset = 0.0; // Czas profilera (us) = czas GPU (us) + offset
+};
+
+// Nakładka: słupek na klatkę z historii profilera (szary = czas klatki, kolory = fazy, linia = 16.7 ms)
+class ProfilerOverlay
+{
+public:
+    float left = -0.98f, bottom = -0.98f, width = 0.6f, height = 0.4f; // Położenie w NDC
+    float scaleMs = 33.3f; // Czas odpowiadający pełnej wysokości
+
+    void Create()
     {
-        this->velocity[0] += x / 96; // Zmiana prędkości x
-        this->velocity[1] += y / 96; // Zmiana prędkości y
-        this->velocity[2] += z / 96; // Zmiana prędkości z
+        program = CreateShaderProgram(overlayVertexShaderSource, overlayFragmentShaderSource);
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+
+    void Draw(Profiler &profiler)
+    {
+        long long frames = profiler.Snapshot(phases, frameMs);
+        vertices.clear();
+        float column = width / Profiler::kHistory, msToY = height / scaleMs;
+        Rect(left, bottom, width, height, 0.0f, 0.0f, 0.0f, 0.5f); // Tło
+        for (int k = 0; k < Profiler::kHistory && k < frames; ++k)
+        {
+            int slot = int((frames - 1 - k) % Profiler::kHistory); // Od najnowszej (z prawej)
+            float x = left + width - (k + 1) * column;
+            Rect(x, bottom, column, std::min(float(frameMs[slot]), scaleMs) * msToY, 0.4f, 0.4f, 0.4f, 0.8f);
+            float y = bottom;
+            for (size_t p = 0; p < phases.size(); ++p)
+            {
+                float h = float(phases[p].history[slot]) * msToY;
+                if (h <= 0.0f || y >= bottom + height)
+                    continue;
+                h = std::min(h, bottom + height - y);
+                const float *rgb = kPalette[p % kPaletteSize];
+                Rect(x, y, column * 0.8f, h, rgb[0], rgb[1], rgb[2], 0.9f);
+                y += h;
+            }
+        }
+        Rect(left, bottom + 16.7f * msToY, width, 0.003f, 1.0f, 1.0f, 1.0f, 0.8f); // 60 FPS
+
+        glDisable(GL_DEPTH_TEST);
+        glUseProgram(program);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+        glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size() / 6));
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
     }
-    // Sprawdza kolizję z innym obiektem
-    float CheckCollision(const Object &other)
+
+    // Tytuł okna: średnie czasy faz z historii (ms na klatkę)
+    std::string Summary(Profiler &profiler)
     {
-        float dx = other.position[0] - this->position[0]; // Różnica x
-        float dy = other.position[1] - this->position[1]; // Różnica y
-        float dz = other.position[2] - this->position[2]; // Różnica z
-        float distance = std::pow(dx * dx + dy * dy + dz * dz, (1.0f / 2.0f)); // Odległość
-        if (other.radius + this->radius > distance)
+        long long frames = profiler.Snapshot(phases, frameMs);
+        int n = int(std::min<long long>(frames, Profiler::kHistory));
+        if (n == 0)
+            return std::string();
+        auto average = [n](const double *history)
         {
-            return -0.2f; // Kolizja: zmniejszenie prędkości
+            double sum = 0.0;
+            for (int k = 0; k < n; ++k)
+                sum += history[k];
+            return sum / n;
+        };
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "frame %.2f ms", average(frameMs));
+        std::string text = buffer;
+        for (const Profiler::Phase &phase : phases)
+        {
+            std::snprintf(buffer, sizeof(buffer), " | %s%s %.2f", phase.gpu ? "gpu " : "", phase.name, average(phase.history));
+            text += buffer;
         }
-        return 1.0f; // Brak kolizji: brak zmiany
+        return text;
+    }
+
+    void Destroy()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteProgram(program);
+    }
+
+private:
+    static const int kPaletteSize = 8;
+    static constexpr float kPalette[kPaletteSize][3] = {{0.9f, 0.3f, 0.3f}, {0.3f, 0.8f, 0.3f}, {0.3f, 0.5f, 0.9f}, {0.9f, 0.8f, 0.2f},
+                                                        {0.8f, 0.4f, 0.9f}, {0.2f, 0.8f, 0.8f}, {0.9f, 0.6f, 0.3f}, {0.7f, 0.7f, 0.7f}};
+    GLuint program = 0, VAO = 0, VBO = 0;
+    std::vector<Profiler::Phase> phases;
+    double frameMs[Profiler::kHistory] = {};
+    std::vector<float> vertices; // x, y, r, g, b, a (dwa trójkąty na prostokąt)
+
+    void Rect(float x, float y, float w, float h, float r, float g, float b, float a)
+    {
+        const float corners[6][2] = {{x, y}, {x + w, y}, {x + w, y + h}, {x, y}, {x + w, y + h}, {x, y + h}};
+        for (const float *c : corners)
+            vertices.insert(vertices.end(), {c[0], c[1], r, g, b, a});
     }
 };
 
-std::vector<Object> objs = {}; // Kontener obiektów sceny
+World world; // Stan fizyczny sceny (w oknie należy do wątku symulacji)
+SimulationThread sim(world); // Wątek fizyki: polecenia do niego, migawki od niego
+SlotMap<Object> objects; // Wygląd ciał sceny; uchwyt obiektu jest trwałym identyfikatorem ciała (SimSnapshot::ids)
+SlotHandle placingObject = kNoHandle; // Obiekt umieszczanego ciała (uchwyt przeżywa dodawanie i usuwanie innych)
+SlotHandle selectedObject = kNoHandle; // Obiekt wybrany środkowym przyciskiem (Object::target)
+bool pickRequested = false; // Wybór w pętli głównej, gdzie są BVH i macierze kamery
+
+// Wysyła ciało do symulacji i tworzy dla niego obiekt do rysowania; zwraca uchwyt obiektu
+SlotHandle AddObject(const Body &body, glm::vec4 color = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), bool glow = false)
+{
+    SimCommand command{SimCommand::AddBody};
+    command.body = body; // Stan fizyczny
+    command.id = objects.Insert(Object(color, glow)); // Wygląd
+    sim.Push(command);
+    return command.id;
+}
+
+// Dopasowuje obiekty do ciał: indeks ciała każdego obiektu, usunięcie obiektów ciał, które były w symulacji
+// i zniknęły (zlepienia). Obiekty jeszcze nie dodanych ciał czekają z kNoBody. O(N), wyszukanie po uchwycie O(1).
+void SyncObjects(const std::vector<uint64_t> &ids)
+{
+    for (Object &obj : objects)
+        obj.body = Object::kNoBody;
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        if (Object *obj = objects.Get(ids[i]))
+        {
+            obj->body = i;
+            obj->simulated = true;
+        }
+    }
+    for (size_t k = objects.size(); k-- > 0;) // Od końca: usunięcie przenosi na miejsce k obiekt już sprawdzony
+    {
+        if (objects.At(k).body == Object::kNoBody && objects.At(k).simulated)
+            objects.Remove(objects.HandleAt(k));
+    }
+}
+
+// Uchwyty obiektów w kolejności ciał (obiekty z ustawionym Object::body)
+std::vector<uint64_t> ObjectIds(size_t bodyCount)
+{
+    std::vector<uint64_t> ids(bodyCount, kNoHandle);
+    for (size_t k = 0; k < objects.size(); ++k)
+    {
+        size_t b = objects.At(k).body;
+        if (b < bodyCount)
+            ids[b] = objects.HandleAt(k);
+    }
+    return ids;
+}
+
+// Obiekt dla ciała i już obecnego w świecie (checkpoint, generator, nagranie); handle = kNoHandle: nowy uchwyt
+void RestoreObject(size_t i, SlotHandle handle, glm::vec4 color, bool glow)
+{
+    Object obj(color, glow);
+    obj.body = i;
+    obj.simulated = true;
+    if (handle == kNoHandle || objects.InsertAt(handle, obj) == kNoHandle) // Brak albo powtórzony identyfikator
+        objects.Insert(obj);
+}
+
+// Pozycja ciała i jako wektor GLM
+glm::vec3 BodyPos(const BodyStore &bodies, size_t i)
+{
+    return glm::vec3(bodies.x[i], bodies.y[i], bodies.z[i]);
+}
+
+// Promień z kamery przez punkt obrazu (NDC, -1..1). Kierunek z punktu bliskiej płaszczyzny w układzie kamery:
+// odwrócenie całego rzutowania traciłoby precyzję przy dalekiej płaszczyźnie.
+void ScreenRay(const glm::mat4 &projection, const glm::mat4 &view, float ndcX, float ndcY, glm::vec3 &origin, glm::vec3 &dir)
+{
+    glm::vec4 eye = glm::inverse(projection) * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::mat4 camera = glm::inverse(view);
+    glm::vec4 ray = camera * glm::vec4(eye.x, eye.y, eye.z, 0.0f);
+    origin = glm::vec3(camera[3].x, camera[3].y, camera[3].z);
+    dir = glm::normalize(glm::vec3(ray.x, ray.y, ray.z));
+}
+
+const size_t kPickNeighbours = 5; // Sąsiedzi wypisywani przy wyborze ciała
+const float kPickRadius = 100.0f; // Otoczenie wybranego ciała (w jego promieniach)
+
+// Wybór ciała promieniem przez środek obrazu (kursor jest ukryty, celuje środek widoku): Object::target trafionego,
+// w logu jego stan, najbliżsi sąsiedzi i liczba ciał w otoczeniu. ids: uchwyty obiektów w kolejności ciał.
+void PickBody(const BodyBvh &bvh, const BodyStore &bodies, const std::vector<uint64_t> &ids, const glm::mat4 &projection,
+              const glm::mat4 &view)
+{
+    auto start = std::chrono::steady_clock::now();
+    glm::vec3 origin, dir;
+    ScreenRay(projection, view, 0.0f, 0.0f, origin, dir);
+    const float rayOrigin[3] = {origin.x, origin.y, origin.z}, rayDir[3] = {dir.x, dir.y, dir.z};
+    BodyBvh::RayHit hit = bvh.Raycast(bodies, rayOrigin, rayDir);
+    if (Object *previous = objects.Get(selectedObject))
+        previous->target = false;
+    selectedObject = kNoHandle;
+    if (hit.body == BodyBvh::kNone)
+    {
+        LOG_INFO(Input, "pick: no body under the crosshair");
+        return;
+    }
+    const size_t i = hit.body;
+    const float point[3] = {bodies.x[i], bodies.y[i], bodies.z[i]};
+    std::vector<BodyBvh::Neighbour> nearest;
+    bvh.Nearest(bodies, point, kPickNeighbours, nearest, i);
+    std::vector<size_t> around;
+    bvh.WithinRadius(bodies, point, kPickRadius * bodies.radius[i], around);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    selectedObject = i < ids.size() ? ids[i] : kNoHandle;
+    if (Object *obj = objects.Get(selectedObject))
+        obj->target = true;
+    std::string neighbours;
+    for (const BodyBvh::Neighbour &n : nearest)
+    {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "%s%llu at %.0f km", neighbours.empty() ? "" : ", ",
+                      (unsigned long long)(n.body < ids.size() ? ids[n.body] : kNoHandle), n.distance);
+        neighbours += buffer;
+    }
+    float speed = std::sqrt(bodies.vx[i] * bodies.vx[i] + bodies.vy[i] * bodies.vy[i] + bodies.vz[i] * bodies.vz[i]);
+    LOG_INFO(Input, "picked body %llu at %.0f km: mass %g kg, radius %.0f km, speed %g", (unsigned long long)selectedObject, hit.t,
+             bodies.mass[i], bodies.radius[i], speed);
+    LOG_INFO(Input, "body %llu: %zu bodies within %.0f km, nearest %s (queries %.3f ms)", (unsigned long long)selectedObject,
+             around.size() - 1, kPickRadius * bodies.radius[i], neighbours.empty() ? "none" : neighbours.c_str(), ms);
+}
+
+// Wspólny zapis checkpointów w tle (tworzony przy pierwszym użyciu)
+CheckpointWriter &Checkpoints()
+{
+    GlobalLogger(); // Logger ma przeżyć wątek zapisu (statyczne obiekty niszczone w odwrotnej kolejności)
+    static CheckpointWriter writer;
+    return writer;
+}
+
+// Wczytuje checkpoint do świata (przed startem wątku symulacji) i odtwarza wygląd obiektów
+bool LoadCheckpoint(const char *path)
+{
+    MappedCheckpoint file;
+    std::string error;
+    if (!file.Open(path, error))
+    {
+        LOG_ERROR(General, "cannot load checkpoint %s: %s", path, error.c_str());
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    file.LoadInto(world);
+    if (world.precision == Precision::Mixed && !file.Header().hasPrecise)
+        LOG_WARN(General, "checkpoint %s has no double-precision state: mixed precision resumes from float positions", path);
+    const size_t n = file.size();
+    const uint64_t *ids = file.Section<uint64_t>(kSectionId);
+    const float *colors = file.Section<float>(kSectionColor);
+    const unsigned char *glow = file.Section<unsigned char>(kSectionGlow);
+    objects.clear();
+    objects.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        RestoreObject(i, ids[i], glm::vec4(colors[4 * i], colors[4 * i + 1], colors[4 * i + 2], colors[4 * i + 3]), glow[i] != 0);
+    sim.AdoptWorld(ObjectIds(n));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO(General, "loaded checkpoint %s: %zu bodies, time %.1f, step %lld in %.3f s", path, n, world.time, world.stepCount, seconds);
+    return true;
+}
+
+// Generuje scenę wprost do świata (przed startem wątku symulacji); masa centralna świeci jak gwiazda
+void GenerateScene()
+{
+    auto start = std::chrono::steady_clock::now();
+    GenerateBodies(generator, world.bodies);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t n = world.bodies.size();
+    const bool central = generator.kind == InitialConditions::Disk || generator.kind == InitialConditions::Rings;
+    objects.clear();
+    objects.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (central && i == 0)
+            RestoreObject(i, kNoHandle, glm::vec4(1.0f, 0.929f, 0.176f, 1.0f), true);
+        else
+            RestoreObject(i, kNoHandle, glm::vec4(0.0f, 1.0f, 1.0f, 1.0f), false);
+    }
+    sim.AdoptWorld(ObjectIds(n));
+    LOG_INFO(General, "generated %s: %zu bodies, seed %llu in %.3f s", InitialConditionsName(generator.kind), n,
+             (unsigned long long)generator.seed, seconds);
+}
+
+// Klatka nagrania: ciała z wyglądem obiektów (obiekt wskazuje swoje ciało przez Object::body)
+TrajectoryFrame MakeTrajectoryFrame(const BodyStore &bodies, const std::vector<uint64_t> &ids, double time, long long stepCount)
+{
+    TrajectoryFrame frame;
+    frame.bodies = bodies;
+    frame.ids = ids;
+    frame.colors.assign(bodies.size(), PackColor(1.0f, 0.0f, 0.0f, 1.0f)); // Jak domyślny kolor Object
+    frame.glow.assign(bodies.size(), 0);
+    for (const Object &obj : objects)
+    {
+        if (obj.body == Object::kNoBody || obj.body >= bodies.size())
+            continue;
+        frame.colors[obj.body] = PackColor(obj.color.r, obj.color.g, obj.color.b, obj.color.a);
+        frame.glow[obj.body] = obj.glow ? 1 : 0;
+    }
+    frame.time = time;
+    frame.stepCount = stepCount;
+    return frame;
+}
+
+// Obiekty dla ciał klatki nagrania; przebudowa tylko, gdy zmienił się zbiór ciał (zlepienia, nowe ciała)
+void SyncPlaybackObjects(const TrajectoryFrame &frame)
+{
+    bool same = objects.size() == frame.ids.size();
+    for (size_t i = 0; same && i < frame.ids.size(); ++i)
+    {
+        const Object *obj = objects.Get(frame.ids[i]);
+        same = obj && obj->body == i;
+    }
+    if (same)
+        return;
+    objects.clear();
+    for (size_t i = 0; i < frame.ids.size(); ++i)
+    {
+        uint32_t c = frame.colors[i];
+        RestoreObject(i, frame.ids[i], glm::vec4(ColorChannel(c, 0), ColorChannel(c, 1), ColorChannel(c, 2), ColorChannel(c, 3)), frame.glow[i] != 0);
+    }
+}
+
+// Stan do checkpointu: ciała z identyfikatorami i wyglądem obiektów (obiekt wskazuje swoje ciało przez Object::body).
+// precise: stan w double tych samych ciał (tryb mieszany, zapis wprost ze świata); migawki go nie mają.
+CheckpointData MakeCheckpointData(const BodyStore &bodies, const std::vector<uint64_t> &ids, double time, long long stepCount,
+                                  const PreciseState *precise = nullptr)
+{
+    CheckpointData data;
+    data.bodies = bodies;
+    data.ids = ids;
+    data.colors.assign(4 * bodies.size(), 1.0f);
+    data.glow.assign(bodies.size(), 0);
+    for (const Object &obj : objects)
+    {
+        if (obj.body == Object::kNoBody || obj.body >= bodies.size())
+            continue;
+        for (int c = 0; c < 4; ++c)
+            data.colors[4 * obj.body + c] = obj.color[c];
+        data.glow[obj.body] = obj.glow ? 1 : 0;
+    }
+    data.time = time;
+    data.stepCount = stepCount;
+    data.SettingsFrom(world); // Ustawienia nie zmieniają się w trakcie działania wątku symulacji
+    if (precise && precise->size() == bodies.size())
+        data.precise = *precise;
+    return data;
+}
+
+SharedStateWriter &SharedState()
+{
+    static SharedStateWriter writer; // Usuwa segment przy wyjściu
+    return writer;
+}
+
+// Stan ciał do pierścienia w pamięci współdzielonej (wątek fizyki albo pętla headless); bez --shm nic nie robi
+void ExportState(const BodyStore &bodies, const std::vector<uint64_t> &ids, double time, long long stepCount)
+{
+    if (!SharedState().IsOpen())
+        return;
+    SharedFrameSource source = {bodies.x.data(), bodies.y.data(), bodies.z.data(), bodies.vx.data(), bodies.vy.data(),
+                                bodies.vz.data(), bodies.mass.data(), ids.data(), bodies.size(), time, stepCount};
+    if (!SharedState().Publish(source))
+    {
+        LOG_ERROR(General, "shared memory export stopped");
+        SharedState().Close();
+    }
+}
+
+// Zapis w tle ostatniej migawki z wyglądem obiektów (okno, F5)
+void SaveCheckpoint(const SimSnapshot &snap, const char *path)
+{
+    Checkpoints().Submit(MakeCheckpointData(snap.bodies, snap.ids, snap.time, snap.stepCount), path);
+}
 
 // Deklaracje funkcji do siatki
-std::vector<float> CreateGridVertices(float size, int divisions, const std::vector<Object> &objs);
-std::vector<float> UpdateGridVertices(std::vector<float> vertices, const std::vector<Object> &objs);
 
-GLuint gridVAO, gridVBO; // VAO i VBO dla siatki
+// Tryb bez okna: symulacja sceny tak szybko, jak pozwala CPU
+int RunHeadless(long long steps, bool checkSolver, float dt, long long reportEvery, TrajectoryRecorder &recorder);
+// Wypisuje błąd Barnesa-Huta względem sumy bezpośredniej
+void PrintSolverCheck(const World &world);
+// Zapis śladu profilera (--trace, --trace-csv)
+void WriteProfile();
+
+GLuint gridVAO, gridVBO; // VAO i VBO dla siatki (płaska siatka, wysyłana przy zmianie podziału)
+GLuint gridBodiesBuffer, gridBodiesTexture; // Bufor tekstury z ciałami dla shadera siatki
+const float kGridSize = 20000.0f; // Bok siatki (km)
+const int kGridDivisions = 25; // Liczba podziałów siatki
 
-int main()
+int main(int argc, char **argv)
 {
-    GLFWwindow *window = StartGLU(); // Inicjalizacja okna i kontekstu OpenGL
+    // Argumenty: --headless [--steps N] [--solver direct|bh|pm] [--theta T] [--check-bh] [--threads N]
+    //           [--pm-grid M] [--pm-periodic BOX] [--pm-p3m]
+    //           [--integrator euler|leapfrog|yoshida4|forest-ruth|hermite] [--eta E] [--dt T] [--report N] [--precision single|mixed]
+    //           [--collisions bounce|merge] [--cpu-grid] [--uniform-grid] [--profile] [--trace F.json] [--trace-csv F.csv]
+    //           [--log-level trace|debug|info|warn|error] [--log-rate N] [--log-sample CATEGORY N]
+    //           [--load F] [--save F] [--checkpoint-every N]
+    //           [--generate plummer|disk|collapse|rings] [--count N] [--seed S] [--scale KM]
+    //           [--record F] [--record-every K] [--record-bits B] [--play F] [--speed S]
+    //           [--offscreen WxH] [--frames PATTERN] [--frame-count N] [--frame-steps K] [--frame-workers N]
+    //           [--shm NAME] [--shm-slots N]
+    bool headless = false; // Czy uruchomić bez okna
+    long long headlessSteps = 100000; // Liczba kroków w trybie headless
+    bool checkSolver = false; // Czy porównać Barnesa-Huta z sumą bezpośrednią
+    float headlessDt = kFixedDt; // Krok w trybie headless (w tickach)
+    long long reportEvery = 0; // Co ile kroków raportować dryf energii i momentu pędu (0 = wcale)
+    for (int i = 1; i + 1 < argc; ++i) // Checkpoint najpierw: pozostałe argumenty nadpisują jego ustawienia
+    {
+        if (std::strcmp(argv[i], "--load") == 0)
+            loadPath = argv[++i];
+    }
+    if (loadPath && !LoadCheckpoint(loadPath))
+        return 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+            headlessSteps = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--solver") == 0 && i + 1 < argc)
+            world.solver = ForceSolverFromName(argv[++i]);
+        else if (std::strcmp(argv[i], "--pm-grid") == 0 && i + 1 < argc)
+            world.mesh.grid = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--pm-periodic") == 0 && i + 1 < argc)
+        {
+            world.mesh.boundary = MeshBoundary::Periodic;
+            world.mesh.box = float(std::atof(argv[++i])); // 0 = sześcian obejmujący ciała
+        }
+        else if (std::strcmp(argv[i], "--pm-p3m") == 0)
+            world.mesh.shortRange = true;
+        else if (std::strcmp(argv[i], "--theta") == 0 && i + 1 < argc)
+            world.theta = float(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--check-bh") == 0)
+            checkSolver = true;
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            GlobalPool().Resize(unsigned(std::atoi(argv[++i]))); // 0 = wszystkie rdzenie
+        else if (std::strcmp(argv[i], "--integrator") == 0 && i + 1 < argc)
+            world.integrator = IntegratorFromName(argv[++i]);
+        else if (std::strcmp(argv[i], "--precision") == 0 && i + 1 < argc)
+            world.precision = PrecisionFromName(argv[++i]);
+        else if (std::strcmp(argv[i], "--eta") == 0 && i + 1 < argc)
+            world.hermite.eta = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--collisions") == 0 && i + 1 < argc)
+        {
+            ++i;
+            world.collisionResponse = std::strcmp(argv[i], "merge") == 0 ? CollisionResponse::Merge : CollisionResponse::Bounce;
+        }
+        else if (std::strcmp(argv[i], "--cpu-grid") == 0)
+            cpuGrid = true;
+        else if (std::strcmp(argv[i], "--uniform-grid") == 0)
+            uniformGrid = true;
+        else if (std::strcmp(argv[i], "--log-level") == 0 && i + 1 < argc)
+            GlobalLogger().SetLevel(LogLevelFromName(argv[++i]));
+        else if (std::strcmp(argv[i], "--log-rate") == 0 && i + 1 < argc)
+            GlobalLogger().SetRateLimitAll(unsigned(std::atoi(argv[++i]))); // Wpisów na sekundę na kategorię (0 = bez limitu)
+        else if (std::strcmp(argv[i], "--log-sample") == 0 && i + 2 < argc)
+        {
+            LogCategory category = LogCategoryFromName(argv[++i]);
+            unsigned every = unsigned(std::atoi(argv[++i]));
+            if (category != LogCategory::Count)
+                GlobalLogger().SetSampling(category, every); // Co N-ty wpis kategorii
+        }
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            profile = true;
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (std::strcmp(argv[i], "--trace-csv") == 0 && i + 1 < argc)
+            traceCsvPath = argv[++i];
+        else if (std::strcmp(argv[i], "--dt") == 0 && i + 1 < argc)
+            headlessDt = float(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--report") == 0 && i + 1 < argc)
+            reportEvery = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--load") == 0 && i + 1 < argc)
+            ++i; // Wczytane wyżej
+        else if (std::strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+            savePath = argv[++i];
+        else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc)
+            checkpointEvery = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--generate") == 0 && i + 1 < argc)
+        {
+            generate = InitialConditionsFromName(argv[++i], generator.kind);
+            if (!generate)
+                LOG_ERROR(General, "unknown generator %s (plummer, disk, collapse, rings)", argv[i]);
+        }
+        else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+            generator.count = size_t(std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            generator.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+            generator.scale = float(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--record-every") == 0 && i + 1 < argc)
+            recordEvery = std::max(1LL, std::atoll(argv[++i]));
+        else if (std::strcmp(argv[i], "--record-bits") == 0 && i + 1 < argc)
+            recordBits = unsigned(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--play") == 0 && i + 1 < argc)
+            playPath = argv[++i];
+        else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc)
+            playSpeed = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--offscreen") == 0 && i + 1 < argc)
+        {
+            offscreen = true;
+            if (std::sscanf(argv[++i], "%dx%d", &renderWidth, &renderHeight) != 2 || renderWidth <= 0 || renderHeight <= 0)
+            {
+                LOG_ERROR(Render, "bad size %s (expected WxH, e.g. 1920x1080)", argv[i]);
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            offscreen = true;
+            framesPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--frame-count") == 0 && i + 1 < argc)
+            frameCount = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--frame-steps") == 0 && i + 1 < argc)
+            frameSteps = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--frame-workers") == 0 && i + 1 < argc)
+            frameWorkers = unsigned(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--shm") == 0 && i + 1 < argc)
+            shmName = argv[++i];
+        else if (std::strcmp(argv[i], "--shm-slots") == 0 && i + 1 < argc)
+            shmSlots = unsigned(std::atoi(argv[++i]));
+    }
+    if (profile || tracePath || traceCsvPath)
+        GlobalProfiler().Enable(tracePath || traceCsvPath); // Pojedyncze zdarzenia tylko do zapisu śladu
+    if (generate && !loadPath)
+        GenerateScene(); // Po argumentach: --threads dotyczy też generatora
+    TrajectoryPlayer player; // Odtwarzanie: bez fizyki, ciała z nagrania
+    if (playPath)
+    {
+        std::string error;
+        if (!player.Open(playPath, error))
+        {
+            LOG_ERROR(General, "cannot play %s: %s", playPath, error.c_str());
+            return 1;
+        }
+        LOG_INFO(General, "playing %s: %zu frames, %u steps per frame", playPath, player.size(), player.Header().stepsPerFrame);
+        playFrames = player.size();
+        headless = false;
+    }
+    TrajectoryRecorder recorder; // Nagrywanie z migawek (okno) albo wprost ze świata (headless)
+    if (recordPath && !playPath && !recorder.Open(recordPath, uint32_t(recordEvery), headless ? headlessDt : kFixedDt, recordBits))
+    {
+        LOG_ERROR(General, "cannot record to %s", recordPath);
+        return 1;
+    }
+    if (shmName)
+    {
+        std::string error;
+        if (!SharedState().Create(shmName, world.bodies.size() + 1024, shmSlots, error)) // Zapas na dodawane ciała
+        {
+            LOG_ERROR(General, "cannot export state to %s: %s", shmName, error.c_str());
+            return 1;
+        }
+        LOG_INFO(General, "exporting state to shared memory %s (%u frames)", shmName, shmSlots);
+        sim.onStep = [](const World &w, const std::vector<uint64_t> &ids)
+        { ExportState(w.bodies, ids, w.time, w.stepCount); };
+    }
+    if (headless)
+        return RunHeadless(headlessSteps, checkSolver, headlessDt, reportEvery, recorder); // Bez kontekstu OpenGL
+
+    GLFWwindow *window = nullptr; // Okno; nullptr w trybie offscreen
+    OffscreenContext offscreenContext; // Offscreen: kontekst EGL, FBO, odczyt przez PBO i kodowanie w tle
+    OffscreenTarget target;
+    PboReadback readback;
+    ImageSequenceWriter frameWriter;
+    if (offscreen)
+    {
+        if (!StartOffscreen(offscreenContext, target))
+            return 1;
+        if (!frameWriter.Open(framesPath, renderWidth, renderHeight, frameWorkers))
+        {
+            LOG_ERROR(Render, "bad frame pattern %s (expected one %%d, e.g. frame_%%05d.png)", framesPath);
+            return 1;
+        }
+        readback.Create(renderWidth, renderHeight);
+        paused = false; // Bez klawiatury: film od razu z ruchem
+        sim.lockstepSteps = frameSteps; // Klatka co frameSteps kroków, fizyka następnej klatki w trakcie rysowania bieżącej
+    }
+    else
+        window = StartGLU(); // Inicjalizacja okna i kontekstu OpenGL
     GLuint shaderProgram = CreateShaderProgram(vertexShaderSource, fragmentShaderSource); // Kompilacja shaderów
+    GLuint sphereProgram = CreateShaderProgram(sphereVertexShaderSource, sphereFragmentShaderSource); // Shader sfer
+    SphereBatch spheres; // Wspólna siatka sfery i bufor instancji
+    spheres.Create();
+    spheres.viewportHeight = float(renderHeight);
+    GpuTimers gpuTimers; // Czasy rysowania na GPU (odczyt z opóźnieniem)
+    gpuTimers.Create();
+    ProfilerOverlay overlay; // Wykres faz w rogu ekranu
+    if (profile)
+        overlay.Create();
+    double lastTitle = 0.0; // Ostatnia zmiana tytułu okna (s)
 
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model"); // Lokalizacja uniformu model
     GLint objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor"); // Lokalizacja uniformu color
     glUseProgram(shaderProgram); // Użycie programu shaderów
 
-    glfwSetCursorPosCallback(window, mouse_callback); // Ustaw callback ruchu myszy
-    glfwSetScrollCallback(window, scroll_callback); // Callback scroll
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // Ukrycie kursora
+    if (window)
+    {
+        glfwSetCursorPosCallback(window, mouse_callback); // Ustaw callback ruchu myszy
+        glfwSetScrollCallback(window, scroll_callback); // Callback scroll
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // Ukrycie kursora
+    }
 
     // projection matrix
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 750000.0f); // Macierz projekcji
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), float(renderWidth) / float(renderHeight), 0.1f, 750000.0f); // Macierz projekcji
     GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection"); // Lokalizacja uniformu projection
     glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection)); // Przesłanie macierzy do GPU
+    glUseProgram(sphereProgram);
+    glUniformMatrix4fv(glGetUniformLocation(sphereProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
     cameraPos = glm::vec3(0.0f, 1000.0f, 5000.0f); // Ustawienie początkowej pozycji kamery
 
-    objs = {
-        Object(glm::vec3(-5000, 650, -350), glm::vec3(0, 0, 1500), 5.97219 * pow(10, 22), 5515, glm::vec4(0.0f, 1.0f, 1.0f, 1.0f)), // Pierwszy obiekt
-        Object(glm::vec3(5000, 650, -350), glm::vec3(0, 0, -1500), 5.97219 * pow(10, 22), 5515, glm::vec4(0.0f, 1.0f, 1.0f, 1.0f)), // Drugi obiekt
-        Object(glm::vec3(0, 0, -350), glm::vec3(0, 0, 0), 1.989 * pow(10, 25), 5515, glm::vec4(1.0f, 0.929f, 0.176f, 1.0f), true), // Obiekt glow
-    };
-    std::vector<float> gridVertices = CreateGridVertices(20000.0f, 25, objs); // Generuj wierzchołki siatki
+    if (world.bodies.empty() && !playPath) // Scena domyślna, chyba że ciała przyszły z checkpointu, generatora albo nagrania
+    {
+        for (const SceneBody &sb : DefaultScene())
+            AddObject(sb.body, glm::vec4(sb.color[0], sb.color[1], sb.color[2], sb.color[3]), sb.glow);
+    }
+    sim.ApplyCommands(); // Scena trafia do świata przed startem wątku
+    if (checkSolver)
+        PrintSolverCheck(world); // Dokładność Barnesa-Huta albo siatki na scenie startowej
+    SimCommand pauseCommand{SimCommand::SetPaused};
+    pauseCommand.value[0] = paused ? 1.0f : 0.0f;
+    sim.Push(pauseCommand);
+    sim.ticksPerSecond = kTicksPerSecond;
+    sim.maxStepsPerTick = kMaxStepsPerFrame;
+    BodyStore display; // Ciała do narysowania: migawka z pozycjami interpolowanymi na chwilę klatki
+    long long nextRecordStep = 0; // Krok, od którego nagrywana jest następna migawka
+    if (playPath)
+        SyncPlaybackObjects(player.Sample(playCursor, display));
+    else
+    {
+        sim.Start(); // Od teraz world należy do wątku symulacji
+        sim.Acquire();
+        InterpolateSnapshot(sim.Latest(), SimClockSeconds(), display);
+    }
+
+    AdaptiveGrid adaptiveGrid; // Siatka zagęszczana przy masywnych ciałach
+    adaptiveGrid.size = kGridSize;
+    adaptiveGrid.tiles = kGridDivisions;
+    std::vector<float> gridVertices = CreateGridVertices(kGridSize, kGridDivisions); // Płaska siatka jednorodna
+    if (!uniformGrid)
+    {
+        adaptiveGrid.Update(display, RenderPool());
+        gridVertices = adaptiveGrid.Vertices();
+    }
     CreateVBOVAO(gridVAO, gridVBO, gridVertices.data(), gridVertices.size()); // Utwórz VAO/VBO siatki
+    std::vector<float> gridBodies, deformedGrid; // Ciała dla siatki; ugięta siatka (tylko ścieżka CPU)
+    glGenBuffers(1, &gridBodiesBuffer);
+    glGenTextures(1, &gridBodiesTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, gridBodiesTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, gridBodiesBuffer);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, gridBodiesBuffer);
+    glUseProgram(shaderProgram);
+    glUniform1i(glGetUniformLocation(shaderProgram, "gridBodies"), 0); // Jednostka tekstury 0
 
-    while (!glfwWindowShouldClose(window) && running == true) // Główna pętla
+    BodyBvh bvh; // Hierarchia nad ciałami display: wybór ciała środkowym przyciskiem
+    long long frameIndex = 0; // Numer klatki (offscreen: numer pliku)
+    auto renderStart = std::chrono::steady_clock::now();
+    while ((window ? !glfwWindowShouldClose(window) : frameIndex < frameCount) && running == true) // Główna pętla
     {
-        float currentFrame = glfwGetTime(); // Pobierz czas od startu
+        float currentFrame = window ? float(glfwGetTime()) : float(frameIndex) / kTicksPerSecond; // Offscreen: czas filmu, nie zegara
         deltaTime = currentFrame - lastFrame; // Oblicz deltaTime
         lastFrame = currentFrame; // Zaktualizuj lastFrame
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Wyczyść bufor koloru i głębi
 
-        glfwSetKeyCallback(window, keyCallback); // Callback klawiatury
-        glfwSetMouseButtonCallback(window, mouseButtonCallback); // Callback myszy
-        UpdateCam(shaderProgram, cameraPos); // Zaktualizuj widok kamery
+        if (window)
+        {
+            glfwSetKeyCallback(window, keyCallback); // Callback klawiatury
+            glfwSetMouseButtonCallback(window, mouseButtonCallback); // Callback myszy
+        }
+        glm::mat4 view = UpdateCam(shaderProgram, cameraPos); // Zaktualizuj widok kamery
+
+        if (placing && window && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) // Prawy przycisk
+        {
+            // increase mass by 1% per second
+            SimCommand grow{SimCommand::GrowPlacing};
+            grow.id = placingObject;
+            grow.value[0] = 1.0f + 1.0f * deltaTime; // Zwiększ masę
+            sim.Push(grow);
+        }
 
-        if (!objs.empty() && objs.back().Initalizing) // Jeśli ostatni obiekt jest inicjalizowany
+        const std::vector<uint64_t> *displayIds = nullptr; // Uchwyty obiektów w kolejności ciał display
+        if (playPath) // Odtwarzanie: pozycja w nagraniu z tempa symulacji na żywo razy prędkość
         {
-            if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) // Prawy przycisk
+            double last = double(player.size() - 1);
+            if (!paused)
+                playCursor += deltaTime * playSpeed * kTicksPerSecond / (player.Header().stepsPerFrame * player.Header().dt);
+            playCursor = std::min(std::max(playCursor, 0.0), last);
+            const TrajectoryFrame &frame = player.Sample(playCursor, display);
+            SyncPlaybackObjects(frame);
+            displayIds = &frame.ids;
+        }
+        else // Fizyka liczy się na swoim wątku; tu tylko najnowsza migawka i interpolacja na chwilę klatki
+        {
+            bool fresh = true;
+            if (window)
+                fresh = sim.Acquire();
+            else
+                sim.AcquireNext(); // Offscreen: każda klatka to kolejna migawka, bez gubienia i powtórzeń
+            const SimSnapshot &snap = sim.Latest();
+            SyncObjects(snap.ids); // Obiekty ciał pochłoniętych przy zlepieniu
+            displayIds = &snap.ids;
+            InterpolateSnapshot(snap, window ? SimClockSeconds() : snap.published + snap.interval, display); // Offscreen: stan migawki
+            if (recordPath && fresh && snap.stepCount >= nextRecordStep) // Migawki co kilka kroków: nagranie najbliższej
             {
-                // increase mass by 1% per second
-                objs.back().mass *= 1.0 + 1.0 * deltaTime; // Zwiększ masę
-                // update radius based on new mass
-                objs.back().radius = pow((3 * objs.back().mass / objs.back().density) / (4 * 3.14159265359f), 1.0f / 3.0f) / sizeRatio; // Zaktualizuj promień
-                // update vertex data
-                objs.back().UpdateVertices(); // Przeładuj wierzchołki
+                recorder.Submit(MakeTrajectoryFrame(snap.bodies, snap.ids, snap.time, snap.stepCount));
+                nextRecordStep = (snap.stepCount / recordEvery + 1) * recordEvery;
             }
         }
 
+        if (window) // BVH do wyboru ciał: refit granic co klatkę, budowa od nowa po zmianie liczby ciał albo rozjechaniu drzewa
+        {
+            ProfileScope scope("bvh");
+            bvh.Update(display, RenderPool());
+        }
+        if (Object *obj = objects.Get(selectedObject)) // Odtwarzanie odtwarza obiekty od nowa przy zmianie zbioru ciał
+            obj->target = true;
+        if (pickRequested)
+        {
+            PickBody(bvh, display, *displayIds, projection, view);
+            pickRequested = false;
+        }
+
         // Draw the grid
         glUseProgram(shaderProgram); // Użyj programu shaderów
         glUniform4f(objectColorLoc, 1.0f, 1.0f, 1.0f, 0.25f); // Ustaw kolor siatki
         glUniform1i(glGetUniformLocation(shaderProgram, "isGrid"), 1); // Flaga siatki
         glUniform1i(glGetUniformLocation(shaderProgram, "GLOW"), 0); // Wyłącz glow
-        gridVertices = UpdateGridVertices(gridVertices, objs); // Zaktualizuj wierzchołki siatki
-        glBindBuffer(GL_ARRAY_BUFFER, gridVBO); // Wybierz bufor siatki
-        glBufferData(GL_ARRAY_BUFFER, gridVertices.size() * sizeof(float), gridVertices.data(), GL_DYNAMIC_DRAW); // Załaduj nowe dane
-        DrawGrid(shaderProgram, gridVAO, gridVertices.size()); // Narysuj siatkę
-
-        // Draw the triangles / sphere
-        for (auto &obj : objs) // Iteracja po obiektach
+        bool gridChanged = false;
+        float verticalShift = 0.0f;
         {
-            glUniform4f(objectColorLoc, obj.color.r, obj.color.g, obj.color.b, obj.color.a); // Ustaw kolor obiektu
-
-            for (auto &obj2 : objs) // Iteracja po parach obiektów
+            ProfileScope scope("grid"); // Siatka na CPU: kafle, ciała dla shadera, przesunięcie (i ugięcie w ścieżce CPU)
+            gridChanged = !uniformGrid && adaptiveGrid.Update(display, RenderPool()); // Przebudowa kafli, przy których ruszyły się ciała
+            if (gridChanged)
+                gridVertices = adaptiveGrid.Vertices();
+            PackGridBodies(display, gridBodies); // Pozycje i rs ciał (4 floaty na ciało)
+            verticalShift = GridVerticalShift(display, gridBodies, kGridSize, kGridDivisions, gridVertices[1]);
+            if (cpuGrid) // Referencja: ugięcie na CPU
+                DeformGridCPU(gridVertices, gridBodies, verticalShift, deformedGrid, RenderPool());
+        }
+        {
+            ProfileScope scope("upload");
+            if (cpuGrid) // Ścieżka CPU wysyła całą ugiętą siatkę
             {
-                if (&obj2 != &obj && !obj.Initalizing && !obj2.Initalizing) // Pomijaj ten sam obiekt
-                {
-                    float dx = obj2.GetPos()[0] - obj.GetPos()[0]; // Różnica x
-                    float dy = obj2.GetPos()[1] - obj.GetPos()[1]; // Różnica y
-                    float dz = obj2.GetPos()[2] - obj.GetPos()[2]; // Różnica z
-                    float distance = sqrt(dx * dx + dy * dy + dz * dz); // Odległość
-
-                    if (distance > 0) // Jeśli nie nachodzą na siebie
-                    {
-                        std::vector<float> direction = {dx / distance, dy / distance, dz / distance}; // Kierunek normalizowany
-                        distance *= 1000; // Konwersja do metrów
-                        double Gforce = (G * obj.mass * obj2.mass) / (distance * distance); // Siła grawitacji
-
-                        float acc1 = Gforce / obj.mass; // Przyspieszenie
-                        std::vector<float> acc = {direction[0] * acc1, direction[1] * acc1, direction[2] * acc1}; // Wektor przyspieszenia
-                        if (!pause) // Jeśli nie pauza
-                        {
-                            obj.accelerate(acc[0], acc[1], acc[2]); // Zastosuj przyspieszenie
-                        }
-
-                        // collision
-                        obj.velocity *= obj.CheckCollision(obj2); // Sprawdzenie i reakcja na kolizję
-                        std::cout << "radius: " << obj.radius << std::endl; // Debug: promień
-                    }
-                }
+                glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+                glBufferData(GL_ARRAY_BUFFER, deformedGrid.size() * sizeof(float), deformedGrid.data(), GL_DYNAMIC_DRAW);
             }
-            if (obj.Initalizing) // Jeśli inicjalizacja obiektu
+            else // Ugięcie w shaderze: płaska siatka tylko po zmianie podziału, ciała co klatkę
             {
-                obj.radius = pow(((3 * obj.mass / obj.density) / (4 * 3.14159265359)), (1.0f / 3.0f)) / 1000000; // Mały promień podczas inicjalizacji
-                obj.UpdateVertices(); // Przeładuj wierzchołki
+                if (gridChanged)
+                {
+                    glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+                    glBufferData(GL_ARRAY_BUFFER, gridVertices.size() * sizeof(float), gridVertices.data(), GL_DYNAMIC_DRAW);
+                }
+                glBindBuffer(GL_TEXTURE_BUFFER, gridBodiesBuffer);
+                glBufferData(GL_TEXTURE_BUFFER, gridBodies.size() * sizeof(float), gridBodies.data(), GL_STREAM_DRAW);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_BUFFER, gridBodiesTexture);
+                glUniform1i(glGetUniformLocation(shaderProgram, "bodyCount"), GLint(display.size()));
+                glUniform1f(glGetUniformLocation(shaderProgram, "verticalShift"), verticalShift);
             }
+        }
+        glUniform1i(glGetUniformLocation(shaderProgram, "deform"), cpuGrid ? 0 : 1);
+        {
+            ProfileScope scope("draw");
+            gpuTimers.Begin("grid");
+            DrawGrid(shaderProgram, gridVAO, gridVertices.size()); // Narysuj siatkę
+            gpuTimers.End();
+        }
 
-            // update positions
-            if (!pause) // Jeśli nie pauza
-            {
-                obj.UpdatePos(); // Zaktualizuj pozycję
-            }
+        // Draw the triangles / sphere: wszystkie ciała jednym wywołaniem
+        view = UpdateCam(sphereProgram, cameraPos); // Macierz widoku dla shadera sfer
+        spheres.Upload(display, objects, projection, view, cameraPos);
+        {
+            ProfileScope scope("draw");
+            gpuTimers.Begin("spheres");
+            spheres.Draw();
+            gpuTimers.End();
+        }
 
-            glm::mat4 model = glm::mat4(1.0f); // Identity matrix
-            model = glm::translate(model, obj.position); // apply position
-            glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model)); // Przesyłanie macierzy modelu
-            glUniform1i(glGetUniformLocation(shaderProgram, "isGrid"), 0); // Wyłącz siatkę dla rysowania obiektu
-            if (obj.glow) // Jeśli glow
-            {
-                glUniform1i(glGetUniformLocation(shaderProgram, "GLOW"), 1); // Włącz glow
-            }
-            else
+        if (profile)
+            overlay.Draw(GlobalProfiler());
+        if (window && (profile || playPath) && currentFrame - lastTitle > 0.5) // Liczby w tytule okna, dwa razy na sekundę
+        {
+            std::string title = "3D_TEST";
+            if (playPath)
             {
-                glUniform1i(glGetUniformLocation(shaderProgram, "GLOW"), 0); // Wyłącz glow
+                char buffer[96];
+                const TrajectoryFrame &frame = player.Frame(size_t(playCursor));
+                std::snprintf(buffer, sizeof(buffer), " | frame %zu/%zu, step %lld, speed %gx", size_t(playCursor) + 1, player.size(),
+                              frame.stepCount, playSpeed);
+                title += buffer;
             }
-
-            glBindVertexArray(obj.VAO); // Wybierz VAO obiektu
-            glDrawArrays(GL_TRIANGLES, 0, obj.vertexCount / 3); // Narysuj trójkąty
+            if (profile)
+                title += " | " + overlay.Summary(GlobalProfiler());
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitle = currentFrame;
         }
-
-        glfwSwapBuffers(window); // Zamiana buforów
-        glfwPollEvents(); // Obsługa zdarzeń
+        if (window)
+            glfwSwapBuffers(window); // Zamiana buforów
+        else
+        {
+            ProfileScope scope("readback");
+            readback.Capture(target, frameIndex, frameWriter); // Odczyt w tle; do zapisu idzie klatka sprzed kRing - 1
+        }
+        ++frameIndex;
+        gpuTimers.EndFrame(); // Odczyt gotowych czasów GPU z poprzednich klatek
+        GlobalProfiler().EndFrame();
+        if (window)
+            glfwPollEvents(); // Obsługa zdarzeń
     }
-
-    // Cleanup: usuwanie VAO i VBO wszystkich obiektów
-    for (auto &obj : objs)
+    if (offscreen)
     {
-        glDeleteVertexArrays(1, &obj.VAO);
-        glDeleteBuffers(1, &obj.VBO);
+        readback.Flush(frameWriter);
+        double renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+        frameWriter.Close(); // Kodowanie zaległych klatek
+        LOG_INFO(Render, "offscreen %dx%d: %lld frames in %.2f s (%.1f fps), %lld readback stalls", renderWidth, renderHeight,
+                 frameIndex, renderSeconds, renderSeconds > 0.0 ? frameIndex / renderSeconds : 0.0, readback.stalls);
+        readback.Destroy();
+        target.Destroy();
     }
 
+    sim.Stop(); // Wątek fizyki kończy bieżący krok
+    Checkpoints().Wait(); // Zapis rozpoczęty klawiszem F5 musi się skończyć
+    recorder.Close();
+    WriteProfile();
+
+    // Cleanup: wspólna siatka sfer i bufor instancji, profiler
+    spheres.Destroy();
+    gpuTimers.Destroy();
+    if (profile)
+        overlay.Destroy();
+    glDeleteProgram(sphereProgram);
+
     // Cleanup siatki
     glDeleteVertexArrays(1, &gridVAO); // Usuń VAO siatki
     glDeleteBuffers(1, &gridVBO); // Usuń VBO siatki
+    glDeleteTextures(1, &gridBodiesTexture); // Usuń bufor ciał siatki
+    glDeleteBuffers(1, &gridBodiesBuffer);
 
     glDeleteProgram(shaderProgram); // Usuń program shaderów
-    glfwTerminate(); // Zakończ GLFW
+    if (window)
+        glfwTerminate(); // Zakończ GLFW
+    else
+        offscreenContext.Destroy();
 
     return 0; // Zwróć kod wyjścia 0
 }
 
+const size_t kPrintedBodies = 16; // Ile ciał wypisuje tryb headless na końcu
+
+// Tryb headless: ta sama scena, bez okna i bez OpenGL, raport kroków na sekundę
+int RunHeadless(long long steps, bool checkSolver, float dt, long long reportEvery, TrajectoryRecorder &recorder)
+{
+    if (world.bodies.empty()) // Scena domyślna, chyba że ciała przyszły z checkpointu albo generatora
+    {
+        for (const SceneBody &sb : DefaultScene())
+            RestoreObject(world.AddBody(sb.body), kNoHandle, glm::vec4(sb.color[0], sb.color[1], sb.color[2], sb.color[3]), sb.glow); // Wygląd do nagrania
+    }
+    std::vector<uint64_t> ids = ObjectIds(world.bodies.size()); // Identyfikatory ciał świata (ta sama kolejność co ciała)
+    auto record = [&]
+    {
+        if (recordPath)
+            recorder.Submit(MakeTrajectoryFrame(world.bodies, ids, world.time, world.stepCount));
+    };
+    record(); // Stan początkowy
+    ExportState(world.bodies, ids, world.time, world.stepCount);
+    if (checkSolver)
+        PrintSolverCheck(world);
+
+    std::cout << "Headless: " << world.bodies.size() << " bodies, " << steps << " steps, solver "
+              << ForceSolverName(world.solver) << ", simd " << SimdLevelName(BestSimdLevel())
+              << ", threads " << GlobalPool().size() << ", integrator " << IntegratorName(world.integrator)
+              << ", precision " << PrecisionName(world.precision) << ", dt " << dt << std::endl;
+    Invariants initial; // Stan odniesienia dla dryfu (O(N^2), więc tylko z --report)
+    if (reportEvery > 0)
+        initial = ComputeInvariants(world.bodies);
+    auto start = std::chrono::steady_clock::now(); // Początek pomiaru
+    for (long long done = 0; done < steps;) // Symulacja bez ograniczenia klatkami
+    {
+        long long chunk = steps - done; // Do najbliższego raportu albo checkpointu
+        if (reportEvery > 0)
+            chunk = std::min(chunk, reportEvery - done % reportEvery);
+        if (checkpointEvery > 0)
+            chunk = std::min(chunk, checkpointEvery - done % checkpointEvery);
+        if (recordPath)
+            chunk = std::min(chunk, recordEvery - done % recordEvery);
+        if (SharedState().IsOpen())
+            chunk = 1; // Eksport co krok
+        world.run(chunk, dt);
+        done += chunk;
+        if (!world.removed.empty()) // Zlepienia: obiekty znikają razem z ciałami
+        {
+            EraseIndices(ids, world.removed);
+            SyncObjects(ids);
+            world.removed.clear();
+        }
+        if (done % recordEvery == 0 || done == steps)
+            record();
+        ExportState(world.bodies, ids, world.time, world.stepCount);
+        if (checkpointEvery > 0 && done % checkpointEvery == 0)
+        {
+            // Kopia stanu; zapis trwa w tle, symulacja liczy dalej
+            Checkpoints().Submit(MakeCheckpointData(world.bodies, ids, world.time, world.stepCount, world.CurrentPrecise()), savePath ? savePath : kDefaultCheckpoint);
+        }
+        if (reportEvery > 0 && (done % reportEvery == 0 || done == steps))
+        {
+            InvariantDrift drift = DriftFrom(initial, ComputeInvariants(world.bodies));
+            std::cout << "step " << done << ": dE/E " << drift.energy << ", dL/L " << drift.angularMomentum << std::endl;
+        }
+    }
+    auto end = std::chrono::steady_clock::now(); // Koniec pomiaru
+
+    double seconds = std::chrono::duration<double>(end - start).count(); // Czas trwania
+    std::cout << "Elapsed: " << seconds << " s" << std::endl;
+    std::cout << "Steps/sec: " << (seconds > 0 ? steps / seconds : 0.0) << std::endl;
+    if (GlobalProfiler().Enabled()) // Czasy faz kroku
+    {
+        std::vector<Profiler::Phase> phases;
+        double frames[Profiler::kHistory];
+        GlobalProfiler().Snapshot(phases, frames);
+        for (const Profiler::Phase &phase : phases)
+        {
+            std::cout << "Phase " << phase.name << ": " << phase.total << " ms total, "
+                      << (steps > 0 ? phase.total / steps : 0.0) << " ms/step, " << phase.calls << " calls" << std::endl;
+        }
+        WriteProfile();
+    }
+    if (savePath) // Stan końcowy (zastępuje zaległy zapis okresowy)
+        Checkpoints().Submit(MakeCheckpointData(world.bodies, ids, world.time, world.stepCount, world.CurrentPrecise()), savePath);
+    if ((savePath || checkpointEvery > 0) && !Checkpoints().Wait())
+        return 1;
+    if (!recorder.Close())
+        return 1;
+    if (world.integrator == Integrator::Hermite)
+    {
+        std::cout << "Hermite: " << world.hermite.substeps << " block substeps, "
+                  << world.hermite.forceEvaluations << " force evaluations" << std::endl;
+    }
+    for (size_t i = 0; i < world.bodies.size() && i < kPrintedBodies; ++i) // Stan końcowy (pierwsze ciała)
+    {
+        std::cout << "body " << i << ": pos (" << world.bodies.x[i] << ", " << world.bodies.y[i] << ", " << world.bodies.z[i] << ")" << std::endl;
+    }
+    return 0;
+}
+
+void WriteProfile()
+{
+    if (tracePath && !GlobalProfiler().WriteChromeTrace(tracePath))
+        LOG_ERROR(General, "cannot write trace %s", tracePath);
+    if (traceCsvPath && !GlobalProfiler().WriteCsv(traceCsvPath))
+        LOG_ERROR(General, "cannot write trace %s", traceCsvPath);
+}
+
+void PrintSolverCheck(const World &world)
+{
+    if (world.solver == ForceSolver::ParticleMesh)
+    {
+        ParticleMesh mesh = world.mesh; // Kopia ustawień: bufory świata zostają nietknięte
+        ForceError err = CompareMeshToDirect(mesh, world.bodies);
+        std::cout << "Particle-mesh check (grid " << mesh.grid << (mesh.shortRange ? ", P3M" : "") << ", cell " << mesh.CellSize()
+                  << " km, " << err.samples << " bodies): mean " << err.mean << ", rms " << err.rms << ", max " << err.max << std::endl;
+        return;
+    }
+    ForceError err = CompareBarnesHutToDirect(world.bodies, world.theta); // Porównanie na próbce ciał
+    std::cout << "Barnes-Hut check (theta " << world.theta << ", " << err.samples << " bodies): mean "
+              << err.mean << ", rms " << err.rms << ", max " << err.max << std::endl;
+}
+
 // Funkcja inicjalizująca GLFW i GLEW oraz tworząca okno
 GLFWwindow *StartGLU()
 {
     if (!glfwInit()) // Inicjalizacja GLFW
     {
-        std::cout << "Failed to initialize GLFW, panic" << std::endl; // Błąd
+        LOG_ERROR(Render, "failed to initialize GLFW, panic"); // Błąd
         return nullptr; // Zwróć nullptr
     }
-    GLFWwindow *window = glfwCreateWindow(800, 600, "3D_TEST", NULL, NULL); // Utwórz okno
+    GLFWwindow *window = glfwCreateWindow(renderWidth, renderHeight, "3D_TEST", NULL, NULL); // Utwórz okno
     if (!window) // Jeśli nie udało się utworzyć
     {
-        std::cerr << "Failed to create GLFW window." << std::endl; // Błąd
+        LOG_ERROR(Render, "failed to create GLFW window"); // Błąd
         glfwTerminate(); // Zakończ GLFW
         return nullptr; // Zwróć nullptr
     }
@@ -371,17 +1453,39 @@ GLFWwindow *StartGLU()
     glewExperimental = GL_TRUE; // Wymuś użycie nowoczesnych funkcji
     if (glewInit() != GLEW_OK) // Inicjalizacja GLEW
     {
-        std::cerr << "Failed to initialize GLEW." << std::endl; // Błąd
+        LOG_ERROR(Render, "failed to initialize GLEW"); // Błąd
         glfwTerminate(); // Zakończ GLFW
         return nullptr; // Zwróć nullptr
     }
 
+    SetupGLState();
+    return window; // Zwróć utworzone okno
+}
+
+// Kontekst OpenGL bez okna (EGL) i FBO o rozmiarze renderWidth x renderHeight, do którego idzie całe rysowanie
+bool StartOffscreen(OffscreenContext &context, OffscreenTarget &target)
+{
+    std::string error;
+    if (!context.Create(error))
+    {
+        LOG_ERROR(Render, "offscreen rendering unavailable: %s", error.c_str());
+        return false;
+    }
+    if (!target.Create(renderWidth, renderHeight))
+    {
+        LOG_ERROR(Render, "cannot create %dx%d framebuffer", renderWidth, renderHeight);
+        return false;
+    }
+    SetupGLState();
+    return true;
+}
+
+void SetupGLState()
+{
     glEnable(GL_DEPTH_TEST); // Włącz test głębi
-    glViewport(0, 0, 800, 600); // Ustaw viewport
+    glViewport(0, 0, renderWidth, renderHeight); // Ustaw viewport
     glEnable(GL_BLEND); // Włącz blending
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Funkcja mieszania przezroczystości
-
-    return window; // Zwróć utworzone okno
 }
 
 // Funkcja kompilująca i linkująca shadery
@@ -398,7 +1502,7 @@ GLuint CreateShaderProgram(const char *vertexSource, const char *fragmentSource)
     {
         char infoLog[512]; // Bufor na logi
         glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog); // Pobierz logi
-        std::cerr << "Vertex shader compilation failed: " << infoLog << std::endl; // Wypisz błąd
+        LOG_ERROR(Render, "vertex shader compilation failed: %s", infoLog); // Wypisz błąd
     }
 
     // Fragment shader
@@ -411,7 +1515,7 @@ GLuint CreateShaderProgram(const char *vertexSource, const char *fragmentSource)
     {
         char infoLog[512]; // Bufor na logi
         glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog); // Pobierz logi
-        std::cerr << "Fragment shader compilation failed: " << infoLog << std::endl; // Wypisz błąd
+        LOG_ERROR(Render, "fragment shader compilation failed: %s", infoLog); // Wypisz błąd
     }
 
     // Shader program
@@ -425,7 +1529,7 @@ GLuint CreateShaderProgram(const char *vertexSource, const char *fragmentSource)
     {
         char infoLog[512]; // Bufor na logi
         glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog); // Pobierz logi
-        std::cerr << "Shader program linking failed: " << infoLog << std::endl; // Wypisz błąd
+        LOG_ERROR(Render, "shader program linking failed: %s", infoLog); // Wypisz błąd
     }
 
     glDeleteShader(vertexShader); // Usuń vertex shader
@@ -448,19 +1552,19 @@ void CreateVBOVAO(GLuint &VAO, GLuint &VBO, const float *vertices, size_t vertex
     glBindVertexArray(0);
 }
 
-void UpdateCam(GLuint shaderProgram, glm::vec3 cameraPos)
+glm::mat4 UpdateCam(GLuint shaderProgram, glm::vec3 cameraPos)
 {
     glUseProgram(shaderProgram);
     glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
     GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
     glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    return view;
 }
 
 void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
     float cameraSpeed = 10000.0f * deltaTime;
     bool shiftPressed = (mods & GLFW_MOD_SHIFT) != 0;
-    Object &lastObj = objs[objs.size() - 1];
 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
     {
@@ -489,14 +1593,24 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
         cameraPos -= cameraSpeed * cameraUp;
     }
 
+    bool wasPaused = paused;
     if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS)
     {
-        pause = true;
+        paused = true;
     }
     if (glfwGetKey(window, GLFW_KEY_K) == GLFW_RELEASE)
     {
-        pause = false;
+        paused = false;
     }
+    if (paused != wasPaused)
+    {
+        SimCommand command{SimCommand::SetPaused};
+        command.value[0] = paused ? 1.0f : 0.0f;
+        sim.Push(command);
+    }
+
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS && !playPath) // Checkpoint w tle, symulacja nie staje
+        SaveCheckpoint(sim.Latest(), savePath ? savePath : kDefaultCheckpoint);
 
     if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
     {
@@ -505,40 +1619,41 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
         running = false;
     }
 
-    // init arrows pos up down left right
-    if (!objs.empty() && objs[objs.size() - 1].Initalizing)
+    // Odtwarzanie: strzałki w lewo/prawo przewijają o 2% nagrania (z Shift o klatkę), w górę/dół zmieniają prędkość
+    if (playPath && (action == GLFW_PRESS || action == GLFW_REPEAT))
     {
-        if (key == GLFW_KEY_UP && (action == GLFW_PRESS || action == GLFW_REPEAT))
-        {
-            if (!shiftPressed)
-            {
-                objs[objs.size() - 1].position[1] += objs[objs.size() - 1].radius * 0.2;
-            }
-        };
-        if (key == GLFW_KEY_DOWN && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        double jump = shiftPressed ? 1.0 : std::max(1.0, 0.02 * double(playFrames));
+        if (key == GLFW_KEY_RIGHT)
+            playCursor += jump;
+        if (key == GLFW_KEY_LEFT)
+            playCursor -= jump;
+        if (key == GLFW_KEY_UP)
+            playSpeed *= 2.0;
+        if (key == GLFW_KEY_DOWN)
+            playSpeed *= 0.5;
+    }
+
+    // init arrows pos up down left right: przesunięcia umieszczanego ciała w promieniach
+    if (placing && (action == GLFW_PRESS || action == GLFW_REPEAT))
+    {
+        SimCommand move{SimCommand::MovePlacing};
+        move.id = placingObject;
+        if (key == GLFW_KEY_UP)
         {
-            if (!shiftPressed)
-            {
-                objs[objs.size() - 1].position[1] -= objs[objs.size() - 1].radius * 0.2;
-            }
+            move.value[1] = shiftPressed ? 0.0f : 0.2f;
+            move.value[2] = 0.2f;
         }
-        if (key == GLFW_KEY_RIGHT && (action == GLFW_PRESS || action == GLFW_REPEAT))
-        {
-            objs[objs.size() - 1].position[0] += objs[objs.size() - 1].radius * 0.2;
-        };
-        if (key == GLFW_KEY_LEFT && (action == GLFW_PRESS || action == GLFW_REPEAT))
-        {
-            objs[objs.size() - 1].position[0] -= objs[objs.size() - 1].radius * 0.2;
-        };
-        if (key == GLFW_KEY_UP && (action == GLFW_PRESS || action == GLFW_REPEAT))
-        {
-            objs[objs.size() - 1].position[2] += objs[objs.size() - 1].radius * 0.2;
-        };
-
-        if (key == GLFW_KEY_DOWN && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        if (key == GLFW_KEY_DOWN)
         {
-            objs[objs.size() - 1].position[2] -= objs[objs.size() - 1].radius * 0.2;
+            move.value[1] = shiftPressed ? 0.0f : -0.2f;
+            move.value[2] = -0.2f;
         }
+        if (key == GLFW_KEY_RIGHT)
+            move.value[0] = 0.2f;
+        if (key == GLFW_KEY_LEFT)
+            move.value[0] = -0.2f;
+        if (move.value[0] != 0.0f || move.value[1] != 0.0f || move.value[2] != 0.0f)
+            sim.Push(move);
     };
 };
 void mouse_callback(GLFWwindow *window, double xpos, double ypos)
@@ -569,26 +1684,48 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos)
 }
 void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods)
 {
+    if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS) // Wybór ciała pod środkiem widoku (także w odtwarzaniu)
+    {
+        pickRequested = true;
+        return;
+    }
+    if (playPath) // Odtwarzanie nie ma symulacji, do której można dodać ciało
+        return;
     if (button == GLFW_MOUSE_BUTTON_LEFT)
     {
         if (action == GLFW_PRESS)
         {
-            objs.emplace_back(glm::vec3(0.0, 0.0, 0.0), glm::vec3(0.0f, 0.0f, 0.0f), initMass);
-            objs[objs.size() - 1].Initalizing = true;
+            Body body(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, initMass);
+            body.Initalizing = true;
+            placingObject = AddObject(body);
+            placing = true;
         };
-        if (action == GLFW_RELEASE)
+        if (action == GLFW_RELEASE && placing)
         {
-            objs[objs.size() - 1].Initalizing = false;
-            objs[objs.size() - 1].Launched = true;
+            SimCommand launch{SimCommand::Launch};
+            launch.id = placingObject;
+            sim.Push(launch);
+            if (Object *obj = objects.Get(placingObject)) // Uchwyt ważny, nawet gdy w międzyczasie dodano albo usunięto inne obiekty
+                obj->Launched = true;
+            placingObject = kNoHandle;
+            placing = false;
         };
     };
-    if (!objs.empty() && button == GLFW_MOUSE_BUTTON_RIGHT && objs[objs.size() - 1].Initalizing)
+    if (button == GLFW_MOUSE_BUTTON_RIGHT && placing)
     {
+        float factor = 1.0f;
         if (action == GLFW_PRESS || action == GLFW_REPEAT)
         {
-            objs[objs.size() - 1].mass *= 1.2;
+            factor = 1.2f;
+            SimCommand grow{SimCommand::GrowPlacing};
+            grow.id = placingObject;
+            grow.value[0] = factor;
+            sim.Push(grow);
         }
-        std::cout << "MASS: " << objs[objs.size() - 1].mass << std::endl;
+        const SimSnapshot &snap = sim.Latest(); // Masa po wykonaniu polecenia (migawka jest o krok do tyłu)
+        const Object *obj = objects.Get(placingObject);
+        if (obj && obj->body < snap.bodies.size() && snap.bodies.initalizing[obj->body]) // Object::body: indeks w tej migawce
+            LOG_INFO(Input, "placing body mass %g kg", snap.bodies.mass[obj->body] * factor);
     }
 };
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
@@ -604,13 +1741,6 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
     }
 }
 
-glm::vec3 sphericalToCartesian(float r, float theta, float phi)
-{
-    float x = r * sin(theta) * cos(phi);
-    float y = r * cos(theta);
-    float z = r * sin(theta) * sin(phi);
-    return glm::vec3(x, y, z);
-};
 void DrawGrid(GLuint shaderProgram, GLuint gridVAO, size_t vertexCount)
 {
     glUseProgram(shaderProgram);
@@ -623,100 +1753,3 @@ void DrawGrid(GLuint shaderProgram, GLuint gridVAO, size_t vertexCount)
     glDrawArrays(GL_LINES, 0, vertexCount / 3);
     glBindVertexArray(0);
 }
-std::vector<float> CreateGridVertices(float size, int divisions, const std::vector<Object> &objs)
-{
-    std::vector<float> vertices;
-    float step = size / divisions;
-    float halfSize = size / 2.0f;
-
-    // x axis
-    for (int yStep = 3; yStep <= 3; ++yStep)
-    {
-        float y = -halfSize * 0.3f + yStep * step;
-        for (int zStep = 0; zStep <= divisions; ++zStep)
-        {
-            float z = -halfSize + zStep * step;
-            for (int xStep = 0; xStep < divisions; ++xStep)
-            {
-                float xStart = -halfSize + xStep * step;
-                float xEnd = xStart + step;
-                vertices.push_back(xStart);
-                vertices.push_back(y);
-                vertices.push_back(z);
-                vertices.push_back(xEnd);
-                vertices.push_back(y);
-                vertices.push_back(z);
-            }
-        }
-    }
-    // zaxis
-    for (int xStep = 0; xStep <= divisions; ++xStep)
-    {
-        float x = -halfSize + xStep * step;
-        for (int yStep = 3; yStep <= 3; ++yStep)
-        {
-            float y = -halfSize * 0.3f + yStep * step;
-            for (int zStep = 0; zStep < divisions; ++zStep)
-            {
-                float zStart = -halfSize + zStep * step;
-                float zEnd = zStart + step;
-                vertices.push_back(x);
-                vertices.push_back(y);
-                vertices.push_back(zStart);
-                vertices.push_back(x);
-                vertices.push_back(y);
-                vertices.push_back(zEnd);
-            }
-        }
-    }
-
-    return vertices;
-}
-std::vector<float> UpdateGridVertices(std::vector<float> vertices, const std::vector<Object> &objs)
-{
-
-    // centre of mass calc
-    float totalMass = 0.0f;
-    float comY = 0.0f;
-    for (const auto &obj : objs)
-    {
-        if (obj.Initalizing)
-            continue;
-        comY += obj.mass * obj.position.y;
-        totalMass += obj.mass;
-    }
-    if (totalMass > 0)
-        comY /= totalMass;
-
-    float originalMaxY = -std::numeric_limits<float>::infinity();
-    for (int i = 0; i < vertices.size(); i += 3)
-    {
-        originalMaxY = std::max(originalMaxY, vertices[i + 1]);
-    }
-
-    float verticalShift = comY - originalMaxY;
-    std::cout << "vertical shift: " << verticalShift << " |         comY: " << comY << "|            originalmaxy: " << originalMaxY << std::endl;
-
-    for (int i = 0; i < vertices.size(); i += 3)
-    {
-
-        // mass bending space
-        glm::vec3 vertexPos(vertices[i], vertices[i + 1], vertices[i + 2]);
-        glm::vec3 totalDisplacement(0.0f);
-        for (const auto &obj : objs)
-        {
-            // f (obj.Initalizing) continue;
-
-            glm::vec3 toObject = obj.GetPos() - vertexPos;
-            float distance = glm::length(toObject);
-            float distance_m = distance * 1000.0f;
-            float rs = (2 * G * obj.mass) / (c * c);
-
-            float dz = 2 * sqrt(rs * (distance_m - rs));
-            totalDisplacement.y += dz * 2.0f;
-        }
-        vertices[i + 1] = totalDisplacement.y + -abs(verticalShift);
-    }
-
-    return vertices;
-}
\ No newline at end of file
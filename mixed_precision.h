@@ -0,0 +1,139 @@
+// Tryb mieszanej precyzji: stan ciał w double, jądra sił w float na współrzędnych względem ruchomego początku układu
+#pragma once
+
+#include <vector> // std::vector
+#include <atomic> // std::atomic: wykrycie zmian z wielu wątków
+#include <cstring> // std::strcmp
+#include <algorithm> // std::max
+#include <limits> // std::numeric_limits: NaN dla nowych ciał
+
+#include "body_store.h" // BodyStore, AlignedAllocator
+#include "thread_pool.h" // ThreadPool: równoległe pętle po ciałach
+
+enum class Precision
+{
+    Single, // Dawne zachowanie: pozycje i prędkości tylko w float
+    Mixed // Pozycje i prędkości w double, siły w float względem środka masy, kicki i drifty w double
+};
+
+inline const char *PrecisionName(Precision precision)
+{
+    return precision == Precision::Mixed ? "mixed" : "single";
+}
+
+// Tryb o podanej nazwie; nieznana nazwa zostawia float
+inline Precision PrecisionFromName(const char *name)
+{
+    return std::strcmp(name, "mixed") == 0 ? Precision::Mixed : Precision::Single;
+}
+
+using DoubleArray = std::vector<double, AlignedAllocator<double>>; // Wyrównana tablica double
+
+// Pozycje i prędkości w double (indeksy jak w BodyStore). BodyStore trzyma ich zaokrąglenie do float
+// dla renderowania, kolizji, migawek i checkpointów.
+struct PreciseState
+{
+    DoubleArray x, y, z, vx, vy, vz;
+
+    size_t size() const { return x.size(); }
+
+    void clear()
+    {
+        for (DoubleArray *a : {&x, &y, &z, &vx, &vy, &vz})
+            a->clear();
+    }
+
+    // Usuwa ciała jednym przejściem, jak BodyStore::RemoveIndices
+    void RemoveIndices(const std::vector<size_t> &removed)
+    {
+        for (DoubleArray *a : {&x, &y, &z, &vx, &vy, &vz})
+            EraseIndices(*a, removed);
+    }
+
+    // Przejmuje zmiany wprowadzone wprost do BodyStore (nowe ciała, polecenia wejścia, wczytany checkpoint, odbicia).
+    // Wartość float różna od zaokrąglenia double oznacza zapis z zewnątrz.
+    // Zwraca true, gdy zmieniła się pozycja ciała biorącego udział w oddziaływaniach.
+    bool Sync(const BodyStore &bodies, ThreadPool &pool)
+    {
+        size_t n = bodies.size();
+        if (size() > n) // Ciała usunięte poza światem: stan od nowa
+            clear();
+        for (DoubleArray *a : {&x, &y, &z, &vx, &vy, &vz})
+            a->resize(n, std::numeric_limits<double>::quiet_NaN()); // Nowe ciała: NaN zawsze różny od float
+        std::atomic<bool> moved{false};
+        const FloatArray *from[6] = {&bodies.x, &bodies.y, &bodies.z, &bodies.vx, &bodies.vy, &bodies.vz};
+        DoubleArray *to[6] = {&x, &y, &z, &vx, &vy, &vz};
+        pool.ParallelFor(0, n, 4096, [&](size_t i0, size_t i1)
+                         {
+            bool changed = false;
+            for (int a = 0; a < 6; ++a)
+            {
+                const float *f = from[a]->data();
+                double *d = to[a]->data();
+                for (size_t i = i0; i < i1; ++i)
+                {
+                    if (f[i] != float(d[i]))
+                    {
+                        d[i] = f[i];
+                        changed |= a < 3 && !bodies.initalizing[i]; // Umieszczane ciała nie wpływają na siły
+                    }
+                }
+            }
+            if (changed)
+                moved = true; });
+        return moved;
+    }
+};
+
+// Ciała w postaci dla solverów float: pozycje względem origin (środek masy w double), masy w jednostkach massUnit.
+// Różnice pozycji liczone blisko zera nie tracą bitów na przesunięciu układu, a m / d^3 nie zbliża się do granic float.
+struct RelativeFrame
+{
+    double origin[3] = {0.0, 0.0, 0.0};
+    double massUnit = 1.0; // Największa masa aktywnego ciała; przyspieszenia solvera razy massUnit dają wynik w m/s^2
+    BodyStore local; // x, y, z, mass, initalizing dla solverów (pozostałe tablice nieużywane)
+
+    void Build(const BodyStore &bodies, const PreciseState &precise, ThreadPool &pool)
+    {
+        const size_t n = bodies.size(), grain = 4096; // Stałe kawałki: wynik nie zależy od liczby wątków
+        std::vector<double> partial(((n + grain - 1) / grain) * 5, 0.0); // Masa, masa * (x, y, z), największa masa
+        pool.ParallelFor(0, n, grain, [&](size_t i0, size_t i1)
+                         {
+            double *sum = &partial[(i0 / grain) * 5];
+            for (size_t i = i0; i < i1; ++i)
+            {
+                if (bodies.initalizing[i])
+                    continue;
+                double m = bodies.mass[i];
+                sum[0] += m;
+                sum[1] += m * precise.x[i];
+                sum[2] += m * precise.y[i];
+                sum[3] += m * precise.z[i];
+                sum[4] = std::max(sum[4], m);
+            } });
+        double total = 0.0, weighted[3] = {0.0, 0.0, 0.0}, largest = 0.0;
+        for (size_t k = 0; k < partial.size(); k += 5)
+        {
+            total += partial[k];
+            for (int d = 0; d < 3; ++d)
+                weighted[d] += partial[k + 1 + d];
+            largest = std::max(largest, partial[k + 4]);
+        }
+        for (int d = 0; d < 3; ++d)
+            origin[d] = total > 0.0 ? weighted[d] / total : 0.0;
+        massUnit = largest > 0.0 ? largest : 1.0;
+
+        local.resize(n);
+        const double inverseUnit = 1.0 / massUnit;
+        pool.ParallelFor(0, n, grain, [&](size_t i0, size_t i1)
+                         {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                local.x[i] = float(precise.x[i] - origin[0]);
+                local.y[i] = float(precise.y[i] - origin[1]);
+                local.z[i] = float(precise.z[i] - origin[2]);
+                local.mass[i] = float(bodies.mass[i] * inverseUnit);
+                local.initalizing[i] = bodies.initalizing[i];
+            } });
+    }
+};
@@ -0,0 +1,243 @@
+// Renderowanie bez okna: kontekst EGL bez powierzchni (działa też na rasteryzerach programowych, np. llvmpipe),
+// FBO o dowolnym rozmiarze i odczyt pikseli przez pierścień PBO, żeby glReadPixels nie czekał na GPU
+#pragma once
+
+#include <GL/glew.h> // GLEW: funkcje OpenGL
+#ifdef PHYSICS_HAS_EGL
+#include <EGL/egl.h> // EGL: kontekst bez okna
+#include <EGL/eglext.h> // EGL_PLATFORM_SURFACELESS_MESA
+#endif
+#include <string> // std::string: opis błędu
+#include <cstring> // std::memcpy, std::strstr
+#include <vector> // std::vector
+#include <utility> // std::move
+
+#include "image_writer.h" // ImageSequenceWriter: kodowanie klatek na wątkach roboczych
+
+// Kontekst OpenGL 3.3 core bez okna i bez serwera wyświetlania
+class OffscreenContext
+{
+public:
+    ~OffscreenContext()
+    {
+        Destroy();
+    }
+
+    // Tworzy kontekst, ustawia go jako bieżący i ładuje funkcje przez GLEW
+    bool Create(std::string &error)
+    {
+#ifdef PHYSICS_HAS_EGL
+        const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr); // Bez X11 i Waylanda
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major = 0, minor = 0;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        {
+            error = "no EGL display";
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            error = "EGL without desktop OpenGL";
+            return false;
+        }
+        const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+        bool surfaceless = extensions && std::strstr(extensions, "EGL_KHR_surfaceless_context");
+        const EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint configs = 0;
+        eglChooseConfig(display, configAttribs, &config, 1, &configs);
+        if (configs == 0 && !(surfaceless && extensions && std::strstr(extensions, "EGL_KHR_no_config_context")))
+        {
+            error = "no EGL config for OpenGL";
+            return false;
+        }
+        const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                                         EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+        context = eglCreateContext(display, configs > 0 ? config : EGLConfig(nullptr), EGL_NO_CONTEXT, contextAttribs);
+        if (context == EGL_NO_CONTEXT)
+        {
+            error = "cannot create OpenGL 3.3 core context";
+            return false;
+        }
+        if (!surfaceless) // Bez rozszerzenia kontekst potrzebuje jakiejś powierzchni; rysujemy i tak do FBO
+        {
+            const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+            surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        }
+        if (!eglMakeCurrent(display, surface, surface, context))
+        {
+            error = "cannot make EGL context current";
+            return false;
+        }
+        glewExperimental = GL_TRUE;
+        GLenum status = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+        if (status == GLEW_ERROR_NO_GLX_DISPLAY) // GLEW zbudowany dla GLX: funkcje OpenGL są już załadowane, brakuje tylko GLX
+            status = GLEW_OK;
+#endif
+        if (status != GLEW_OK)
+        {
+            error = "failed to initialize GLEW";
+            return false;
+        }
+        return true;
+#else
+        error = "built without EGL (PHYSICS_HAS_EGL)";
+        return false;
+#endif
+    }
+
+    void Destroy()
+    {
+#ifdef PHYSICS_HAS_EGL
+        if (display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+        display = EGL_NO_DISPLAY;
+        surface = EGL_NO_SURFACE;
+        context = EGL_NO_CONTEXT;
+#endif
+    }
+
+private:
+#ifdef PHYSICS_HAS_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+#endif
+};
+
+// Bufor ramki z kolorem RGBA8 i głębią; zastępuje domyślny bufor okna
+struct OffscreenTarget
+{
+    GLuint fbo = 0, color = 0, depth = 0;
+    int width = 0, height = 0;
+
+    bool Create(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glGenRenderbuffers(1, &color);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE; // FBO zostaje związany do rysowania
+    }
+
+    void Destroy()
+    {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        fbo = color = depth = 0;
+    }
+};
+
+// Odczyt klatek bez przestoju: glReadPixels do PBO tylko kolejkuje kopię na GPU, mapowanie następuje kRing - 1 klatek
+// później, gdy płot (glFenceSync) zwykle już minął. Skopiowana klatka idzie do kodowania na wątkach ImageSequenceWriter.
+class PboReadback
+{
+public:
+    static const int kRing = 3; // Klatki w drodze (2 w locie + 1 odczytywana)
+
+    long long stalls = 0; // Ile razy trzeba było czekać na GPU przy mapowaniu (duża liczba: zwiększyć kRing)
+
+    void Create(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        glGenBuffers(kRing, pbo);
+        for (int k = 0; k < kRing; ++k)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[k]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(width) * height * 4, nullptr, GL_STREAM_READ);
+            fence[k] = nullptr;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        next = 0;
+    }
+
+    // Kolejkuje odczyt bieżącej klatki z FBO; najstarszą gotową oddaje do zapisu
+    void Capture(const OffscreenTarget &target, long long frameIndex, ImageSequenceWriter &writer)
+    {
+        int slot = int(next % kRing);
+        if (fence[slot])
+            Drain(slot, writer);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target.fbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // RGBA: szybka ścieżka sterowników
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        index[slot] = frameIndex;
+        ++next;
+    }
+
+    // Oddaje wszystkie klatki w drodze (koniec nagrania)
+    void Flush(ImageSequenceWriter &writer)
+    {
+        for (long long k = next; k < next + kRing; ++k)
+        {
+            int slot = int(k % kRing);
+            if (fence[slot])
+                Drain(slot, writer);
+        }
+    }
+
+    void Destroy()
+    {
+        for (int k = 0; k < kRing; ++k)
+        {
+            if (fence[k])
+                glDeleteSync(fence[k]);
+            fence[k] = nullptr;
+        }
+        glDeleteBuffers(kRing, pbo);
+    }
+
+private:
+    GLuint pbo[kRing] = {};
+    GLsync fence[kRing] = {};
+    long long index[kRing] = {};
+    long long next = 0; // Numer następnego odczytu (slot = next % kRing)
+    int width = 0, height = 0;
+
+    void Drain(int slot, ImageSequenceWriter &writer)
+    {
+        if (glClientWaitSync(fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            ++stalls;
+            while (glClientWaitSync(fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) // 1 ms
+                ;
+        }
+        glDeleteSync(fence[slot]);
+        fence[slot] = nullptr;
+        std::vector<uint8_t> pixels = writer.AcquireBuffer();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+        const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(pixels.size()), GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            std::memcpy(pixels.data(), mapped, pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (mapped)
+            writer.Submit(index[slot], std::move(pixels));
+    }
+};
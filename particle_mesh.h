@@ -0,0 +1,598 @@
+// Solver particle-mesh: masa na siatkę (CIC), potencjał z równania Poissona przez FFT 3D, siły interpolowane z powrotem.
+// Opcjonalnie P3M: podział Gaussa na część dalekozasięgową (siatka) i bliską (suma po sąsiadach z erfc). O(N + M log M).
+#pragma once
+
+#include <vector> // std::vector
+#include <complex> // std::complex
+#include <cmath> // std::sqrt, std::floor, std::erf, std::erfc, std::exp
+#include <cstdint> // uint32_t
+#include <algorithm> // std::min, std::max, std::swap
+
+#include "body.h" // G, kDistanceToMeters
+#include "body_store.h" // BodyStore, FloatArray
+#include "barnes_hut.h" // ForceError, DirectAccelerationOf (porównanie dokładności)
+#include "thread_pool.h" // ThreadPool: linie FFT, plastry siatki i ciała równolegle
+
+// Transformata Fouriera radix-2 długości n (potęga dwójki) w miejscu; odwrotna bez dzielenia przez n
+class Fft1D
+{
+public:
+    void Init(size_t length)
+    {
+        if (length == n)
+            return;
+        n = length;
+        twiddle.resize(n / 2);
+        for (size_t k = 0; k < n / 2; ++k)
+        {
+            double angle = -2.0 * 3.14159265358979323846 * double(k) / double(n);
+            twiddle[k] = std::complex<float>(float(std::cos(angle)), float(std::sin(angle)));
+        }
+        int bits = 0;
+        while ((size_t(1) << bits) < n)
+            ++bits;
+        reverse.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            size_t r = 0;
+            for (int b = 0; b < bits; ++b)
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            reverse[i] = uint32_t(r);
+        }
+    }
+
+    size_t size() const { return n; }
+
+    void Transform(std::complex<float> *a, bool inverse) const
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (i < reverse[i])
+                std::swap(a[i], a[reverse[i]]);
+        }
+        const float sign = inverse ? -1.0f : 1.0f;
+        for (size_t len = 2; len <= n; len <<= 1)
+        {
+            size_t half = len >> 1, step = n / len;
+            for (size_t i = 0; i < n; i += len)
+            {
+                for (size_t k = 0; k < half; ++k)
+                {
+                    float wr = twiddle[k * step].real(), wi = sign * twiddle[k * step].imag();
+                    std::complex<float> u = a[i + k], b = a[i + k + half];
+                    std::complex<float> v(b.real() * wr - b.imag() * wi, b.real() * wi + b.imag() * wr); // Bez __mulsc3
+                    a[i + k] = u + v;
+                    a[i + k + half] = u - v;
+                }
+            }
+        }
+    }
+
+private:
+    size_t n = 0;
+    std::vector<std::complex<float>> twiddle; // exp(-2 pi i k / n)
+    std::vector<uint32_t> reverse; // Permutacja odwrócenia bitów
+};
+
+enum class MeshBoundary
+{
+    Isolated, // Siatka dopełniona zerami do 2M: brak obrazów, jak suma bezpośrednia
+    Periodic // Pudło periodyczne (rozkłady jednorodne, kosmologia): siły obejmują obrazy
+};
+
+// Siatka M^3 nad ciałami; przyspieszenia w tych samych jednostkach co suma bezpośrednia i Barnes-Hut
+class ParticleMesh
+{
+public:
+    int grid = 64; // Węzłów na oś (zaokrąglane w górę do potęgi dwójki)
+    MeshBoundary boundary = MeshBoundary::Isolated;
+    float box = 0.0f; // Bok pudła periodycznego (km); 0 = sześcian obejmujący ciała w danym kroku
+    float boxCenter[3] = {0.0f, 0.0f, 0.0f}; // Środek pudła periodycznego (gdy box > 0)
+    bool shortRange = false; // P3M: siatka tylko dla części dalekiej, bliska liczona wprost
+    float split = 1.25f; // Skala podziału r_s w oczkach siatki
+    float cutoff = 4.5f; // Zasięg części bliskiej w r_s (erfc(2.25) ~ 1.5e-3)
+
+    // Przyspieszenia wszystkich ciał; umieszczane ciała nie oddziałują i dostają zero
+    void Accelerations(const BodyStore &bodies, FloatArray &ax, FloatArray &ay, FloatArray &az, ThreadPool &pool = GlobalPool())
+    {
+        const size_t n = bodies.size();
+        ax.assign(n, 0.0f);
+        ay.assign(n, 0.0f);
+        az.assign(n, 0.0f);
+        active.clear();
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (!bodies.initalizing[i])
+                active.push_back(uint32_t(i));
+        }
+        if (active.empty())
+            return;
+        Layout(bodies);
+        Deposit(bodies, pool);
+        SolvePotential(pool);
+        Gradient(pool);
+        Interpolate(bodies, ax, ay, az, pool);
+        if (shortRange)
+            AddShortRange(bodies, ax, ay, az, pool);
+    }
+
+    // Bok oczka siatki w ostatnim wywołaniu (km)
+    double CellSize() const
+    {
+        return h;
+    }
+
+private:
+    static const int kMargin = 3; // Wolne węzły przy brzegu siatki izolowanej: CIC + różnice 4-punktowe
+    using Cell = std::complex<float>;
+
+    std::vector<uint32_t> active; // Indeksy ciał biorących udział w oddziaływaniach
+    size_t m = 0; // Węzłów na oś siatki mas
+    size_t padded = 0; // Węzłów na oś siatki FFT (2m izolowana, m periodyczna)
+    double h = 1.0; // Bok oczka (km)
+    double origin[3] = {0.0, 0.0, 0.0}; // Położenie węzła (0, 0, 0)
+    double period = 0.0; // Bok pudła periodycznego (km)
+
+    std::vector<Cell> work; // Siatka FFT padded^3, indeks (z * padded + y) * padded + x
+    std::vector<Cell> kernel; // Transformata funkcji Greena siatki izolowanej (dla h = 1, z normalizacją)
+    size_t kernelSize = 0; // Parametry, dla których policzono kernel
+    bool kernelShortRange = false;
+    float kernelSplit = 0.0f;
+    Fft1D fft;
+    FloatArray potential, fx, fy, fz; // m^3: potencjał i -grad potencjału w węzłach
+    std::vector<uint32_t> slabStart, sorted; // Ciała posortowane po płaszczyźnie z komórki CIC
+    std::vector<uint32_t> cellStart, cellBodies; // Lista komórek części bliskiej
+
+    size_t Node(size_t x, size_t y, size_t z) const
+    {
+        return (z * m + y) * m + x;
+    }
+
+    // Rozmiar i położenie siatki: izolowana obejmuje ciała z marginesem, periodyczna to pudło
+    void Layout(const BodyStore &bodies)
+    {
+        m = 8;
+        while (m < size_t(std::max(grid, 8)))
+            m <<= 1;
+        double lo[3], hi[3];
+        for (int d = 0; d < 3; ++d)
+            lo[d] = hi[d] = Coordinate(bodies, d, active[0]);
+        for (uint32_t i : active)
+        {
+            for (int d = 0; d < 3; ++d)
+            {
+                double v = Coordinate(bodies, d, i);
+                lo[d] = std::min(lo[d], v);
+                hi[d] = std::max(hi[d], v);
+            }
+        }
+        double extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+        if (boundary == MeshBoundary::Periodic)
+        {
+            padded = m;
+            period = box > 0.0f ? box : (extent > 0.0 ? extent * (1.0 + 1.0 / double(m)) : 1.0); // Bez sklejenia skrajnych ciał
+            h = period / double(m);
+            for (int d = 0; d < 3; ++d)
+                origin[d] = box > 0.0f ? boxCenter[d] - 0.5 * period : 0.5 * (lo[d] + hi[d]) - 0.5 * period;
+            return;
+        }
+        padded = 2 * m;
+        h = extent > 0.0 ? extent / double(m - 2 * kMargin - 1) : 1.0;
+        for (int d = 0; d < 3; ++d)
+            origin[d] = 0.5 * (lo[d] + hi[d]) - 0.5 * h * double(m - 1);
+    }
+
+    static double Coordinate(const BodyStore &bodies, int d, size_t i)
+    {
+        return d == 0 ? bodies.x[i] : d == 1 ? bodies.y[i] : bodies.z[i];
+    }
+
+    // Współrzędna w oczkach: węzeł i leży w origin + i h; periodycznie sprowadzona do [0, m)
+    double GridCoordinate(const BodyStore &bodies, int d, size_t i) const
+    {
+        double u = (Coordinate(bodies, d, i) - origin[d]) / h;
+        if (boundary == MeshBoundary::Periodic)
+        {
+            u -= std::floor(u / double(m)) * double(m);
+            if (u >= double(m)) // Zaokrąglenie tuż pod m
+                u = 0.0;
+        }
+        return u;
+    }
+
+    // Węzeł CIC (dolny róg) i wagi ciała
+    void CloudOf(const BodyStore &bodies, size_t i, size_t base[3], double frac[3]) const
+    {
+        for (int d = 0; d < 3; ++d)
+        {
+            double u = GridCoordinate(bodies, d, i);
+            double f = std::floor(u);
+            long long b = (long long)f;
+            if (boundary == MeshBoundary::Isolated) // Ciała zawsze wewnątrz; ochrona przed zaokrągleniem na brzegu
+                b = std::min<long long>(std::max<long long>(b, 0), (long long)m - 2);
+            base[d] = size_t(b);
+            frac[d] = std::min(std::max(u - double(b), 0.0), 1.0);
+        }
+    }
+
+    size_t Wrap(size_t i) const
+    {
+        return boundary == MeshBoundary::Periodic ? i % m : i;
+    }
+
+    // Masy ciał na węzły (cloud-in-cell). Ciało dotyka płaszczyzn z i z+1, więc płaszczyzny parzyste,
+    // potem nieparzyste, idą równolegle bez konfliktów; kolejność ciał w płaszczyźnie stała (wynik powtarzalny).
+    void Deposit(const BodyStore &bodies, ThreadPool &pool)
+    {
+        work.assign(padded * padded * padded, Cell(0.0f, 0.0f));
+        slabStart.assign(m + 1, 0);
+        std::vector<uint32_t> slab(active.size());
+        for (size_t k = 0; k < active.size(); ++k)
+        {
+            size_t base[3];
+            double frac[3];
+            CloudOf(bodies, active[k], base, frac);
+            slab[k] = uint32_t(base[2]);
+            ++slabStart[base[2] + 1];
+        }
+        for (size_t z = 0; z < m; ++z)
+            slabStart[z + 1] += slabStart[z];
+        sorted.resize(active.size());
+        std::vector<uint32_t> fill(slabStart.begin(), slabStart.end() - 1);
+        for (size_t k = 0; k < active.size(); ++k)
+            sorted[fill[slab[k]]++] = active[k];
+
+        for (size_t parity = 0; parity < 2; ++parity)
+        {
+            pool.ParallelFor(0, m / 2, 1, [&](size_t s0, size_t s1)
+                             {
+                for (size_t s = s0; s < s1; ++s)
+                {
+                    size_t z = 2 * s + parity;
+                    for (uint32_t k = slabStart[z]; k < slabStart[z + 1]; ++k)
+                    {
+                        size_t i = sorted[k], base[3];
+                        double frac[3];
+                        CloudOf(bodies, i, base, frac);
+                        double mass = bodies.mass[i];
+                        for (int c = 0; c < 8; ++c)
+                        {
+                            double w = mass;
+                            size_t node[3];
+                            for (int d = 0; d < 3; ++d)
+                            {
+                                bool upper = (c >> d) & 1;
+                                w *= upper ? frac[d] : 1.0 - frac[d];
+                                node[d] = Wrap(base[d] + (upper ? 1 : 0));
+                            }
+                            work[(node[2] * padded + node[1]) * padded + node[0]] += Cell(float(w), 0.0f);
+                        }
+                    }
+                } });
+        }
+    }
+
+    // FFT wzdłuż osi axis siatki padded^3; tylko linie o pozostałych współrzędnych < limitA, limitB
+    void TransformAxis(int axis, bool inverse, size_t limitA, size_t limitB, ThreadPool &pool)
+    {
+        const size_t p = padded;
+        const size_t stride = axis == 0 ? 1 : axis == 1 ? p : p * p;
+        const size_t strideA = axis == 0 ? p : 1, strideB = axis == 2 ? p : p * p; // Pozostałe osie (rosnąco)
+        pool.ParallelFor(0, limitA * limitB, 64, [&](size_t l0, size_t l1)
+                         {
+            static thread_local std::vector<Cell> line;
+            line.resize(p);
+            for (size_t l = l0; l < l1; ++l)
+            {
+                Cell *start = work.data() + (l % limitA) * strideA + (l / limitA) * strideB;
+                if (stride == 1)
+                {
+                    fft.Transform(start, inverse);
+                    continue;
+                }
+                for (size_t k = 0; k < p; ++k)
+                    line[k] = start[k * stride];
+                fft.Transform(line.data(), inverse);
+                for (size_t k = 0; k < p; ++k)
+                    start[k * stride] = line[k];
+            } });
+    }
+
+    // Funkcja Greena siatki izolowanej dla h = 1: -1/r (P3M: -erf(r / 2 r_s) / r), odległości z zawinięciem na 2m
+    void BuildIsolatedKernel(ThreadPool &pool)
+    {
+        if (kernelSize == padded && kernelShortRange == shortRange && kernelSplit == split)
+            return;
+        const size_t p = padded;
+        const double s = split, norm = 1.0 / (double(p) * p * p); // Normalizacja odwrotnej FFT wliczona w kernel
+        std::vector<Cell> mass;
+        mass.swap(work); // TransformAxis działa na work
+        work.assign(p * p * p, Cell(0.0f, 0.0f));
+        pool.ParallelFor(0, p, 1, [&](size_t z0, size_t z1)
+                         {
+            for (size_t z = z0; z < z1; ++z)
+                for (size_t y = 0; y < p; ++y)
+                    for (size_t x = 0; x < p; ++x)
+                    {
+                        double dx = x < m ? double(x) : double(x) - double(p);
+                        double dy = y < m ? double(y) : double(y) - double(p);
+                        double dz = z < m ? double(z) : double(z) - double(p);
+                        double r = std::sqrt(dx * dx + dy * dy + dz * dz);
+                        double g;
+                        if (shortRange)
+                            g = r > 0.0 ? -std::erf(r / (2.0 * s)) / r : -1.0 / (std::sqrt(3.14159265358979323846) * s);
+                        else
+                            g = r > 0.0 ? -1.0 / r : -2.3800772; // Średnia 1/r po oczku
+                        work[(z * p + y) * p + x] = Cell(float(g * norm), 0.0f);
+                    }
+        });
+        for (int axis = 0; axis < 3; ++axis)
+            TransformAxis(axis, false, p, p, pool);
+        kernel.swap(work);
+        work.swap(mass);
+        kernelSize = p;
+        kernelShortRange = shortRange;
+        kernelSplit = split;
+    }
+
+    // Potencjał w węzłach: splot mas z funkcją Greena przez FFT (izolowana) albo -4 pi rho / k^2 (periodyczna)
+    void SolvePotential(ThreadPool &pool)
+    {
+        const size_t p = padded;
+        fft.Init(p);
+        if (boundary == MeshBoundary::Isolated)
+        {
+            BuildIsolatedKernel(pool);
+            // Masy tylko w [0, m)^3: pierwsze przejścia pomijają linie samych zer
+            TransformAxis(0, false, m, m, pool);
+            TransformAxis(1, false, p, m, pool);
+            TransformAxis(2, false, p, p, pool);
+            const float invH = float(1.0 / h);
+            pool.ParallelFor(0, work.size(), 1 << 16, [&](size_t k0, size_t k1)
+                             {
+                for (size_t k = k0; k < k1; ++k)
+                {
+                    Cell a = work[k], b = kernel[k];
+                    work[k] = Cell((a.real() * b.real() - a.imag() * b.imag()) * invH, (a.real() * b.imag() + a.imag() * b.real()) * invH);
+                } });
+            // Potrzebny tylko wynik w [0, m)^3
+            TransformAxis(2, true, p, p, pool);
+            TransformAxis(1, true, p, m, pool);
+            TransformAxis(0, true, m, m, pool);
+        }
+        else
+        {
+            for (int axis = 0; axis < 3; ++axis)
+                TransformAxis(axis, false, p, p, pool);
+            const double pi = 3.14159265358979323846;
+            const double rs = double(split) * h;
+            const double factor = -4.0 * pi / (h * h * h) / (double(p) * p * p); // rho = masa / h^3, normalizacja odwrotnej FFT
+            pool.ParallelFor(0, p, 1, [&](size_t z0, size_t z1)
+                             {
+                for (size_t z = z0; z < z1; ++z)
+                    for (size_t y = 0; y < p; ++y)
+                        for (size_t x = 0; x < p; ++x)
+                        {
+                            size_t idx = (z * p + y) * p + x;
+                            double kk = 0.0, window = 1.0;
+                            for (size_t c : {x, y, z})
+                            {
+                                double wave = double(c < p / 2 ? (long long)c : (long long)c - (long long)p);
+                                double k = 2.0 * pi * wave / period;
+                                double arg = pi * wave / double(p); // Okno CIC: sinc^2
+                                double sinc = wave != 0.0 ? std::sin(arg) / arg : 1.0;
+                                kk += k * k;
+                                window *= sinc * sinc;
+                            }
+                            double green = kk > 0.0 ? factor / kk / window : 0.0; // Średnia gęstość nie daje sił
+                            if (shortRange)
+                                green *= std::exp(-kk * rs * rs);
+                            work[idx] *= float(green);
+                        }
+            });
+            for (int axis = 2; axis >= 0; --axis)
+                TransformAxis(axis, true, p, p, pool);
+        }
+        potential.resize(m * m * m);
+        pool.ParallelFor(0, m, 1, [&](size_t z0, size_t z1)
+                         {
+            for (size_t z = z0; z < z1; ++z)
+                for (size_t y = 0; y < m; ++y)
+                    for (size_t x = 0; x < m; ++x)
+                        potential[Node(x, y, z)] = work[(z * p + y) * p + x].real(); });
+    }
+
+    // -grad potencjału w węzłach, różnice 4-punktowe (4. rząd); na brzegu siatki izolowanej indeksy przycięte
+    void Gradient(ThreadPool &pool)
+    {
+        fx.resize(m * m * m);
+        fy.resize(m * m * m);
+        fz.resize(m * m * m);
+        const long long mm = (long long)m;
+        const float inv12h = float(1.0 / (12.0 * h));
+        auto at = [&](long long i)
+        {
+            if (boundary == MeshBoundary::Periodic)
+                return size_t(((i % mm) + mm) % mm);
+            return size_t(std::min(std::max(i, 0LL), mm - 1));
+        };
+        pool.ParallelFor(0, m, 1, [&](size_t z0, size_t z1)
+                         {
+            for (size_t z = z0; z < z1; ++z)
+                for (size_t y = 0; y < m; ++y)
+                    for (size_t x = 0; x < m; ++x)
+                    {
+                        long long c[3] = {(long long)x, (long long)y, (long long)z};
+                        float g[3];
+                        for (int d = 0; d < 3; ++d)
+                        {
+                            float values[4];
+                            const int offsets[4] = {-2, -1, 1, 2};
+                            for (int o = 0; o < 4; ++o)
+                            {
+                                long long q[3] = {c[0], c[1], c[2]};
+                                q[d] += offsets[o];
+                                values[o] = potential[Node(at(q[0]), at(q[1]), at(q[2]))];
+                            }
+                            g[d] = -(8.0f * (values[2] - values[1]) - (values[3] - values[0])) * inv12h;
+                        }
+                        size_t node = Node(x, y, z);
+                        fx[node] = g[0];
+                        fy[node] = g[1];
+                        fz[node] = g[2];
+                    } });
+    }
+
+    // Siła w położeniu ciała z tych samych wag CIC co przy rozkładaniu mas (brak samooddziaływania średnio)
+    void Interpolate(const BodyStore &bodies, FloatArray &ax, FloatArray &ay, FloatArray &az, ThreadPool &pool) const
+    {
+        const double scale = G / (double(kDistanceToMeters) * kDistanceToMeters); // Odległości w km -> m
+        pool.ParallelFor(0, active.size(), 1024, [&](size_t k0, size_t k1)
+                         {
+            for (size_t k = k0; k < k1; ++k)
+            {
+                size_t i = active[k], base[3];
+                double frac[3], sum[3] = {0.0, 0.0, 0.0};
+                CloudOf(bodies, i, base, frac);
+                for (int c = 0; c < 8; ++c)
+                {
+                    double w = 1.0;
+                    size_t node[3];
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        bool upper = (c >> d) & 1;
+                        w *= upper ? frac[d] : 1.0 - frac[d];
+                        node[d] = Wrap(base[d] + (upper ? 1 : 0));
+                    }
+                    size_t idx = Node(node[0], node[1], node[2]);
+                    sum[0] += w * fx[idx];
+                    sum[1] += w * fy[idx];
+                    sum[2] += w * fz[idx];
+                }
+                ax[i] = float(sum[0] * scale);
+                ay[i] = float(sum[1] * scale);
+                az[i] = float(sum[2] * scale);
+            } });
+    }
+
+    // Część bliska P3M: m / r^2 [erfc(r / 2 r_s) + r / (r_s sqrt(pi)) exp(-r^2 / 4 r_s^2)] do r_cut, lista komórek o boku >= r_cut
+    void AddShortRange(const BodyStore &bodies, FloatArray &ax, FloatArray &ay, FloatArray &az, ThreadPool &pool)
+    {
+        const double rs = double(split) * h, rcut = double(cutoff) * rs, rcut2 = rcut * rcut;
+        const double invSqrtPi = 0.5641895835477563;
+        const bool periodic = boundary == MeshBoundary::Periodic;
+        // Komórki nad obszarem siatki (izolowana: węzły 0..m-1, periodyczna: pudło)
+        const double span = periodic ? period : h * double(m - 1);
+        const size_t cells = size_t(std::min(std::max(std::floor(span / rcut), 1.0), 128.0));
+        const double cellSize = span / double(cells);
+        auto cellCoordinate = [&](size_t i, int d)
+        {
+            double u = GridCoordinate(bodies, d, i) * h / cellSize;
+            return size_t(std::min(std::max(u, 0.0), double(cells - 1)));
+        };
+        std::vector<uint32_t> cellOf(active.size());
+        cellStart.assign(cells * cells * cells + 1, 0);
+        for (size_t k = 0; k < active.size(); ++k)
+        {
+            size_t i = active[k];
+            cellOf[k] = uint32_t((cellCoordinate(i, 2) * cells + cellCoordinate(i, 1)) * cells + cellCoordinate(i, 0));
+            ++cellStart[cellOf[k] + 1];
+        }
+        for (size_t c = 0; c + 1 < cellStart.size(); ++c)
+            cellStart[c + 1] += cellStart[c];
+        cellBodies.resize(active.size());
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (size_t k = 0; k < active.size(); ++k)
+            cellBodies[fill[cellOf[k]]++] = active[k];
+
+        // Sąsiednie komórki na osi (bez powtórzeń, gdy komórek jest mniej niż 3)
+        auto neighbours = [&](size_t c, size_t out[3])
+        {
+            size_t count = 0;
+            for (long long o = -1; o <= 1; ++o)
+            {
+                long long q = (long long)c + o;
+                if (periodic)
+                    q = (q + (long long)cells) % (long long)cells;
+                else if (q < 0 || q >= (long long)cells)
+                    continue;
+                bool seen = false;
+                for (size_t s = 0; s < count; ++s)
+                    seen |= out[s] == size_t(q);
+                if (!seen)
+                    out[count++] = size_t(q);
+            }
+            return count;
+        };
+        const double scale = G / (double(kDistanceToMeters) * kDistanceToMeters);
+        pool.ParallelFor(0, active.size(), 256, [&](size_t k0, size_t k1)
+                         {
+            for (size_t k = k0; k < k1; ++k)
+            {
+                size_t i = active[k];
+                size_t c[3] = {cellCoordinate(i, 0), cellCoordinate(i, 1), cellCoordinate(i, 2)};
+                size_t nx[3], ny[3], nz[3];
+                size_t cx = neighbours(c[0], nx), cy = neighbours(c[1], ny), cz = neighbours(c[2], nz);
+                double sum[3] = {0.0, 0.0, 0.0};
+                for (size_t a = 0; a < cz; ++a)
+                    for (size_t b = 0; b < cy; ++b)
+                        for (size_t e = 0; e < cx; ++e)
+                        {
+                            size_t cell = (nz[a] * cells + ny[b]) * cells + nx[e];
+                            for (uint32_t q = cellStart[cell]; q < cellStart[cell + 1]; ++q)
+                            {
+                                size_t j = cellBodies[q];
+                                if (j == i)
+                                    continue;
+                                double d[3] = {double(bodies.x[j]) - bodies.x[i], double(bodies.y[j]) - bodies.y[i],
+                                               double(bodies.z[j]) - bodies.z[i]};
+                                if (periodic) // Najbliższy obraz
+                                {
+                                    for (double &v : d)
+                                        v -= period * std::floor(v / period + 0.5);
+                                }
+                                double r2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+                                if (r2 <= 0.0 || r2 >= rcut2)
+                                    continue;
+                                double r = std::sqrt(r2), u = r / (2.0 * rs);
+                                double w = bodies.mass[j] * (std::erfc(u) + r / rs * invSqrtPi * std::exp(-u * u)) / (r2 * r);
+                                for (int dd = 0; dd < 3; ++dd)
+                                    sum[dd] += d[dd] * w;
+                            }
+                        }
+                ax[i] += float(sum[0] * scale);
+                ay[i] += float(sum[1] * scale);
+                az[i] += float(sum[2] * scale);
+            } });
+    }
+};
+
+// Błąd względny przyspieszeń z siatki w porównaniu z sumą bezpośrednią (siatka izolowana; periodyczna ma obrazy)
+inline ForceError CompareMeshToDirect(ParticleMesh &mesh, const BodyStore &bodies, size_t maxSamples = 1000)
+{
+    ForceError err;
+    FloatArray ax, ay, az;
+    mesh.Accelerations(bodies, ax, ay, az);
+    size_t n = bodies.size();
+    size_t stride = std::max<size_t>(1, n / std::max<size_t>(1, maxSamples));
+    for (size_t i = 0; i < n; i += stride)
+    {
+        float direct[3];
+        DirectAccelerationOf(bodies, i, direct);
+        double ref = std::sqrt(double(direct[0]) * direct[0] + double(direct[1]) * direct[1] + double(direct[2]) * direct[2]);
+        if (ref <= 0.0)
+            continue;
+        double ex = ax[i] - direct[0], ey = ay[i] - direct[1], ez = az[i] - direct[2];
+        double rel = std::sqrt(ex * ex + ey * ey + ez * ez) / ref;
+        err.mean += rel;
+        err.rms += rel * rel;
+        err.max = std::max(err.max, rel);
+        ++err.samples;
+    }
+    if (err.samples > 0)
+    {
+        err.mean /= err.samples;
+        err.rms = std::sqrt(err.rms / err.samples);
+    }
+    return err;
+}
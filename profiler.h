@@ -0,0 +1,225 @@
+// Profiler faz klatki: zakresowe liczniki CPU, czasy GPU dopisywane z opóźnieniem, historia do nakładki i zapis śladu
+#pragma once
+
+#include <vector> // std::vector
+#include <mutex> // std::mutex: zdarzenia z wątku fizyki i renderowania
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::steady_clock
+#include <thread> // std::this_thread::get_id
+#include <functional> // std::hash
+#include <fstream> // std::ofstream
+#include <cstring> // std::strcmp
+#include <algorithm> // std::min
+#include <cstdint> // uint32_t
+
+// Wyłączony profiler kosztuje jeden odczyt atomowy na zakres; włączony: blokada i dopisanie zdarzenia
+class Profiler
+{
+public:
+    static const int kHistory = 120; // Klatki pamiętane dla nakładki
+
+    // Jedno zmierzone wystąpienie fazy (czasy w mikrosekundach od startu profilera)
+    struct Event
+    {
+        const char *name; // Literał: nazwa fazy
+        uint32_t thread; // Skrót identyfikatora wątku; kGpuThread dla czasów GPU
+        long long frame;
+        double start, duration;
+    };
+
+    // Czasy fazy w ostatnich klatkach (ms; suma wystąpień w klatce)
+    struct Phase
+    {
+        const char *name;
+        bool gpu;
+        double current = 0.0; // Bieżąca klatka
+        double history[kHistory] = {};
+        double total = 0.0; // Od włączenia (ms)
+        long long calls = 0;
+    };
+
+    static const uint32_t kGpuThread = 0xFFFFFFFFu;
+
+    // keepEvents: zapamiętuj pojedyncze zdarzenia (do śladu); bez tego tylko historia faz
+    void Enable(bool keepEvents)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        keep = keep || keepEvents;
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    bool Enabled() const
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // Mikrosekundy od utworzenia profilera (wspólna oś czasu śladu)
+    double Now() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // Zmierzona faza CPU bieżącego wątku
+    void Record(const char *name, double start, double duration)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Add(PhaseOf(name, false), duration);
+        if (keep)
+            events.push_back(Event{name, ThreadTag(), frame, start, duration});
+    }
+
+    // Faza GPU (start na osi czasu profilera); zaliczana do klatki, w której ją odczytano
+    void RecordGpu(const char *name, double start, double duration)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Add(PhaseOf(name, true), duration);
+        if (keep)
+            events.push_back(Event{name, kGpuThread, frame, start, duration});
+    }
+
+    // Zamyka bieżącą klatkę: sumy faz trafiają do historii (wołane raz na klatkę przez renderowanie)
+    void EndFrame()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        double now = Now();
+        int slot = int(frame % kHistory);
+        frameHistory[slot] = frame > 0 ? (now - frameStart) / 1000.0 : 0.0;
+        frameStart = now;
+        for (Phase &phase : phases)
+        {
+            phase.history[slot] = phase.current;
+            phase.current = 0.0;
+        }
+        ++frame;
+    }
+
+    // Migawka historii do rysowania (kopie, bez trzymania blokady przez rysowanie)
+    long long Snapshot(std::vector<Phase> &phasesOut, double (&framesOut)[kHistory])
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        phasesOut = phases;
+        for (int k = 0; k < kHistory; ++k)
+            framesOut[k] = frameHistory[k];
+        return frame;
+    }
+
+    // Średnie ms na klatkę (z historii) dla fazy; -1, gdy jej nie ma
+    double AverageMs(const char *name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int frames = int(std::min<long long>(frame, kHistory));
+        for (const Phase &phase : phases)
+        {
+            if (std::strcmp(phase.name, name) != 0 || frames == 0)
+                continue;
+            double sum = 0.0;
+            for (int k = 0; k < frames; ++k)
+                sum += phase.history[k];
+            return sum / frames;
+        }
+        return -1.0;
+    }
+
+    // Ślad w formacie Chrome (chrome://tracing, Perfetto): zdarzenia "X" z czasem i długością w mikrosekundach
+    bool WriteChromeTrace(const char *path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ofstream out(path);
+        if (!out)
+            return false;
+        out << "{\"traceEvents\":[\n";
+        for (size_t e = 0; e < events.size(); ++e)
+        {
+            const Event &ev = events[e];
+            out << "{\"name\":\"" << ev.name << "\",\"cat\":\"" << (ev.thread == kGpuThread ? "gpu" : "cpu")
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (ev.thread == kGpuThread ? 0u : ev.thread) << ",\"ts\":" << ev.start
+                << ",\"dur\":" << ev.duration << ",\"args\":{\"frame\":" << ev.frame << "}}" << (e + 1 < events.size() ? ",\n" : "\n");
+        }
+        out << "],\"displayTimeUnit\":\"ms\"}\n";
+        return bool(out);
+    }
+
+    // Te same zdarzenia jako CSV: klatka, wątek (gpu = czasy GPU), faza, start i długość w mikrosekundach
+    bool WriteCsv(const char *path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ofstream out(path);
+        if (!out)
+            return false;
+        out << "frame,thread,phase,start_us,duration_us\n";
+        for (const Event &ev : events)
+        {
+            out << ev.frame << ',';
+            if (ev.thread == kGpuThread)
+                out << "gpu";
+            else
+                out << ev.thread;
+            out << ',' << ev.name << ',' << ev.start << ',' << ev.duration << '\n';
+        }
+        return bool(out);
+    }
+
+private:
+    std::atomic<bool> enabled{false};
+    bool keep = false;
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::vector<Phase> phases;
+    double frameHistory[kHistory] = {};
+    double frameStart = 0.0;
+    long long frame = 0;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+    // Nazwy to literały, więc zwykle wystarcza porównanie wskaźników
+    Phase &PhaseOf(const char *name, bool gpu)
+    {
+        for (Phase &phase : phases)
+        {
+            if (phase.gpu == gpu && (phase.name == name || std::strcmp(phase.name, name) == 0))
+                return phase;
+        }
+        phases.push_back(Phase{name, gpu});
+        return phases.back();
+    }
+
+    static void Add(Phase &phase, double duration)
+    {
+        phase.current += duration / 1000.0;
+        phase.total += duration / 1000.0;
+        ++phase.calls;
+    }
+
+    static uint32_t ThreadTag()
+    {
+        return uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id()) & 0x7FFFFFFF);
+    }
+};
+
+// Wspólny profiler procesu (jak GlobalPool)
+inline Profiler &GlobalProfiler()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+// Pomiar od konstrukcji do końca zakresu; nic nie robi, gdy profiler jest wyłączony
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char *name, Profiler &profiler = GlobalProfiler())
+        : profiler(profiler), name(name), start(profiler.Enabled() ? profiler.Now() : -1.0) {}
+
+    ~ProfileScope()
+    {
+        if (start >= 0.0)
+            profiler.Record(name, start, profiler.Now() - start);
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    Profiler &profiler;
+    const char *name;
+    double start;
+};
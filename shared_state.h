@@ -0,0 +1,371 @@
+// Eksport stanu ciał do pierścienia w pamięci współdzielonej POSIX: zapis co krok bez czekania na czytelników,
+// dowolna liczba lokalnych procesów czyta klatki wprost z mapowania (seqlock na slot). Bez zależności od silnika,
+// żeby zewnętrzne narzędzia mogły włączyć sam ten plik (czytelnik: SharedStateReader, przykład: shm_consumer.cpp).
+#pragma once
+
+#include <atomic> // std::atomic, std::atomic_thread_fence
+#include <string> // std::string
+#include <cstring> // std::memcpy, std::memcmp
+#include <cstdint> // uint32_t, uint64_t, int64_t
+#include <cstddef> // size_t
+#include <new> // placement new nagłówka
+#include <algorithm> // std::max
+#ifndef _WIN32
+#include <sys/mman.h> // shm_open, mmap
+#include <sys/stat.h> // fstat, tryb dostępu
+#include <fcntl.h> // O_CREAT, O_RDWR
+#include <unistd.h> // ftruncate, close, getpid
+#endif
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory seqlock needs lock-free 64-bit atomics");
+
+// Początek segmentu. Klatka f leży w slocie f % slotCount; slot to SharedFrameHeader i tablice po capacity elementów.
+struct SharedStateHeader
+{
+    static const uint32_t kVersion = 1;
+    static const uint32_t kLive = 1; // Zapisujący działa
+    static const uint32_t kClosed = 2; // Zapisujący skończył albo zastąpił segment większym: otworzyć ponownie
+
+    char magic[8]; // "PHYSSHM"
+    uint32_t version;
+    uint32_t headerBytes; // sizeof(SharedStateHeader) zapisującego
+    uint32_t slotCount;
+    uint32_t capacity; // Najwięcej ciał w klatce
+    uint64_t slotBytes;
+    uint64_t segmentBytes;
+    std::atomic<uint64_t> published; // Liczba opublikowanych klatek (ostatnia: published - 1)
+    std::atomic<uint32_t> state;
+    uint32_t writerPid;
+    char reserved[64];
+};
+
+// Początek slotu. sequence = 2f + 1 w trakcie zapisu klatki f, 2f + 2 po zapisie.
+struct alignas(64) SharedFrameHeader
+{
+    std::atomic<uint64_t> sequence;
+    uint64_t frame;
+    double time; // Czas symulacji (ticki)
+    int64_t stepCount;
+    uint64_t count; // Liczba ciał
+};
+
+// Układ tablic w slocie (struktura tablic, każda wyrównana do 64 B)
+struct SharedSlotLayout
+{
+    static const int kFloatArrays = 7; // x, y, z, vx, vy, vz, mass
+
+    size_t floatOffset[kFloatArrays];
+    size_t idsOffset;
+    size_t slotBytes;
+
+    explicit SharedSlotLayout(size_t capacity)
+    {
+        size_t offset = sizeof(SharedFrameHeader);
+        for (int a = 0; a < kFloatArrays; ++a)
+        {
+            floatOffset[a] = offset;
+            offset = Align(offset + capacity * sizeof(float));
+        }
+        idsOffset = offset;
+        slotBytes = Align(offset + capacity * sizeof(uint64_t));
+    }
+
+    static size_t Align(size_t bytes) { return (bytes + 63) & ~size_t(63); }
+};
+
+inline size_t SharedHeaderBytes()
+{
+    return SharedSlotLayout::Align(sizeof(SharedStateHeader));
+}
+
+// Stan do opublikowania: wskaźniki na tablice o długości count
+struct SharedFrameSource
+{
+    const float *x, *y, *z, *vx, *vy, *vz, *mass;
+    const uint64_t *ids;
+    size_t count;
+    double time;
+    int64_t stepCount;
+};
+
+// Klatka widziana przez czytelnika: wskaźniki prosto do pamięci współdzielonej (bez kopii).
+// Po obliczeniach SharedStateReader::Valid mówi, czy zapisujący nie nadpisał slotu w trakcie czytania.
+struct SharedFrame
+{
+    uint64_t frame = 0;
+    double time = 0.0;
+    int64_t stepCount = 0;
+    size_t count = 0;
+    const float *x = nullptr, *y = nullptr, *z = nullptr, *vx = nullptr, *vy = nullptr, *vz = nullptr, *mass = nullptr;
+    const uint64_t *ids = nullptr;
+    const SharedFrameHeader *slot = nullptr;
+};
+
+// Strona silnika: tworzy segment, publikuje klatki, przy wzroście liczby ciał ponad pojemność tworzy większy segment
+class SharedStateWriter
+{
+public:
+    ~SharedStateWriter()
+    {
+        Close();
+    }
+
+    // name: nazwa POSIX ("/physics"); istniejący segment o tej nazwie (np. po awarii) jest zastępowany
+    bool Create(const std::string &name, size_t capacity, uint32_t slots, std::string &error)
+    {
+        Close();
+        this->name = name;
+        slotCount = std::max(slots, 2u); // Jeden slot w zapisie, reszta do czytania
+        return Map(std::max<size_t>(capacity, 1), error);
+    }
+
+    bool IsOpen() const { return header != nullptr; }
+
+    // Zapis klatki; nie czeka na czytelników. false, gdy nie udało się powiększyć segmentu
+    bool Publish(const SharedFrameSource &source)
+    {
+        if (!header)
+            return false;
+        if (source.count > header->capacity) // Nowy segment z zapasem; czytelnicy starego widzą kClosed
+        {
+            std::string error;
+            size_t capacity = source.count + source.count / 2;
+            Unmap();
+            if (!Map(capacity, error))
+                return false;
+        }
+        uint64_t f = header->published.load(std::memory_order_relaxed);
+        unsigned char *slot = base + SharedHeaderBytes() + (f % slotCount) * header->slotBytes;
+        SharedFrameHeader *frame = reinterpret_cast<SharedFrameHeader *>(slot);
+        frame->sequence.store(2 * f + 1, std::memory_order_relaxed); // Nieparzysty: slot w zapisie
+        std::atomic_thread_fence(std::memory_order_release); // Znacznik przed danymi
+        const float *arrays[SharedSlotLayout::kFloatArrays] = {source.x, source.y, source.z, source.vx, source.vy, source.vz, source.mass};
+        for (int a = 0; a < SharedSlotLayout::kFloatArrays; ++a)
+            std::memcpy(slot + layout.floatOffset[a], arrays[a], source.count * sizeof(float));
+        std::memcpy(slot + layout.idsOffset, source.ids, source.count * sizeof(uint64_t));
+        frame->frame = f;
+        frame->time = source.time;
+        frame->stepCount = source.stepCount;
+        frame->count = source.count;
+        frame->sequence.store(2 * f + 2, std::memory_order_release); // Dane przed znacznikiem
+        header->published.store(f + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Oznacza koniec dla czytelników i usuwa nazwę segmentu
+    void Close()
+    {
+        if (!header)
+            return;
+        Unmap();
+    }
+
+private:
+    std::string name;
+    uint32_t slotCount = 4;
+    SharedSlotLayout layout{0};
+    SharedStateHeader *header = nullptr;
+    unsigned char *base = nullptr;
+    size_t mappedBytes = 0;
+
+    bool Map(size_t capacity, std::string &error)
+    {
+#ifndef _WIN32
+        layout = SharedSlotLayout(capacity);
+        size_t bytes = SharedHeaderBytes() + slotCount * layout.slotBytes;
+        shm_unlink(name.c_str()); // Czytelnicy starego segmentu zachowują swoje mapowanie
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+        {
+            error = "shm_open failed";
+            return false;
+        }
+        if (ftruncate(fd, off_t(bytes)) != 0)
+        {
+            error = "cannot size shared memory segment";
+            close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd); // Mapowanie trzyma segment
+        if (memory == MAP_FAILED)
+        {
+            error = "mmap failed";
+            shm_unlink(name.c_str());
+            return false;
+        }
+        base = static_cast<unsigned char *>(memory);
+        mappedBytes = bytes;
+        header = new (base) SharedStateHeader(); // Segment z ftruncate jest wyzerowany
+        std::memcpy(header->magic, "PHYSSHM", 8);
+        header->version = SharedStateHeader::kVersion;
+        header->headerBytes = uint32_t(sizeof(SharedStateHeader));
+        header->slotCount = slotCount;
+        header->capacity = uint32_t(capacity);
+        header->slotBytes = layout.slotBytes;
+        header->segmentBytes = bytes;
+        header->writerPid = uint32_t(getpid());
+        header->published.store(0, std::memory_order_relaxed);
+        for (uint32_t s = 0; s < slotCount; ++s)
+            new (base + SharedHeaderBytes() + s * layout.slotBytes) SharedFrameHeader();
+        header->state.store(SharedStateHeader::kLive, std::memory_order_release); // Na końcu: czytelnik widzi gotowy nagłówek
+        return true;
+#else
+        (void)capacity;
+        error = "POSIX shared memory not available on this platform";
+        return false;
+#endif
+    }
+
+    void Unmap()
+    {
+#ifndef _WIN32
+        header->state.store(SharedStateHeader::kClosed, std::memory_order_release);
+        munmap(base, mappedBytes);
+        shm_unlink(name.c_str());
+#endif
+        header = nullptr;
+        base = nullptr;
+        mappedBytes = 0;
+    }
+};
+
+// Strona czytelnika: mapowanie tylko do odczytu, żadnych zapisów do segmentu, więc czytelnicy nie spowalniają silnika
+class SharedStateReader
+{
+public:
+    enum class Status
+    {
+        Frame, // Nowa klatka
+        NoFrame, // Nic nowego od ostatniego odczytu
+        Closed // Zapisujący skończył albo przeniósł się do większego segmentu: Open ponownie
+    };
+
+    uint64_t dropped = 0; // Klatki nadpisane, zanim Next zdążył je przeczytać
+
+    ~SharedStateReader()
+    {
+        Close();
+    }
+
+    bool Open(const std::string &name, std::string &error)
+    {
+        Close();
+#ifndef _WIN32
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            error = "no shared memory segment " + name;
+            return false;
+        }
+        struct stat info;
+        void *memory = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(SharedStateHeader))
+            memory = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED)
+        {
+            error = "cannot map " + name;
+            return false;
+        }
+        base = static_cast<const unsigned char *>(memory);
+        mappedBytes = size_t(info.st_size);
+        header = reinterpret_cast<const SharedStateHeader *>(base);
+        if (std::memcmp(header->magic, "PHYSSHM", 8) != 0 || header->version != SharedStateHeader::kVersion ||
+            header->headerBytes != sizeof(SharedStateHeader) || header->segmentBytes > mappedBytes ||
+            header->state.load(std::memory_order_acquire) == 0)
+        {
+            error = "incompatible or unfinished segment " + name;
+            Close();
+            return false;
+        }
+        layout = SharedSlotLayout(header->capacity);
+        next = header->published.load(std::memory_order_acquire); // Od bieżącej klatki
+        if (next > 0)
+            --next;
+        dropped = 0;
+        return true;
+#else
+        error = "POSIX shared memory not available on this platform";
+        return false;
+#endif
+    }
+
+    void Close()
+    {
+#ifndef _WIN32
+        if (base)
+            munmap(const_cast<unsigned char *>(base), mappedBytes);
+#endif
+        base = nullptr;
+        header = nullptr;
+        mappedBytes = 0;
+    }
+
+    const SharedStateHeader *Header() const { return header; }
+
+    // Najnowsza klatka (pomija zaległe); dla podglądu na żywo
+    Status Latest(SharedFrame &frame)
+    {
+        if (!header || header->state.load(std::memory_order_acquire) != SharedStateHeader::kLive)
+            return Status::Closed;
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        if (published == 0 || published <= next)
+            return Status::NoFrame;
+        return Read(published - 1, frame) ? Status::Frame : Status::NoFrame;
+    }
+
+    // Następna klatka po kolei; gdy czytelnik nie nadąża, przeskakuje do najstarszej w pierścieniu i liczy dropped
+    Status Next(SharedFrame &frame)
+    {
+        if (!header || header->state.load(std::memory_order_acquire) != SharedStateHeader::kLive)
+            return Status::Closed;
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        if (published <= next)
+            return Status::NoFrame;
+        uint64_t oldest = published > header->slotCount - 1 ? published - (header->slotCount - 1) : 0; // Slot w zapisie pomijany
+        if (next < oldest)
+        {
+            dropped += oldest - next;
+            next = oldest;
+        }
+        return Read(next, frame) ? Status::Frame : Status::NoFrame;
+    }
+
+    // Czy dane klatki były spójne przez cały czas czytania (zapisujący nie zaczął nadpisywać slotu)
+    bool Valid(const SharedFrame &frame) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire); // Odczyty danych przed ponownym odczytem znacznika
+        return frame.slot && frame.slot->sequence.load(std::memory_order_relaxed) == 2 * frame.frame + 2;
+    }
+
+private:
+    const unsigned char *base = nullptr;
+    const SharedStateHeader *header = nullptr;
+    size_t mappedBytes = 0;
+    SharedSlotLayout layout{0};
+    uint64_t next = 0; // Następna klatka dla Next
+
+    bool Read(uint64_t f, SharedFrame &frame)
+    {
+        const unsigned char *slot = base + SharedHeaderBytes() + (f % header->slotCount) * header->slotBytes;
+        const SharedFrameHeader *sf = reinterpret_cast<const SharedFrameHeader *>(slot);
+        if (sf->sequence.load(std::memory_order_acquire) != 2 * f + 2) // W zapisie albo już nadpisany: Next przeskoczy dalej
+            return false;
+        next = f + 1;
+        frame.frame = f;
+        frame.time = sf->time;
+        frame.stepCount = sf->stepCount;
+        frame.count = size_t(std::min<uint64_t>(sf->count, header->capacity));
+        const float **arrays[SharedSlotLayout::kFloatArrays] = {&frame.x, &frame.y, &frame.z, &frame.vx, &frame.vy, &frame.vz, &frame.mass};
+        for (int a = 0; a < SharedSlotLayout::kFloatArrays; ++a)
+            *arrays[a] = reinterpret_cast<const float *>(slot + layout.floatOffset[a]);
+        frame.ids = reinterpret_cast<const uint64_t *>(slot + layout.idsOffset);
+        frame.slot = sf;
+        if (Valid(frame)) // Nagłówek klatki spójny z danymi
+            return true;
+        ++dropped;
+        return false;
+    }
+};
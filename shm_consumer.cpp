@@ -0,0 +1,96 @@
+// Przykładowy czytelnik stanu z pamięci współdzielonej (silnik z --shm NAME): raz na sekundę liczba klatek,
+// zgubione klatki, środek masy i energia kinetyczna. Liczy wprost na mapowaniu, bez kopiowania tablic.
+#include <cstdio> // std::printf, std::fprintf
+#include <cstdlib> // std::atoll
+#include <cstring> // std::strcmp
+#include <chrono> // std::chrono::steady_clock
+#include <thread> // std::this_thread::sleep_for
+#include <string> // std::string
+
+#include "shared_state.h" // SharedStateReader
+
+int main(int argc, char **argv)
+{
+    // Argumenty: NAME [--latest] [--frames N]
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s NAME [--latest] [--frames N]\n", argv[0]);
+        return 1;
+    }
+    const char *name = argv[1];
+    bool latest = false; // Tylko najnowsza klatka (podgląd) zamiast każdej po kolei
+    long long maxFrames = 0; // 0 = bez końca
+    for (int i = 2; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--latest") == 0)
+            latest = true;
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            maxFrames = std::atoll(argv[++i]);
+    }
+
+    SharedStateReader reader;
+    std::string error;
+    long long frames = 0, torn = 0, framesThisSecond = 0;
+    auto lastReport = std::chrono::steady_clock::now();
+    while (maxFrames == 0 || frames < maxFrames)
+    {
+        if (!reader.Header())
+        {
+            if (!reader.Open(name, error)) // Silnik jeszcze nie ruszył albo właśnie zmienia segment
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            std::printf("%s: %u slots, capacity %u bodies, writer pid %u\n", name, reader.Header()->slotCount,
+                        reader.Header()->capacity, reader.Header()->writerPid);
+        }
+        SharedFrame frame;
+        SharedStateReader::Status status = latest ? reader.Latest(frame) : reader.Next(frame);
+        if (status == SharedStateReader::Status::Closed)
+        {
+            reader.Close();
+            continue;
+        }
+        if (status == SharedStateReader::Status::NoFrame)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+
+        double mass = 0.0, cx = 0.0, cy = 0.0, cz = 0.0, kinetic = 0.0; // Obliczenia wprost na pamięci współdzielonej
+        for (size_t i = 0; i < frame.count; ++i)
+        {
+            double m = frame.mass[i];
+            mass += m;
+            cx += m * frame.x[i];
+            cy += m * frame.y[i];
+            cz += m * frame.z[i];
+            kinetic += 0.5 * m * (double(frame.vx[i]) * frame.vx[i] + double(frame.vy[i]) * frame.vy[i] + double(frame.vz[i]) * frame.vz[i]);
+        }
+        if (!reader.Valid(frame)) // Zapisujący okrążył pierścień w trakcie liczenia: wynik odrzucony
+        {
+            ++torn;
+            continue;
+        }
+        ++frames;
+        ++framesThisSecond;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(1) || frames == maxFrames)
+        {
+            if (mass > 0.0)
+            {
+                cx /= mass;
+                cy /= mass;
+                cz /= mass;
+            }
+            std::printf("step %lld, time %.1f: %zu bodies, %lld frames/s, dropped %llu, torn %lld, centre of mass (%g, %g, %g), kinetic energy %g\n",
+                        (long long)frame.stepCount, frame.time, frame.count, framesThisSecond, (unsigned long long)reader.dropped, torn,
+                        cx, cy, cz, kinetic);
+            std::fflush(stdout);
+            framesThisSecond = 0;
+            lastReport = now;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,336 @@
+// Symulacja na osobnym wątku: stały krok fizyki, migawki stanu przez potrójny bufor, polecenia z wejścia przez kolejkę
+#pragma once
+
+#include <vector> // std::vector
+#include <thread> // std::thread
+#include <mutex> // std::mutex: kolejka poleceń
+#include <condition_variable> // std::condition_variable: tryb krok w krok
+#include <atomic> // std::atomic
+#include <chrono> // std::chrono::steady_clock
+#include <cmath> // std::pow
+#include <algorithm> // std::min, std::max
+#include <cstdint> // uint64_t
+#include <functional> // std::function: obserwator kroków
+
+#include "simulation.h" // World
+#include "triple_buffer.h" // TripleBuffer
+#include "log.h" // LOG_WARN: fizyka nie nadąża
+
+// Sekundy zegara monotonicznego; wspólna skala czasu migawek i renderowania
+inline double SimClockSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Polecenie z wątku wejścia; "umieszczane ciało" to ostatnie ciało, jeśli ma flagę initalizing
+struct SimCommand
+{
+    enum Type
+    {
+        AddBody, // Dodaj body z identyfikatorem id
+        GrowPlacing, // Masa umieszczanego ciała id *= value[0]
+        MovePlacing, // Przesunięcie umieszczanego ciała id o value[] promieni
+        Launch, // Koniec umieszczania ciała id: zaczyna oddziaływać
+        SetPaused // value[0] != 0: wstrzymaj kroki fizyki
+    };
+
+    Type type;
+    Body body; // Dla AddBody
+    uint64_t id = 0; // Trwały identyfikator ciała (uchwyt z rejestru wysyłającego): nowego albo umieszczanego
+    float value[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// Niezmienna migawka świata po kroku; pozycje z poprzedniej publikacji pozwalają interpolować
+struct SimSnapshot
+{
+    BodyStore bodies; // Stan po ostatnim kroku
+    std::vector<uint64_t> ids; // Identyfikator ciała i
+    FloatArray prevX, prevY, prevZ; // Pozycje ciała i w poprzedniej migawce
+    double time = 0.0; // Czas symulacji (ticki)
+    long long stepCount = 0;
+    double published = 0.0; // SimClockSeconds() publikacji
+    double interval = 0.0; // Czas od poprzedniej publikacji (s); 0 = brak ruchu do interpolacji
+};
+
+// Właściciel World w trakcie działania: tylko ten wątek dotyka świata między Start i Stop.
+// Renderowanie czyta migawki (Acquire/Latest), wejście wysyła polecenia (Push); żadna strona nie czeka na drugą
+// (równoległa praca klatki idzie na RenderPool, bo GlobalPool jest zajęta siłami tego wątku).
+class SimulationThread
+{
+public:
+    float dt = kFixedDt; // Krok fizyki (ticki)
+    float ticksPerSecond = 60.0f; // Ile kroków na sekundę czasu rzeczywistego
+    int maxStepsPerTick = 8; // Limit nadrabianych kroków (ochrona przed spiralą opóźnień)
+    std::function<void(const World &, const std::vector<uint64_t> &)> onStep; // Z wątku fizyki po starcie i po każdym kroku (świat, identyfikatory)
+    int lockstepSteps = 0; // > 0: bez zegara, tyle kroków na migawkę; następną liczy dopiero po odbiorze poprzedniej (offscreen)
+
+    explicit SimulationThread(World &world) : world(world) {}
+
+    ~SimulationThread()
+    {
+        Stop();
+    }
+
+    SimulationThread(const SimulationThread &) = delete;
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    // Kolejkuje polecenie; wykonane przed następnym krokiem
+    void Push(const SimCommand &command)
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        commands.push_back(command);
+    }
+
+    // Wykonuje zaległe polecenia; przed Start (np. wczytanie sceny) albo z wątku symulacji
+    void ApplyCommands()
+    {
+        {
+            std::lock_guard<std::mutex> lock(commandMutex);
+            pending.swap(commands);
+        }
+        for (const SimCommand &command : pending)
+            Apply(command);
+        pending.clear();
+    }
+
+    // Przejmuje ciała wczytane wprost do świata (np. z checkpointu) z ich identyfikatorami; przed Start
+    void AdoptWorld(const std::vector<uint64_t> &bodyIds)
+    {
+        ids = bodyIds;
+        prevX = world.bodies.x;
+        prevY = world.bodies.y;
+        prevZ = world.bodies.z;
+    }
+
+    void Start()
+    {
+        if (thread.joinable())
+            return;
+        ApplyCommands();
+        Publish(SimClockSeconds(), false);
+        if (onStep)
+            onStep(world, ids);
+        stop = false;
+        thread = std::thread([this]
+                             { Loop(); });
+    }
+
+    void Stop()
+    {
+        if (!thread.joinable())
+            return;
+        stop = true;
+        {
+            std::lock_guard<std::mutex> lock(paceMutex); // Wątek czekający w trybie krok w krok nie przegapi zatrzymania
+        }
+        paced.notify_all();
+        thread.join();
+    }
+
+    // Odbiór najnowszej migawki (tylko wątek renderowania); true, gdy przyszła nowa
+    bool Acquire()
+    {
+        return snapshots.Acquire();
+    }
+
+    const SimSnapshot &Latest() const
+    {
+        return snapshots.Front();
+    }
+
+    // Tryb krok w krok: czeka na migawkę po kolejnych lockstepSteps krokach i ją odbiera. Fizyka następnej
+    // migawki liczy się w tym czasie, gdy wywołujący rysuje bieżącą.
+    void AcquireNext()
+    {
+        {
+            std::unique_lock<std::mutex> lock(paceMutex);
+            paced.wait(lock, [this]
+                       { return produced > consumed || !thread.joinable(); });
+            snapshots.Acquire(); // Wątek fizyki czeka, więc to dokładnie ta migawka
+            consumed = produced;
+        }
+        paced.notify_all();
+    }
+
+private:
+    World &world;
+    std::vector<uint64_t> ids; // Identyfikatory ciał świata (ta sama kolejność co world.bodies)
+    FloatArray prevX, prevY, prevZ; // Pozycje z poprzedniej publikacji (indeksy jak w world.bodies)
+    double lastPublished = 0.0;
+    bool paused = false;
+
+    std::mutex commandMutex;
+    std::vector<SimCommand> commands, pending; // Kolejka i kopia robocza (zamieniane pod blokadą)
+    TripleBuffer<SimSnapshot> snapshots;
+    std::thread thread;
+    std::atomic<bool> stop{false};
+    std::mutex paceMutex; // Tryb krok w krok: liczniki migawek opublikowanych i odebranych
+    std::condition_variable paced;
+    long long produced = 0, consumed = 0;
+
+    void Loop()
+    {
+        if (lockstepSteps > 0)
+        {
+            LockstepLoop();
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / ticksPerSecond));
+        Clock::time_point next = Clock::now() + period;
+        while (!stop)
+        {
+            ApplyCommands();
+            int steps = 0;
+            for (; Clock::now() >= next && steps < maxStepsPerTick; next += period) // Kroki zaległe względem zegara
+            {
+                if (!paused)
+                    Step();
+                ++steps;
+            }
+            if (steps == maxStepsPerTick)
+            {
+                next = Clock::now() + period; // Odrzuć zaległości, gdy fizyka nie nadąża
+                LOG_WARN(Physics, "simulation behind real time, backlog dropped after %d steps", steps);
+            }
+            if (steps > 0)
+                Publish(SimClockSeconds(), true);
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    void LockstepLoop()
+    {
+        while (!stop)
+        {
+            {
+                std::unique_lock<std::mutex> lock(paceMutex);
+                paced.wait(lock, [this]
+                           { return consumed == produced || stop; });
+            }
+            if (stop)
+                return;
+            ApplyCommands();
+            for (int s = 0; s < lockstepSteps && !paused; ++s)
+                Step();
+            Publish(SimClockSeconds(), true);
+            {
+                std::lock_guard<std::mutex> lock(paceMutex);
+                ++produced;
+            }
+            paced.notify_all();
+        }
+    }
+
+    void Step()
+    {
+        world.step(dt);
+        if (!world.removed.empty())
+        {
+            EraseIndices(ids, world.removed); // Zlepienia: te same usunięcia co w BodyStore, jedno przejście
+            for (FloatArray *a : {&prevX, &prevY, &prevZ})
+                EraseIndices(*a, world.removed);
+            world.removed.clear();
+        }
+        if (onStep)
+            onStep(world, ids);
+    }
+
+    // Indeks ciała o identyfikatorze id; szukanie od końca, bo umieszczane ciało jest zwykle ostatnie. kNoBody: brak
+    static const size_t kNoBody = ~size_t(0);
+    size_t FindBody(uint64_t id) const
+    {
+        for (size_t i = ids.size(); i-- > 0;)
+        {
+            if (ids[i] == id)
+                return i;
+        }
+        return kNoBody;
+    }
+
+    void Apply(const SimCommand &command)
+    {
+        BodyStore &bodies = world.bodies;
+        size_t i = command.type == SimCommand::AddBody || command.type == SimCommand::SetPaused ? kNoBody : FindBody(command.id);
+        bool placing = i != kNoBody && bodies.initalizing[i]; // Ciało zlepione albo już wystrzelone: polecenie bez skutku
+        switch (command.type)
+        {
+        case SimCommand::AddBody:
+            world.AddBody(command.body);
+            ids.push_back(command.id);
+            prevX.push_back(command.body.position[0]);
+            prevY.push_back(command.body.position[1]);
+            prevZ.push_back(command.body.position[2]);
+            ShrinkPlacing(bodies.size() - 1);
+            break;
+        case SimCommand::GrowPlacing:
+            if (placing)
+            {
+                bodies.mass[i] *= command.value[0];
+                ShrinkPlacing(i);
+            }
+            break;
+        case SimCommand::MovePlacing:
+            if (placing)
+            {
+                bodies.x[i] += bodies.radius[i] * command.value[0];
+                bodies.y[i] += bodies.radius[i] * command.value[1];
+                bodies.z[i] += bodies.radius[i] * command.value[2];
+            }
+            break;
+        case SimCommand::Launch:
+            if (placing)
+                bodies.initalizing[i] = 0;
+            break;
+        case SimCommand::SetPaused:
+            paused = command.value[0] != 0.0f;
+            break;
+        }
+    }
+
+    // Umieszczane ciało ma mały promień (jak dotąd), żeby nie zasłaniało sceny
+    void ShrinkPlacing(size_t i)
+    {
+        BodyStore &bodies = world.bodies;
+        if (!bodies.initalizing[i])
+            return;
+        float mass = bodies.mass[i], density = bodies.density[i];
+        bodies.radius[i] = pow(((3 * mass / density) / (4 * 3.14159265359)), (1.0f / 3.0f)) / 1000000;
+    }
+
+    // Kopia świata do tylnego egzemplarza i publikacja; withMotion = false: bez interpolacji (pierwsza migawka)
+    void Publish(double now, bool withMotion)
+    {
+        SimSnapshot &snap = snapshots.Back();
+        snap.bodies = world.bodies;
+        snap.ids = ids;
+        snap.prevX = withMotion ? prevX : world.bodies.x;
+        snap.prevY = withMotion ? prevY : world.bodies.y;
+        snap.prevZ = withMotion ? prevZ : world.bodies.z;
+        snap.time = world.time;
+        snap.stepCount = world.stepCount;
+        snap.published = now;
+        snap.interval = withMotion ? now - lastPublished : 0.0;
+        snapshots.Publish();
+
+        lastPublished = now;
+        prevX = world.bodies.x;
+        prevY = world.bodies.y;
+        prevZ = world.bodies.z;
+    }
+};
+
+// Stan do narysowania w chwili now: pozycje między poprzednią a ostatnią migawką (opóźnienie najwyżej jednej migawki)
+inline void InterpolateSnapshot(const SimSnapshot &snap, double now, BodyStore &out)
+{
+    out = snap.bodies;
+    if (snap.interval <= 0.0)
+        return;
+    float alpha = float(std::min(std::max((now - snap.published) / snap.interval, 0.0), 1.0));
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        out.x[i] = snap.prevX[i] + (snap.bodies.x[i] - snap.prevX[i]) * alpha;
+        out.y[i] = snap.prevY[i] + (snap.bodies.y[i] - snap.prevY[i]) * alpha;
+        out.z[i] = snap.prevZ[i] + (snap.bodies.z[i] - snap.prevZ[i]) * alpha;
+    }
+}
@@ -0,0 +1,460 @@
+// Rdzeń symulacji: stan ciał i krok fizyki bez żadnej zależności od OpenGL/GLFW
+#pragma once
+
+#include <vector> // std::vector: dynamiczna tablica
+#include <cmath> // std::sqrt
+#include <cstddef> // size_t
+#include <cstring> // std::strcmp
+#include <utility> // std::move
+
+#include "body.h" // Body, stałe fizyczne
+#include "body_store.h" // BodyStore: tablice SoA
+#include "direct_sum.h" // Solver bezpośredni O(N^2)
+#include "barnes_hut.h" // Solver Barnesa-Huta O(N log N)
+#include "particle_mesh.h" // Solver particle-mesh (FFT) O(N + M log M)
+#include "thread_pool.h" // GlobalPool: równoległe pętle po ciałach
+#include "hermite.h" // Hermite 4. rzędu z krokami blokowymi
+#include "integrators.h" // Schematy symplektyczne (polityki kick/drift)
+#include "invariants.h" // Energia i moment pędu
+#include "collisions.h" // Faza szeroka i wąska kolizji
+#include "mixed_precision.h" // Stan w double i układ względny dla solverów float
+#include "profiler.h" // ProfileScope: czasy faz kroku
+#include "log.h" // LOG_DEBUG/LOG_TRACE: diagnostyka kolizji
+
+// Wybór metody liczenia grawitacji
+enum class ForceSolver
+{
+    Direct, // Suma po wszystkich parach (referencja)
+    BarnesHut, // Drzewo ósemkowe z kątem otwarcia theta
+    ParticleMesh // Siatka z FFT (opcjonalnie P3M); dla bardzo dużych, w miarę jednorodnych rozkładów
+};
+
+inline const char *ForceSolverName(ForceSolver solver)
+{
+    switch (solver)
+    {
+    case ForceSolver::BarnesHut:
+        return "bh";
+    case ForceSolver::ParticleMesh:
+        return "pm";
+    default:
+        return "direct";
+    }
+}
+
+// Solver o podanej nazwie; nieznana nazwa zostawia sumę bezpośrednią
+inline ForceSolver ForceSolverFromName(const char *name)
+{
+    for (ForceSolver solver : {ForceSolver::BarnesHut, ForceSolver::ParticleMesh})
+    {
+        if (std::strcmp(name, ForceSolverName(solver)) == 0)
+            return solver;
+    }
+    return ForceSolver::Direct;
+}
+
+// Wybór schematu całkowania
+enum class Integrator
+{
+    Euler, // Dawny krok: prędkość, kolizje, pozycja (wspólny dt)
+    Leapfrog, // KDK, 2. rząd, symplektyczny
+    Yoshida4, // Potrójny skok Yoshidy, 4. rząd
+    ForestRuth, // Forest-Ruth (DKD), 4. rząd
+    Hermite // Predyktor-korektor 4. rzędu, indywidualne kroki blokowe (siły zawsze bezpośrednie)
+};
+
+// Reakcja na zderzenie dwóch ciał
+enum class CollisionResponse
+{
+    Bounce, // Dawne zachowanie: prędkość każdego z ciał mnożona przez kBounceFactor
+    Merge // Zlepienie: masa, pęd i środek masy przechodzą na cięższe ciało, lżejsze znika
+};
+
+// Nazwy schematów używane w argumentach i raportach
+inline const char *IntegratorName(Integrator integrator)
+{
+    switch (integrator)
+    {
+    case Integrator::Leapfrog:
+        return "leapfrog";
+    case Integrator::Yoshida4:
+        return "yoshida4";
+    case Integrator::ForestRuth:
+        return "forest-ruth";
+    case Integrator::Hermite:
+        return "hermite";
+    default:
+        return "euler";
+    }
+}
+
+// Schemat o podanej nazwie; nieznana nazwa zostawia dawny krok Eulera
+inline Integrator IntegratorFromName(const char *name)
+{
+    for (Integrator it : {Integrator::Leapfrog, Integrator::Yoshida4, Integrator::ForestRuth, Integrator::Hermite})
+    {
+        if (std::strcmp(name, IntegratorName(it)) == 0)
+            return it;
+    }
+    return Integrator::Euler;
+}
+
+// Świat symulacji: właściciel ciał, krok o stałym dt niezależny od okna
+class World
+{
+public:
+    BodyStore bodies; // Wszystkie ciała sceny (SoA)
+    double time = 0.0; // Czas symulacji (w tickach)
+    long long stepCount = 0; // Liczba wykonanych kroków
+
+    ForceSolver solver = ForceSolver::Direct; // Metoda liczenia grawitacji
+    float theta = 0.5f; // Kąt otwarcia Barnesa-Huta (0 = dokładnie jak suma bezpośrednia)
+    ParticleMesh mesh; // Siatka solvera PM (parametry: grid, boundary, shortRange) i jej bufory
+    Integrator integrator = Integrator::Euler; // Schemat całkowania
+    HermiteIntegrator hermite; // Stan kroków blokowych (parametry eta, maxLevel, liczniki)
+    CollisionResponse collisionResponse = CollisionResponse::Bounce; // Reakcja na zderzenia
+    Precision precision = Precision::Single; // Mixed: pozycje i prędkości w double (schematy symplektyczne; Hermite liczy w float)
+
+    std::vector<CollisionEvent> collisions; // Kontakty wykryte w ostatnim kroku
+    std::vector<size_t> removed; // Indeksy ciał usuniętych przez zlepienie (w kolejności usuwania, dla EraseIndices); czyści właściciel
+
+    // Dodaje ciało i zwraca jego indeks
+    size_t AddBody(const Body &body)
+    {
+        return bodies.Add(body);
+    }
+
+    // Jeden krok symulacji o długości dt (w tickach)
+    void step(float dt = kFixedDt)
+    {
+        switch (integrator) // Każdy schemat to osobna instancja pętli kroku
+        {
+        case Integrator::Leapfrog:
+            StepWith<LeapfrogScheme>(dt);
+            break;
+        case Integrator::Yoshida4:
+            StepWith<Yoshida4Scheme>(dt);
+            break;
+        case Integrator::ForestRuth:
+            StepWith<ForestRuthScheme>(dt);
+            break;
+        case Integrator::Hermite:
+            StepHermite(dt);
+            break;
+        default:
+            StepWith<EulerScheme>(dt);
+            break;
+        }
+        time += dt;
+        ++stepCount;
+    }
+
+    // Wykonuje nSteps kroków o stałym dt
+    void run(long long nSteps, float dt = kFixedDt)
+    {
+        for (long long s = 0; s < nSteps; ++s)
+            step(dt);
+    }
+
+    // Stan w double zgodny z bodies (tryb mieszany po kroku) albo nullptr, gdy nie jest prowadzony
+    const PreciseState *CurrentPrecise() const
+    {
+        return PreciseActive() && precise.size() == bodies.size() ? &precise : nullptr;
+    }
+
+    // Stan w double z checkpointu; ciała zmienione później i tak nadpisze Sync na początku kroku
+    void RestorePrecise(PreciseState &&state)
+    {
+        precise = std::move(state);
+        forcesValid = false;
+    }
+
+private:
+    static const size_t kIntegrateGrain = 4096; // Ciał na zadanie przy integracji
+
+    FloatArray ax, ay, az; // Bufory przyspieszeń (wielokrotnego użytku)
+    bool forcesValid = false; // Czy ax/ay/az odpowiadają bieżącym pozycjom (FSAL)
+    size_t forcesBodies = 0, forcesPlaced = 0; // Liczba ciał i umieszczanych przy ostatnim liczeniu sił
+    Octree tree; // Drzewo Barnesa-Huta (budowane od nowa w każdym kroku)
+    PreciseState precise; // Stan w double (tryb mieszany); bodies trzyma jego zaokrąglenie
+    RelativeFrame frame; // Ciała względem środka masy dla solverów (tryb mieszany)
+    double forceMassUnit = 1.0; // Mnożnik przyspieszeń ax/ay/az (jednostka masy układu względnego)
+    CollisionDetector detector; // Hasz przestrzenny (bufory wielokrotnego użytku)
+
+    // Krok Hermite'a: ciała z szybkimi zmianami siły dzielą dt na mniejsze podkroki
+    void StepHermite(float dt)
+    {
+        {
+            ProfileScope scope("hermite"); // Siły i całkowanie razem (podkroki blokowe)
+            hermite.Advance(bodies, dt, GlobalPool()); // Wszystkie ciała zsynchronizowane na końcu kroku
+        }
+        ResolveCollisions(); // Zmiana prędkości wymusi ponowną inicjalizację w następnym kroku
+        float drift = dt / kPositionScale;
+        for (size_t i = 0; i < bodies.size(); ++i)
+        {
+            if (bodies.initalizing[i]) // Umieszczane ciało porusza się tylko własną prędkością
+            {
+                bodies.x[i] += bodies.vx[i] * drift;
+                bodies.y[i] += bodies.vy[i] * drift;
+                bodies.z[i] += bodies.vz[i] * drift;
+            }
+            else
+            {
+                bodies.radius[i] = RadiusFromMass(bodies.mass[i], bodies.density[i]);
+            }
+        }
+        forcesValid = false; // Pozycje zmienione poza schematem symplektycznym
+    }
+
+    // Krok schematu Scheme: kicki i drifty o współczynnikach znanych w czasie kompilacji.
+    // Kolizje przed ostatnim driftem, jak w dawnym kroku (prędkość, kolizje, pozycja).
+    template <class Scheme>
+    void StepWith(float dt)
+    {
+        if (precision == Precision::Mixed && precise.Sync(bodies, GlobalPool())) // Zmiany spoza kroku (polecenia, wczytanie)
+            forcesValid = false;
+        if (Scheme::kKick[0] != 0.0)
+        {
+            if (!ForcesCurrent())
+                ComputeAccelerations();
+            Kick(float(Scheme::kKick[0] * dt));
+        }
+        for (int s = 0; s < Scheme::kStages; ++s)
+        {
+            if (s == Scheme::kStages - 1)
+                ResolveCollisions(); // Odbicia przy nachodzeniu na siebie
+            Drift(float(Scheme::kDrift[s] * dt));
+            forcesValid = false;
+            if (Scheme::kKick[s + 1] != 0.0)
+            {
+                ComputeAccelerations();
+                Kick(float(Scheme::kKick[s + 1] * dt));
+            }
+        }
+        UpdateRadii();
+    }
+
+    // v += a * h / 96 (umieszczane ciała mają zerowe przyspieszenie)
+    void Kick(float h)
+    {
+        ProfileScope scope("integration");
+        float kick = h / kVelocityScale;
+        if (precision == Precision::Mixed) // Suma w double, w bodies zaokrąglenie
+        {
+            double unitKick = double(h) / kVelocityScale * forceMassUnit;
+            GlobalPool().ParallelFor(0, bodies.size(), kIntegrateGrain, [&](size_t i0, size_t i1)
+                                     {
+                for (size_t i = i0; i < i1; ++i)
+                {
+                    precise.vx[i] += ax[i] * unitKick;
+                    precise.vy[i] += ay[i] * unitKick;
+                    precise.vz[i] += az[i] * unitKick;
+                    bodies.vx[i] = float(precise.vx[i]);
+                    bodies.vy[i] = float(precise.vy[i]);
+                    bodies.vz[i] = float(precise.vz[i]);
+                } });
+            return;
+        }
+        GlobalPool().ParallelFor(0, bodies.size(), kIntegrateGrain, [&](size_t i0, size_t i1)
+                                 {
+            for (size_t i = i0; i < i1; ++i) // Aktualizacja prędkości
+            {
+                bodies.vx[i] += ax[i] * kick;
+                bodies.vy[i] += ay[i] * kick;
+                bodies.vz[i] += az[i] * kick;
+            } });
+    }
+
+    // x += v * h / 94
+    void Drift(float h)
+    {
+        ProfileScope scope("integration");
+        float drift = h / kPositionScale;
+        if (precision == Precision::Mixed)
+        {
+            double preciseDrift = double(h) / kPositionScale;
+            GlobalPool().ParallelFor(0, bodies.size(), kIntegrateGrain, [&](size_t i0, size_t i1)
+                                     {
+                for (size_t i = i0; i < i1; ++i)
+                {
+                    precise.x[i] += precise.vx[i] * preciseDrift;
+                    precise.y[i] += precise.vy[i] * preciseDrift;
+                    precise.z[i] += precise.vz[i] * preciseDrift;
+                    bodies.x[i] = float(precise.x[i]);
+                    bodies.y[i] = float(precise.y[i]);
+                    bodies.z[i] = float(precise.z[i]);
+                } });
+            return;
+        }
+        GlobalPool().ParallelFor(0, bodies.size(), kIntegrateGrain, [&](size_t i0, size_t i1)
+                                 {
+            for (size_t i = i0; i < i1; ++i) // Aktualizacja pozycji
+            {
+                bodies.x[i] += bodies.vx[i] * drift;
+                bodies.y[i] += bodies.vy[i] * drift;
+                bodies.z[i] += bodies.vz[i] * drift;
+            } });
+    }
+
+    void UpdateRadii()
+    {
+        ProfileScope scope("integration");
+        GlobalPool().ParallelFor(0, bodies.size(), kIntegrateGrain, [&](size_t i0, size_t i1)
+                                 {
+            for (size_t i = i0; i < i1; ++i)
+            {
+                if (!bodies.initalizing[i])
+                    bodies.radius[i] = RadiusFromMass(bodies.mass[i], bodies.density[i]); // Aktualizacja promienia
+            } });
+    }
+
+    // Siły z końca poprzedniego kroku są aktualne, jeśli od tamtej pory nie zmienił się zbiór ciał
+    bool ForcesCurrent() const
+    {
+        if (!forcesValid || forcesBodies != bodies.size())
+            return false;
+        size_t placed = 0;
+        for (unsigned char f : bodies.initalizing)
+            placed += f;
+        return placed == forcesPlaced;
+    }
+
+    // Grawitacja wybranym solverem
+    void ComputeAccelerations()
+    {
+        ProfileScope scope("forces");
+        forcesValid = true;
+        forcesBodies = bodies.size();
+        forcesPlaced = 0;
+        for (unsigned char f : bodies.initalizing)
+            forcesPlaced += f;
+        forceMassUnit = 1.0;
+        const BodyStore *source = &bodies;
+        if (precision == Precision::Mixed) // Solvery float na pozycjach względem środka masy
+        {
+            frame.Build(bodies, precise, GlobalPool());
+            forceMassUnit = frame.massUnit;
+            source = &frame.local;
+        }
+        if (solver == ForceSolver::BarnesHut)
+        {
+            tree.Build(*source);
+            tree.Accelerations(*source, theta, ax, ay, az);
+        }
+        else if (solver == ForceSolver::ParticleMesh)
+        {
+            mesh.Accelerations(*source, ax, ay, az);
+        }
+        else
+        {
+            DirectAccelerations(*source, ax, ay, az);
+        }
+    }
+
+    // Czy stan w double jest prowadzony: tylko schematy z StepWith (Sync na początku kroku).
+    // Hermite całkuje bodies wprost w float, więc kolizje piszą wtedy tylko do bodies.
+    bool PreciseActive() const
+    {
+        return precision == Precision::Mixed && integrator != Integrator::Hermite;
+    }
+
+    // Kolizje: faza szeroka + wąska, potem reakcja dla każdego kontaktu
+    void ResolveCollisions()
+    {
+        ProfileScope scope("collisions");
+        const std::vector<CollisionEvent> &found = detector.FindContacts(bodies, GlobalPool());
+        collisions.assign(found.begin(), found.end());
+        if (collisionResponse == CollisionResponse::Merge)
+        {
+            MergeContacts();
+            return;
+        }
+        for (const CollisionEvent &ev : collisions) // Odwrócenie i wytłumienie prędkości obu ciał
+        {
+            LOG_TRACE(Collisions, "bounce %zu-%zu depth %g", ev.a, ev.b, ev.depth);
+            for (size_t i : {ev.a, ev.b})
+            {
+                if (PreciseActive())
+                {
+                    precise.vx[i] *= kBounceFactor;
+                    precise.vy[i] *= kBounceFactor;
+                    precise.vz[i] *= kBounceFactor;
+                    bodies.vx[i] = float(precise.vx[i]);
+                    bodies.vy[i] = float(precise.vy[i]);
+                    bodies.vz[i] = float(precise.vz[i]);
+                    continue;
+                }
+                bodies.vx[i] *= kBounceFactor;
+                bodies.vy[i] *= kBounceFactor;
+                bodies.vz[i] *= kBounceFactor;
+            }
+        }
+    }
+
+    // Zlepianie kontaktów w kolejności (a, b); ciało już pochłonięte nie bierze udziału w kolejnych
+    void MergeContacts()
+    {
+        if (collisions.empty())
+            return;
+        std::vector<unsigned char> gone(bodies.size(), 0);
+        for (const CollisionEvent &ev : collisions)
+        {
+            if (gone[ev.a] || gone[ev.b])
+                continue;
+            bool aKeeps = bodies.mass[ev.a] >= bodies.mass[ev.b];
+            size_t keep = aKeeps ? ev.a : ev.b, lose = aKeeps ? ev.b : ev.a;
+            double mk = bodies.mass[keep], ml = bodies.mass[lose], m = mk + ml;
+            FloatArray *pos[3] = {&bodies.x, &bodies.y, &bodies.z};
+            FloatArray *vel[3] = {&bodies.vx, &bodies.vy, &bodies.vz};
+            DoubleArray *precisePos[3] = {&precise.x, &precise.y, &precise.z};
+            DoubleArray *preciseVel[3] = {&precise.vx, &precise.vy, &precise.vz};
+            for (int d = 0; d < 3; ++d) // Środek masy i zachowanie pędu
+            {
+                FloatArray &p = *pos[d], &v = *vel[d];
+                if (PreciseActive())
+                {
+                    DoubleArray &pp = *precisePos[d], &pv = *preciseVel[d];
+                    pp[keep] = (mk * pp[keep] + ml * pp[lose]) / m;
+                    pv[keep] = (mk * pv[keep] + ml * pv[lose]) / m;
+                    p[keep] = float(pp[keep]);
+                    v[keep] = float(pv[keep]);
+                    continue;
+                }
+                p[keep] = float((mk * p[keep] + ml * p[lose]) / m);
+                v[keep] = float((mk * v[keep] + ml * v[lose]) / m);
+            }
+            bodies.mass[keep] = float(m);
+            bodies.radius[keep] = RadiusFromMass(bodies.mass[keep], bodies.density[keep]);
+            gone[lose] = 1;
+            LOG_DEBUG(Collisions, "merged body %zu into %zu, mass %g kg", lose, keep, m);
+        }
+        size_t first = removed.size();
+        for (size_t i = bodies.size(); i-- > 0;) // Malejąco: każdy indeks ważny w chwili usunięcia, jedna partia
+        {
+            if (gone[i])
+                removed.push_back(i);
+        }
+        const std::vector<size_t> batch(removed.begin() + first, removed.end());
+        bodies.RemoveIndices(batch); // Jedno przejście kompaktujące zamiast przesuwania ogona dla każdego ciała
+        if (PreciseActive())
+            precise.RemoveIndices(batch);
+    }
+};
+
+// Opis ciała w scenie: stan fizyczny + wygląd (kolor RGBA, glow)
+struct SceneBody
+{
+    Body body;
+    float color[4];
+    bool glow;
+};
+
+// Scena domyślna: dwie planety krążące wokół gwiazdy
+inline std::vector<SceneBody> DefaultScene()
+{
+    return {
+        {Body(-5000, 650, -350, 0, 0, 1500, 5.97219e22f, 5515), {0.0f, 1.0f, 1.0f, 1.0f}, false}, // Pierwszy obiekt
+        {Body(5000, 650, -350, 0, 0, -1500, 5.97219e22f, 5515), {0.0f, 1.0f, 1.0f, 1.0f}, false}, // Drugi obiekt
+        {Body(0, 0, -350, 0, 0, 0, 1.989e25f, 5515), {1.0f, 0.929f, 0.176f, 1.0f}, true}, // Obiekt glow
+    };
+}
@@ -0,0 +1,158 @@
+// Rejestr z generacyjnymi uchwytami: O(1) dodanie, usunięcie i wyszukanie, wartości w gęstej tablicy bez dziur
+#pragma once
+
+#include <vector> // std::vector
+#include <cstdint> // uint32_t, uint64_t
+#include <utility> // std::move
+#include <cstddef> // size_t
+
+// Uchwyt: generacja slotu w starszych 32 bitach, numer slotu w młodszych. Uchwyt usuniętej wartości
+// przestaje być ważny (generacja rośnie przy usunięciu), więc nie wskaże wartości dodanej później w tym samym slocie.
+using SlotHandle = uint64_t;
+const SlotHandle kNoHandle = 0; // Nigdy nie jest ważnym uchwytem
+
+template <class T>
+class SlotMap
+{
+public:
+    // Dodaje wartość; slot z listy wolnych albo nowy
+    SlotHandle Insert(T value)
+    {
+        if (freeDirty)
+            RebuildFreeList();
+        uint32_t slot;
+        if (freeHead != kEnd)
+        {
+            slot = freeHead;
+            freeHead = slots[slot].nextFree;
+        }
+        else
+        {
+            slot = uint32_t(slots.size());
+            slots.push_back(Slot());
+        }
+        return Place(slot, std::move(value));
+    }
+
+    // Dodaje wartość pod podanym uchwytem (odtworzenie z checkpointu albo nagrania); kNoHandle, gdy slot zajęty
+    SlotHandle InsertAt(SlotHandle handle, T value)
+    {
+        uint32_t slot = SlotOf(handle);
+        if (handle == kNoHandle || (slot < slots.size() && slots[slot].dense != kEnd))
+            return kNoHandle;
+        if (slot >= slots.size())
+            slots.resize(size_t(slot) + 1);
+        slots[slot].generation = GenerationOf(handle);
+        freeDirty = true; // Slot mógł leżeć na liście wolnych; lista odbudowana przy następnym Insert
+        return Place(slot, std::move(value));
+    }
+
+    // Usuwa wartość; ostatnia wartość gęstej tablicy zajmuje jej miejsce. false dla nieważnego uchwytu
+    bool Remove(SlotHandle handle)
+    {
+        if (!Contains(handle))
+            return false;
+        uint32_t slot = SlotOf(handle), dense = slots[slot].dense;
+        uint32_t last = uint32_t(values.size() - 1);
+        if (dense != last)
+        {
+            values[dense] = std::move(values[last]);
+            slotOf[dense] = slotOf[last];
+            slots[slotOf[dense]].dense = dense;
+        }
+        values.pop_back();
+        slotOf.pop_back();
+        Slot &s = slots[slot];
+        s.dense = kEnd;
+        s.generation = s.generation + 1 != 0 ? s.generation + 1 : 1; // Uchwyt slotu 0 z generacją 0 byłby kNoHandle
+        s.nextFree = freeHead;
+        freeHead = slot;
+        return true;
+    }
+
+    bool Contains(SlotHandle handle) const
+    {
+        uint32_t slot = SlotOf(handle);
+        return handle != kNoHandle && slot < slots.size() && slots[slot].dense != kEnd && slots[slot].generation == GenerationOf(handle);
+    }
+
+    // Wartość pod uchwytem albo nullptr
+    T *Get(SlotHandle handle)
+    {
+        return Contains(handle) ? &values[slots[SlotOf(handle)].dense] : nullptr;
+    }
+    const T *Get(SlotHandle handle) const
+    {
+        return Contains(handle) ? &values[slots[SlotOf(handle)].dense] : nullptr;
+    }
+
+    // Gęsta tablica: indeksy 0..size()-1, kolejność zmienia się przy usuwaniu
+    size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+    T &At(size_t dense) { return values[dense]; }
+    const T &At(size_t dense) const { return values[dense]; }
+    SlotHandle HandleAt(size_t dense) const { return MakeHandle(slotOf[dense], slots[slotOf[dense]].generation); }
+    typename std::vector<T>::iterator begin() { return values.begin(); }
+    typename std::vector<T>::iterator end() { return values.end(); }
+    typename std::vector<T>::const_iterator begin() const { return values.begin(); }
+    typename std::vector<T>::const_iterator end() const { return values.end(); }
+
+    void reserve(size_t n)
+    {
+        values.reserve(n);
+        slotOf.reserve(n);
+        slots.reserve(n);
+    }
+
+    // Usuwa wszystko łącznie ze slotami (uchwyty mogą się powtórzyć; przed odtworzeniem stanu)
+    void clear()
+    {
+        values.clear();
+        slotOf.clear();
+        slots.clear();
+        freeHead = kEnd;
+        freeDirty = false;
+    }
+
+private:
+    static const uint32_t kEnd = ~uint32_t(0);
+
+    struct Slot
+    {
+        uint32_t generation = 1;
+        uint32_t dense = kEnd; // Indeks wartości w values (kEnd: slot wolny)
+        uint32_t nextFree = kEnd; // Następny wolny slot
+    };
+
+    std::vector<Slot> slots;
+    std::vector<T> values; // Gęste wartości
+    std::vector<uint32_t> slotOf; // Slot wartości values[k]
+    uint32_t freeHead = kEnd;
+    bool freeDirty = false; // Po InsertAt lista wolnych może zawierać zajęte sloty
+
+    static uint32_t SlotOf(SlotHandle handle) { return uint32_t(handle); }
+    static uint32_t GenerationOf(SlotHandle handle) { return uint32_t(handle >> 32); }
+    static SlotHandle MakeHandle(uint32_t slot, uint32_t generation) { return (SlotHandle(generation) << 32) | slot; }
+
+    SlotHandle Place(uint32_t slot, T &&value)
+    {
+        slots[slot].dense = uint32_t(values.size());
+        values.push_back(std::move(value));
+        slotOf.push_back(slot);
+        return MakeHandle(slot, slots[slot].generation);
+    }
+
+    void RebuildFreeList()
+    {
+        freeHead = kEnd;
+        for (size_t s = slots.size(); s-- > 0;) // Od końca: najniższe sloty wydawane najpierw
+        {
+            if (slots[s].dense == kEnd)
+            {
+                slots[s].nextFree = freeHead;
+                freeHead = uint32_t(s);
+            }
+        }
+        freeDirty = false;
+    }
+};
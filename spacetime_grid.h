@@ -0,0 +1,315 @@
+// Siatka czasoprzestrzeni: płaskie wierzchołki i ugięcie od mas (referencja CPU dla shadera siatki)
+#pragma once
+
+#include <vector> // std::vector
+#include <cmath> // std::sqrt, std::fabs
+#include <algorithm> // std::max
+#include <limits> // std::numeric_limits
+#include <cstdint> // uint64_t
+
+#include "body.h" // G, c, kDistanceToMeters
+#include "body_store.h" // BodyStore
+#include "thread_pool.h" // ThreadPool: ugięcie wierzchołków równolegle
+#include "log.h" // LOG_DEBUG: przebudowane kafle
+
+// Płaska siatka linii w płaszczyźnie XZ (pary wierzchołków, po 3 floaty); tworzona raz, statyczna na GPU
+inline std::vector<float> CreateGridVertices(float size, int divisions)
+{
+    std::vector<float> vertices;
+    float step = size / divisions;
+    float halfSize = size / 2.0f;
+    float y = -halfSize * 0.3f + 3 * step;
+
+    // x axis
+    for (int zStep = 0; zStep <= divisions; ++zStep)
+    {
+        float z = -halfSize + zStep * step;
+        for (int xStep = 0; xStep < divisions; ++xStep)
+        {
+            float xStart = -halfSize + xStep * step;
+            float xEnd = xStart + step;
+            vertices.insert(vertices.end(), {xStart, y, z, xEnd, y, z});
+        }
+    }
+    // z axis
+    for (int xStep = 0; xStep <= divisions; ++xStep)
+    {
+        float x = -halfSize + xStep * step;
+        for (int zStep = 0; zStep < divisions; ++zStep)
+        {
+            float zStart = -halfSize + zStep * step;
+            float zEnd = zStart + step;
+            vertices.insert(vertices.end(), {x, y, zStart, x, y, zEnd});
+        }
+    }
+    return vertices;
+}
+
+// Ciała dla siatki: (x, y, z) w km i promień Schwarzschilda rs = 2GM/c^2 w metrach (4 floaty na ciało).
+// Ten sam bufor trafia do shadera jako bufor tekstury.
+inline void PackGridBodies(const BodyStore &bodies, std::vector<float> &packed)
+{
+    packed.resize(4 * bodies.size());
+    for (size_t j = 0; j < bodies.size(); ++j)
+    {
+        packed[4 * j] = bodies.x[j];
+        packed[4 * j + 1] = bodies.y[j];
+        packed[4 * j + 2] = bodies.z[j];
+        packed[4 * j + 3] = float((2 * G * bodies.mass[j]) / (c * c));
+    }
+}
+
+// Ugięcie w punkcie płaskiej siatki; kolejność działań taka sama jak w shaderze siatki
+inline float GridDisplacement(const std::vector<float> &packed, float x, float y, float z)
+{
+    float displacement = 0.0f;
+    for (size_t j = 0; j < packed.size(); j += 4)
+    {
+        float dx = packed[j] - x, dy = packed[j + 1] - y, dz = packed[j + 2] - z;
+        float distance_m = std::sqrt(dx * dx + dy * dy + dz * dz) * kDistanceToMeters;
+        float rs = packed[j + 3];
+        displacement += 2.0f * std::sqrt(std::max(rs * (distance_m - rs), 0.0f)) * 2.0f; // Wewnątrz rs: bez ugięcia
+    }
+    return displacement;
+}
+
+// Przesunięcie pionowe: szczyt ugiętej siatki na wysokości środka masy (jako -|comY - max|).
+// Ugięcie rośnie z odległością od każdego ciała, więc maksimum leży na obrzeżu siatki,
+// gdy ciała są w jej obrębie; liczone tylko na obrzeżu, O(obwód * ciała) zamiast O(siatka * ciała).
+inline float GridVerticalShift(const BodyStore &bodies, const std::vector<float> &packed, float size, int divisions, float gridY)
+{
+    double totalMass = 0.0, comY = 0.0;
+    for (size_t j = 0; j < bodies.size(); ++j)
+    {
+        if (bodies.initalizing[j])
+            continue;
+        comY += double(bodies.mass[j]) * bodies.y[j];
+        totalMass += bodies.mass[j];
+    }
+    if (totalMass > 0)
+        comY /= totalMass;
+
+    float step = size / divisions, halfSize = size / 2.0f;
+    float maxY = -std::numeric_limits<float>::infinity();
+    for (int k = 0; k <= divisions; ++k)
+    {
+        float t = -halfSize + k * step;
+        maxY = std::max({maxY, GridDisplacement(packed, t, gridY, -halfSize), GridDisplacement(packed, t, gridY, halfSize),
+                         GridDisplacement(packed, -halfSize, gridY, t), GridDisplacement(packed, halfSize, gridY, t)});
+    }
+    return -std::fabs(float(comY) - maxY);
+}
+
+// Referencja CPU: ugięta siatka z płaskiej (y = ugięcie + przesunięcie), jak shader siatki
+inline void DeformGridCPU(const std::vector<float> &flat, const std::vector<float> &packed, float verticalShift,
+                          std::vector<float> &out, ThreadPool &pool = GlobalPool())
+{
+    out.resize(flat.size());
+    pool.ParallelFor(0, flat.size() / 3, 1024, [&](size_t v0, size_t v1)
+                     {
+        for (size_t i = v0 * 3; i < v1 * 3; i += 3)
+        {
+            out[i] = flat[i];
+            out[i + 1] = GridDisplacement(packed, flat[i], flat[i + 1], flat[i + 2]) + verticalShift;
+            out[i + 2] = flat[i + 2];
+        } });
+}
+
+// Siatka adaptacyjna: kafle jak w siatce jednorodnej, każdy kafel to drzewo czwórkowe zagęszczane przy masywnych
+// ciałach (komórka nie większa niż refineRatio * odległość do ciała, czyli tam, gdzie ugięcie szybko się zmienia).
+// Kafel jest przebudowywany tylko wtedy, gdy zmieniły się (z dokładnością do najmniejszej komórki) ciała w jego zasięgu.
+class AdaptiveGrid
+{
+public:
+    float size = 20000.0f; // Bok siatki (km)
+    int tiles = 25; // Kafli na bok (poziom 0 = siatka jednorodna)
+    int maxDepth = 5; // Najgłębszy podział kafla (komórka = kafel / 2^maxDepth)
+    float refineRatio = 0.5f; // Komórka dzielona, gdy bok > refineRatio * odległość do ciała
+    float massFraction = 1e-3f; // Ciała z rs mniejszym niż ułamek największego rs nie zagęszczają siatki
+
+    long long rebuiltTiles = 0; // Licznik przebudowanych kafli (diagnostyka)
+
+    // Aktualizacja kafli; zwraca true, gdy zmieniły się wierzchołki
+    bool Update(const BodyStore &bodies, ThreadPool &pool = GlobalPool())
+    {
+        const size_t tileCount = size_t(tiles) * tiles;
+        if (tileVertices.size() != tileCount)
+        {
+            tileVertices.assign(tileCount, std::vector<float>());
+            tileSignature.assign(tileCount, ~uint64_t(0));
+            vertices.clear();
+        }
+        CollectMassive(bodies);
+
+        std::vector<unsigned char> changed(tileCount, 0);
+        pool.ParallelFor(0, tileCount, 16, [&](size_t t0, size_t t1)
+                         {
+            std::vector<size_t> near;
+            for (size_t t = t0; t < t1; ++t)
+            {
+                int tx = int(t % tiles), tz = int(t / tiles);
+                NearBodies(tx, tz, near);
+                uint64_t signature = Signature(near);
+                if (signature == tileSignature[t] && !tileVertices[t].empty())
+                    continue;
+                tileSignature[t] = signature;
+                tileVertices[t].clear();
+                float half = TileSize() / 2;
+                BuildNode(-size / 2 + tx * TileSize() + half, -size / 2 + tz * TileSize() + half, half, 0, near, tileVertices[t]);
+                changed[t] = 1;
+            } });
+
+        size_t rebuilt = 0;
+        for (unsigned char f : changed)
+            rebuilt += f;
+        rebuiltTiles += (long long)rebuilt;
+        if (rebuilt > 0)
+            LOG_DEBUG(Grid, "rebuilt %zu of %zu tiles", rebuilt, tileCount);
+        if (rebuilt == 0 && !vertices.empty())
+            return false;
+
+        vertices.clear();
+        for (const std::vector<float> &tv : tileVertices)
+            vertices.insert(vertices.end(), tv.begin(), tv.end());
+        float half = size / 2;
+        vertices.insert(vertices.end(), {half, y, -half, half, y, half, -half, y, half, half, y, half}); // Prawa i górna krawędź całej siatki
+        return true;
+    }
+
+    // Wierzchołki linii (pary, po 3 floaty), płaskie na wysokości y
+    const std::vector<float> &Vertices() const
+    {
+        return vertices;
+    }
+
+    // Wysokość płaszczyzny siatki (taka sama jak w CreateGridVertices)
+    float PlaneY() const
+    {
+        return y;
+    }
+
+private:
+    std::vector<std::vector<float>> tileVertices; // Linie każdego kafla
+    std::vector<uint64_t> tileSignature; // Skrót ciał wpływających na kafel przy ostatniej budowie
+    std::vector<float> vertices; // Wszystkie kafle razem
+    std::vector<float> massive; // Ciała zagęszczające: x, y, z, rs (4 floaty na ciało)
+    std::vector<size_t> binStart, binBodies; // Ciała masywne pogrupowane po kaflach (rzut na XZ)
+    float y = 0.0f;
+
+    float TileSize() const
+    {
+        return size / tiles;
+    }
+
+    // Zasięg ciała w kaflach: dalej żaden kafel nie jest dzielony nawet raz
+    int ReachTiles() const
+    {
+        return int(std::ceil(1.0f / refineRatio)) + 1;
+    }
+
+    void CollectMassive(const BodyStore &bodies)
+    {
+        y = -size / 2 * 0.3f + 3 * TileSize(); // Jak w CreateGridVertices(size, tiles)
+        float maxRs = 0.0f;
+        for (size_t j = 0; j < bodies.size(); ++j)
+            maxRs = std::max(maxRs, float((2 * G * bodies.mass[j]) / (c * c)));
+        massive.clear();
+        for (size_t j = 0; j < bodies.size(); ++j)
+        {
+            float rs = float((2 * G * bodies.mass[j]) / (c * c));
+            if (rs > 0.0f && rs >= massFraction * maxRs)
+                massive.insert(massive.end(), {bodies.x[j], bodies.y[j], bodies.z[j], rs});
+        }
+
+        // Sortowanie przez zliczanie po kaflu; ciała poza siatką, ale w zasięgu, trafiają do kafla brzegowego
+        const size_t tileCount = size_t(tiles) * tiles;
+        std::vector<long long> bin(massive.size() / 4, -1);
+        binStart.assign(tileCount + 1, 0);
+        for (size_t k = 0; k < bin.size(); ++k)
+        {
+            long long tx = (long long)std::floor((massive[4 * k] + size / 2) / TileSize());
+            long long tz = (long long)std::floor((massive[4 * k + 2] + size / 2) / TileSize());
+            if (tx < -ReachTiles() || tz < -ReachTiles() || tx >= tiles + ReachTiles() || tz >= tiles + ReachTiles())
+                continue;
+            tx = std::min<long long>(std::max<long long>(tx, 0), tiles - 1);
+            tz = std::min<long long>(std::max<long long>(tz, 0), tiles - 1);
+            bin[k] = tz * tiles + tx;
+            ++binStart[size_t(bin[k]) + 1];
+        }
+        for (size_t t = 0; t < tileCount; ++t)
+            binStart[t + 1] += binStart[t];
+        binBodies.resize(binStart[tileCount]);
+        std::vector<size_t> fill(binStart.begin(), binStart.end() - 1);
+        for (size_t k = 0; k < bin.size(); ++k)
+        {
+            if (bin[k] >= 0)
+                binBodies[fill[size_t(bin[k])]++] = k;
+        }
+    }
+
+    // Ciała masywne z kafli w zasięgu (posortowane, więc skrót nie zależy od kolejności kafli)
+    void NearBodies(int tx, int tz, std::vector<size_t> &near) const
+    {
+        near.clear();
+        int reach = ReachTiles();
+        for (int z = std::max(0, tz - reach); z <= std::min(tiles - 1, tz + reach); ++z)
+        {
+            for (int x = std::max(0, tx - reach); x <= std::min(tiles - 1, tx + reach); ++x)
+            {
+                size_t t = size_t(z) * tiles + x;
+                near.insert(near.end(), binBodies.begin() + binStart[t], binBodies.begin() + binStart[t + 1]);
+            }
+        }
+        std::sort(near.begin(), near.end());
+    }
+
+    // Skrót pozycji (skwantowanych do najmniejszej komórki) i rs ciał w zasięgu kafla
+    uint64_t Signature(const std::vector<size_t> &near) const
+    {
+        float cell = TileSize() / float(1 << maxDepth);
+        uint64_t h = 1469598103934665603ull; // FNV-1a
+        auto mix = [&h](uint64_t v)
+        {
+            h ^= v;
+            h *= 1099511628211ull;
+        };
+        mix(near.size());
+        for (size_t k : near)
+        {
+            for (int d = 0; d < 3; ++d)
+                mix(uint64_t((long long)std::floor(massive[4 * k + d] / cell)));
+            mix(uint64_t((long long)std::floor(std::log2(massive[4 * k + 3]) * 16))); // rs z dokładnością ~4%
+        }
+        return h;
+    }
+
+    // Czy komórka (środek, połowa boku) jest za duża względem najbliższego ciała
+    bool NeedsSplit(float cx, float cz, float half, const std::vector<size_t> &near) const
+    {
+        float reach = half * 1.41421356f; // Promień koła opisanego na komórce
+        for (size_t k : near)
+        {
+            float dx = massive[4 * k] - cx, dy = massive[4 * k + 1] - y, dz = massive[4 * k + 2] - cz;
+            float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - reach, 0.0f);
+            if (2 * half > refineRatio * distance)
+                return true;
+        }
+        return false;
+    }
+
+    // Liście drzewa: lewa i dolna krawędź każdego liścia (prawe/górne pokrywają liście sąsiednie)
+    void BuildNode(float cx, float cz, float half, int depth, const std::vector<size_t> &near, std::vector<float> &out) const
+    {
+        if (depth < maxDepth && NeedsSplit(cx, cz, half, near))
+        {
+            float q = half / 2;
+            BuildNode(cx - q, cz - q, q, depth + 1, near, out);
+            BuildNode(cx + q, cz - q, q, depth + 1, near, out);
+            BuildNode(cx - q, cz + q, q, depth + 1, near, out);
+            BuildNode(cx + q, cz + q, q, depth + 1, near, out);
+            return;
+        }
+        float x0 = cx - half, x1 = cx + half, z0 = cz - half, z1 = cz + half;
+        out.insert(out.end(), {x0, y, z0, x1, y, z0, x0, y, z0, x0, y, z1});
+    }
+};
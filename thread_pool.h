@@ -0,0 +1,213 @@
+// Pula wątków z podkradaniem zadań (work stealing) dla obliczeń fizyki
+#pragma once
+
+#include <vector> // std::vector
+#include <deque> // std::deque: kolejka zadań wątku
+#include <thread> // std::thread
+#include <mutex> // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <atomic> // std::atomic
+#include <functional> // std::function
+#include <memory> // std::unique_ptr
+#include <algorithm> // std::min, std::max
+#include <cstddef> // size_t
+
+// Trwała pula wątków; wątek wywołujący ParallelFor pracuje razem z pulą
+class ThreadPool
+{
+public:
+    using RangeFn = std::function<void(size_t, size_t)>; // Praca na zakresie [begin, end)
+
+    // threads = łączna liczba wątków liczących (0 = liczba rdzeni)
+    explicit ThreadPool(unsigned threads = 0)
+    {
+        Start(threads);
+    }
+
+    ~ThreadPool()
+    {
+        Stop();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Liczba wątków liczących (razem z wywołującym)
+    unsigned size() const
+    {
+        return unsigned(queues.size());
+    }
+
+    // Zmiana liczby wątków (nie wolno wołać w trakcie ParallelFor)
+    void Resize(unsigned threads)
+    {
+        Stop();
+        Start(threads);
+    }
+
+    // Dzieli [begin, end) na kawałki po grain elementów i wykonuje fn równolegle.
+    // Granice kawałków nie zależą od liczby wątków, więc wyniki liczone per kawałek są deterministyczne.
+    void ParallelFor(size_t begin, size_t end, size_t grain, const RangeFn &fn)
+    {
+        if (end <= begin)
+            return;
+        grain = std::max<size_t>(1, grain);
+        size_t chunks = (end - begin + grain - 1) / grain;
+
+        if (workers.empty() || chunks == 1 || insideTask()) // Bez puli: kolejno, te same kawałki
+        {
+            for (size_t b = begin; b < end; b += grain)
+                fn(b, std::min(end, b + grain));
+            return;
+        }
+
+        std::lock_guard<std::mutex> submit(submitMutex); // Jedno zlecenie naraz
+        // Liczniki przed kolejkami: wątek wciąż w RunTasks (świeży albo po poprzednim zleceniu) może wziąć zadanie
+        // zaraz po wstawieniu, a jego fetch_sub musi trafić w już ustawione wartości
+        pending.store(chunks);
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            queued.store(chunks);
+        }
+        for (size_t k = 0; k < chunks; ++k) // Rozdział kawałków po kolejkach (round-robin)
+        {
+            size_t b = begin + k * grain;
+            Queue &q = *queues[k % queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(Task{&fn, b, std::min(end, b + grain)});
+        }
+        wake.notify_all();
+
+        RunTasks(0); // Wątek wywołujący też pracuje
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        done.wait(lock, [this]
+                  { return pending.load() == 0; });
+    }
+
+private:
+    struct Task
+    {
+        const RangeFn *fn;
+        size_t begin, end;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // Kolejka na wątek (0 = wywołujący)
+    std::vector<std::thread> workers; // Wątki robocze 1..n-1
+    std::mutex submitMutex; // Serializacja zleceń
+    std::mutex wakeMutex; // Chroni budzenie i zakończenie
+    std::condition_variable wake; // Nowe zadania albo zatrzymanie
+    std::condition_variable done; // Wszystkie zadania zlecenia wykonane
+    std::atomic<size_t> queued{0}; // Zadania czekające w kolejkach
+    std::atomic<size_t> pending{0}; // Zadania jeszcze niezakończone
+    bool stopping = false;
+
+    static bool &insideTask()
+    {
+        static thread_local bool inside = false; // Zagnieżdżone ParallelFor wykonuje się w miejscu
+        return inside;
+    }
+
+    void Start(unsigned threads)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        stopping = false;
+        queues.clear();
+        for (unsigned t = 0; t < threads; ++t)
+            queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        for (unsigned t = 1; t < threads; ++t)
+            workers.emplace_back([this, t]
+                                 { WorkerLoop(t); });
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &w : workers)
+            w.join();
+        workers.clear();
+    }
+
+    // Zadanie z własnej kolejki (od końca) albo podkradzione z cudzej (od początku)
+    bool Take(size_t self, Task &task)
+    {
+        {
+            Queue &own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); ++k)
+        {
+            Queue &victim = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void RunTasks(size_t self)
+    {
+        Task task;
+        insideTask() = true;
+        while (Take(self, task))
+        {
+            (*task.fn)(task.begin, task.end);
+            if (pending.fetch_sub(1) == 1) // Ostatnie zadanie zlecenia
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                done.notify_all();
+            }
+        }
+        insideTask() = false;
+    }
+
+    void WorkerLoop(size_t self)
+    {
+        while (true)
+        {
+            RunTasks(self);
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [this]
+                      { return stopping || queued.load() > 0; });
+            if (stopping)
+                return;
+        }
+    }
+};
+
+// Wspólna pula dla fizyki i siatki (rozmiar zmieniany przez --threads)
+inline ThreadPool &GlobalPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// Pula wątku renderowania (siatka, BVH): ParallelFor trzyma GlobalPool przez całe zlecenie, więc klatka
+// czekałaby za siłami liczonymi na wątku symulacji. Połowa rdzeni; na jednym rdzeniu bez wątków roboczych (w miejscu).
+inline ThreadPool &RenderPool()
+{
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency() / 2));
+    return pool;
+}
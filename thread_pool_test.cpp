@@ -0,0 +1,29 @@
+// Test puli wątków: ParallelFor zaraz po utworzeniu puli (wątki robocze startują w RunTasks), wiele razy z rzędu
+#include <cstdio> // std::fprintf
+#include <atomic> // std::atomic
+
+#include "thread_pool.h" // ThreadPool
+
+int main()
+{
+    int failures = 0;
+    for (int round = 0; round < 200; ++round)
+    {
+        ThreadPool pool(8); // Świeże wątki mogą już szukać zadań, gdy zlecenie trafia do kolejek
+        for (int job = 0; job < 4; ++job)
+        {
+            std::atomic<long long> sum{0};
+            pool.ParallelFor(0, 4000, 1, [&](size_t begin, size_t end)
+                             {
+                for (size_t i = begin; i < end; ++i)
+                    sum.fetch_add((long long)i); });
+            if (sum.load() != 4000LL * 3999 / 2)
+            {
+                std::fprintf(stderr, "round %d job %d: sum %lld\n", round, job, sum.load());
+                ++failures;
+            }
+        }
+    }
+    std::printf("thread_pool_test: %d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,604 @@
+// Zapis trajektorii: klatka co K kroków, pozycje kwantowane w prostopadłościanie ograniczającym i kodowane różnicowo między klatkami.
+// Kodowanie i zapis na osobnym wątku; odtwarzanie z przewijaniem bez fizyki.
+#pragma once
+
+#include <vector> // std::vector
+#include <deque> // std::deque: kolejka klatek do zapisu
+#include <string> // std::string
+#include <thread> // std::thread
+#include <mutex> // std::mutex
+#include <condition_variable> // std::condition_variable
+#include <cstdio> // std::FILE, std::fopen, std::fread, std::fwrite
+#include <cstring> // std::memcpy, std::memcmp
+#include <cstdint> // uint32_t, uint64_t, int64_t
+#include <cmath> // std::llround, std::floor
+#include <algorithm> // std::min, std::max, std::minmax_element
+#include <utility> // std::swap
+
+#include "body_store.h" // BodyStore
+#include "log.h" // LOG_INFO, LOG_ERROR
+
+// Nagłówek pliku
+struct TrajectoryFileHeader
+{
+    static const uint32_t kVersion = 2;
+
+    char magic[8]; // "PHYSTRAJ"
+    uint32_t version;
+    uint32_t bits; // Bity na współrzędną po kwantyzacji
+    uint32_t stepsPerFrame; // Kroki fizyki między klatkami
+    uint32_t keyframeInterval; // Najwyżej tyle klatek między klatkami kluczowymi
+    float dt; // Krok fizyki (ticki)
+    uint32_t reserved;
+};
+
+// Nagłówek klatki; za nim payloadBytes bajtów danych
+struct TrajectoryFrameHeader
+{
+    static const uint32_t kKeyframe = 1; // Klatka niezależna od poprzednich (identyfikatory, masy, wygląd, pełne pozycje)
+
+    uint32_t payloadBytes;
+    uint32_t bodyCount;
+    uint32_t flags;
+    uint32_t reserved;
+    double time; // Czas symulacji (ticki)
+    int64_t stepCount;
+    float origin[3]; // Pozycja = origin + q * cell (stałe od klatki kluczowej)
+    float cell[3];
+};
+
+// Stan ciał w jednej klatce: wejście zapisu i wynik odczytu (prędkości nie są zapisywane)
+struct TrajectoryFrame
+{
+    BodyStore bodies; // Pozycje, masy i promienie
+    std::vector<uint64_t> ids; // Trwałe identyfikatory (uchwyty rejestru); puste = 1..N
+    std::vector<uint32_t> colors; // RGBA8 na ciało; puste = biały
+    std::vector<unsigned char> glow; // Puste = bez poświaty
+    double time = 0.0;
+    long long stepCount = 0;
+};
+
+// Kolor RGBA (0..1) jako RGBA8 i z powrotem
+inline uint32_t PackColor(float r, float g, float b, float a)
+{
+    auto byte = [](float v)
+    { return uint32_t(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+    return byte(r) | (byte(g) << 8) | (byte(b) << 16) | (byte(a) << 24);
+}
+
+inline float ColorChannel(uint32_t color, int channel)
+{
+    return float((color >> (8 * channel)) & 0xFF) / 255.0f;
+}
+
+// fseek z 64-bitowym przesunięciem (nagrania z nocnych przebiegów mają wiele GB)
+inline bool SeekFile(std::FILE *file, uint64_t offset, int origin)
+{
+#ifdef _WIN32
+    return _fseeki64(file, int64_t(offset), origin) == 0;
+#else
+    return fseeko(file, off_t(offset), origin) == 0;
+#endif
+}
+
+// Rozmiar pliku w bajtach (pozycja zostaje na końcu)
+inline uint64_t FileSize(std::FILE *file)
+{
+    if (!SeekFile(file, 0, SEEK_END))
+        return 0;
+#ifdef _WIN32
+    return uint64_t(_ftelli64(file));
+#else
+    return uint64_t(ftello(file));
+#endif
+}
+
+// Liczby o zmiennej długości (7 bitów na bajt) i zigzag dla różnic ze znakiem
+inline void PutVarint(std::vector<unsigned char> &out, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
+}
+
+inline bool GetVarint(const unsigned char *&p, const unsigned char *end, uint64_t &v)
+{
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        unsigned char byte = *p++;
+        v |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline uint64_t ZigZag(int64_t v)
+{
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+inline int64_t UnZigZag(uint64_t v)
+{
+    return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+// Stan kodera wspólny dla zapisu i odczytu: kwantyzowane pozycje dwóch poprzednich klatek do przewidywania
+struct TrajectoryPredictor
+{
+    std::vector<int64_t> q1, q0; // Ostatnia i przedostatnia klatka (x..., y..., z...)
+    int history = 0; // Ile poprzednich klatek jest w q1/q0 (od klatki kluczowej)
+
+    // Przewidywanie liniowe (stała prędkość), a przy jednej klatce historii: bez ruchu
+    int64_t Predict(size_t k) const
+    {
+        return history >= 2 ? 2 * q1[k] - q0[k] : q1[k];
+    }
+
+    void Push(std::vector<int64_t> &q)
+    {
+        q0.swap(q1);
+        q1.swap(q);
+        history = std::min(history + 1, 2);
+    }
+};
+
+// Koduje klatki do bajtów; klatka kluczowa co keyframeInterval klatek albo gdy zmienią się ciała lub wyjdą z prostopadłościanu
+class TrajectoryEncoder
+{
+public:
+    uint32_t bits = 16;
+    uint32_t keyframeInterval = 64;
+
+    void Encode(const TrajectoryFrame &frame, TrajectoryFrameHeader &header, std::vector<unsigned char> &payload)
+    {
+        const BodyStore &b = frame.bodies;
+        const size_t n = b.size();
+        const int64_t qMax = (int64_t(1) << bits) - 1;
+        bool key = !started || sinceKey >= keyframeInterval || n != mass.size() || !SameMeta(frame);
+        std::vector<int64_t> &q = scratch;
+        q.resize(3 * n);
+        if (!key)
+            key = !Quantize(b, q, qMax);
+        if (key)
+        {
+            SetBox(b);
+            Quantize(b, q, qMax);
+        }
+
+        header = TrajectoryFrameHeader{};
+        header.bodyCount = uint32_t(n);
+        header.flags = key ? TrajectoryFrameHeader::kKeyframe : 0;
+        header.time = frame.time;
+        header.stepCount = frame.stepCount;
+        for (int d = 0; d < 3; ++d)
+        {
+            header.origin[d] = origin[d];
+            header.cell[d] = cell[d];
+        }
+        payload.clear();
+        if (key)
+        {
+            StoreMeta(frame);
+            uint64_t last = 0;
+            for (uint64_t id : ids) // Różnice ze znakiem: uchwyty po zlepieniach i ponownym użyciu slotów nie rosną
+            {
+                PutVarint(payload, ZigZag(int64_t(id - last)));
+                last = id;
+            }
+            Append(payload, mass.data(), n * sizeof(float));
+            Append(payload, radius.data(), n * sizeof(float));
+            Append(payload, colors.data(), n * sizeof(uint32_t));
+            Append(payload, glow.data(), n);
+            for (int64_t v : q)
+                PutVarint(payload, uint64_t(v));
+            predictor.history = 0;
+            sinceKey = 0;
+            started = true;
+        }
+        else
+        {
+            for (size_t k = 0; k < q.size(); ++k)
+                PutVarint(payload, ZigZag(q[k] - predictor.Predict(k)));
+        }
+        header.payloadBytes = uint32_t(payload.size());
+        predictor.Push(q);
+        ++sinceKey;
+    }
+
+private:
+    TrajectoryPredictor predictor;
+    std::vector<int64_t> scratch;
+    uint32_t sinceKey = 0;
+    bool started = false; // Pierwsza klatka zawsze kluczowa
+    float origin[3] = {0.0f, 0.0f, 0.0f}, cell[3] = {1.0f, 1.0f, 1.0f};
+    FloatArray mass, radius; // Z ostatniej klatki kluczowej
+    std::vector<uint64_t> ids;
+    std::vector<uint32_t> colors;
+    std::vector<unsigned char> glow;
+
+    static void Append(std::vector<unsigned char> &out, const void *data, size_t bytes)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        out.insert(out.end(), p, p + bytes);
+    }
+
+    // Prostopadłościan ciał z zapasem 25% (mniej klatek kluczowych, gdy układ się rozszerza)
+    void SetBox(const BodyStore &b)
+    {
+        const FloatArray *axes[3] = {&b.x, &b.y, &b.z};
+        const int64_t qMax = (int64_t(1) << bits) - 1;
+        for (int d = 0; d < 3; ++d)
+        {
+            float lo = 0.0f, hi = 0.0f;
+            if (!axes[d]->empty())
+            {
+                auto range = std::minmax_element(axes[d]->begin(), axes[d]->end());
+                lo = *range.first;
+                hi = *range.second;
+            }
+            float margin = std::max(0.25f * (hi - lo), 1.0f);
+            origin[d] = lo - margin;
+            cell[d] = (hi - lo + 2.0f * margin) / float(qMax);
+        }
+    }
+
+    // false, gdy któreś ciało wyszło poza prostopadłościan
+    bool Quantize(const BodyStore &b, std::vector<int64_t> &q, int64_t qMax) const
+    {
+        const FloatArray *axes[3] = {&b.x, &b.y, &b.z};
+        const size_t n = b.size();
+        for (int d = 0; d < 3; ++d)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                int64_t v = std::llround((double((*axes[d])[i]) - origin[d]) / cell[d]);
+                if (v < 0 || v > qMax)
+                    return false;
+                q[d * n + i] = v;
+            }
+        }
+        return true;
+    }
+
+    bool SameMeta(const TrajectoryFrame &frame) const
+    {
+        const size_t n = frame.bodies.size();
+        return std::equal(mass.begin(), mass.end(), frame.bodies.mass.begin()) &&
+               std::equal(radius.begin(), radius.end(), frame.bodies.radius.begin()) &&
+               (frame.ids.empty() || frame.ids == ids) && (frame.colors.empty() || frame.colors == colors) &&
+               (frame.glow.empty() || frame.glow == glow) && ids.size() == n;
+    }
+
+    void StoreMeta(const TrajectoryFrame &frame)
+    {
+        const size_t n = frame.bodies.size();
+        mass = frame.bodies.mass;
+        radius = frame.bodies.radius;
+        ids = frame.ids;
+        if (ids.size() != n)
+        {
+            ids.resize(n);
+            for (size_t i = 0; i < n; ++i)
+                ids[i] = i + 1;
+        }
+        colors = frame.colors;
+        colors.resize(n, 0xFFFFFFFFu);
+        glow = frame.glow;
+        glow.resize(n, 0);
+    }
+};
+
+// Zapis klatek na osobnym wątku. Submit kopiuje stan i wraca; gdy dysk nie nadąża, czeka (żadna klatka nie ginie).
+class TrajectoryRecorder
+{
+public:
+    static const size_t kMaxQueued = 8; // Klatki czekające na zapis
+
+    ~TrajectoryRecorder()
+    {
+        Close();
+    }
+
+    bool Open(const std::string &path, uint32_t stepsPerFrame, float dt, uint32_t bits = 16)
+    {
+        Close();
+        file = std::fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        TrajectoryFileHeader header = {};
+        std::memcpy(header.magic, "PHYSTRAJ", 8);
+        header.version = TrajectoryFileHeader::kVersion;
+        header.bits = std::min(std::max(bits, 8u), 31u);
+        header.stepsPerFrame = stepsPerFrame;
+        header.keyframeInterval = encoder.keyframeInterval;
+        header.dt = dt;
+        encoder.bits = header.bits;
+        ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        this->path = path;
+        frames = 0;
+        bytes = sizeof(header);
+        rawBytes = 0;
+        stop = false;
+        thread = std::thread([this]
+                             { Loop(); });
+        return ok;
+    }
+
+    void Submit(TrajectoryFrame &&frame)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [this]
+                   { return queue.size() < kMaxQueued; });
+        queue.push_back(std::move(frame));
+        wake.notify_all();
+    }
+
+    // Zapisuje zaległe klatki i zamyka plik; zwraca, czy wszystko się zapisało
+    bool Close()
+    {
+        if (!thread.joinable())
+            return ok;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        thread.join();
+        ok = (std::fclose(file) == 0) && ok;
+        file = nullptr;
+        if (ok)
+            LOG_INFO(General, "trajectory %s: %lld frames, %.1f MB (%.1fx smaller than raw positions)", path.c_str(), frames,
+                     bytes / 1e6, bytes > 0 ? double(rawBytes) / bytes : 0.0);
+        else
+            LOG_ERROR(General, "cannot write trajectory %s", path.c_str());
+        return ok;
+    }
+
+private:
+    TrajectoryEncoder encoder;
+    std::FILE *file = nullptr;
+    std::string path;
+    bool ok = true;
+    long long frames = 0;
+    uint64_t bytes = 0, rawBytes = 0;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake, space;
+    std::deque<TrajectoryFrame> queue;
+    bool stop = false;
+
+    void Loop()
+    {
+        TrajectoryFrame frame;
+        TrajectoryFrameHeader header;
+        std::vector<unsigned char> payload;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]
+                          { return !queue.empty() || stop; });
+                if (queue.empty())
+                    return;
+                frame = std::move(queue.front());
+                queue.pop_front();
+            }
+            space.notify_all();
+            encoder.Encode(frame, header, payload);
+            ok = ok && std::fwrite(&header, sizeof(header), 1, file) == 1;
+            ok = ok && (payload.empty() || std::fwrite(payload.data(), 1, payload.size(), file) == payload.size());
+            ++frames;
+            bytes += sizeof(header) + payload.size();
+            rawBytes += sizeof(header) + 3 * sizeof(float) * frame.bodies.size();
+        }
+    }
+};
+
+// Odczyt nagranej trajektorii: indeks klatek przy otwarciu, dekodowanie od najbliższej klatki kluczowej przy skoku
+class TrajectoryPlayer
+{
+public:
+    ~TrajectoryPlayer()
+    {
+        if (file)
+            std::fclose(file);
+    }
+
+    bool Open(const std::string &path, std::string &error)
+    {
+        file = std::fopen(path.c_str(), "rb");
+        if (!file)
+        {
+            error = "cannot open " + path;
+            return false;
+        }
+        if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, "PHYSTRAJ", 8) != 0)
+            error = "not a trajectory file";
+        else if (header.version != TrajectoryFileHeader::kVersion)
+            error = "unsupported trajectory version " + std::to_string(header.version);
+        const uint64_t fileBytes = FileSize(file);
+        uint64_t offset = sizeof(header);
+        TrajectoryFrameHeader frame;
+        // Urwana ostatnia klatka (np. przerwany zapis) jest pomijana: fseek za koniec pliku się udaje, więc liczy się rozmiar
+        while (error.empty() && SeekFile(file, offset, SEEK_SET) && std::fread(&frame, sizeof(frame), 1, file) == 1)
+        {
+            bool key = (frame.flags & TrajectoryFrameHeader::kKeyframe) != 0;
+            if (index.empty() && !key)
+                error = "trajectory does not start with a keyframe";
+            else if (offset + sizeof(frame) + frame.payloadBytes > fileBytes)
+                break;
+            index.push_back(Entry{offset, key});
+            offset += sizeof(frame) + frame.payloadBytes;
+        }
+        if (error.empty() && index.empty())
+            error = "empty trajectory";
+        return error.empty();
+    }
+
+    size_t size() const
+    {
+        return index.size();
+    }
+
+    const TrajectoryFileHeader &Header() const
+    {
+        return header;
+    }
+
+    // Klatka f; kolejne klatki dekodowane przyrostowo, skok od klatki kluczowej (najwyżej keyframeInterval klatek)
+    const TrajectoryFrame &Frame(size_t f)
+    {
+        f = std::min(f, index.size() - 1);
+        if (decoded != kNone && decoded > 0 && f == decoded - 1)
+            return previous;
+        DecodeTo(f);
+        return current;
+    }
+
+    // Stan na ułamkowej pozycji cursor (w klatkach): pozycje interpolowane liniowo, gdy obie klatki mają te same ciała.
+    // Para klatek f, f + 1 to zawsze previous i current (decoded = f + 1), także przy odtwarzaniu wstecz.
+    const TrajectoryFrame &Sample(double cursor, BodyStore &out)
+    {
+        const size_t last = index.size() - 1;
+        cursor = std::min(std::max(cursor, 0.0), double(last));
+        size_t f = size_t(cursor);
+        if (f >= last) // Ostatnia klatka: bez następnej
+        {
+            const TrajectoryFrame &a = Frame(last);
+            out = a.bodies;
+            return a;
+        }
+        DecodeTo(f + 1);
+        const TrajectoryFrame &a = previous, &b = current;
+        out = a.bodies;
+        float t = float(cursor - double(f));
+        if (t > 0.0f && a.ids == b.ids)
+        {
+            for (size_t i = 0; i < out.size(); ++i)
+            {
+                out.x[i] += (b.bodies.x[i] - a.bodies.x[i]) * t;
+                out.y[i] += (b.bodies.y[i] - a.bodies.y[i]) * t;
+                out.z[i] += (b.bodies.z[i] - a.bodies.z[i]) * t;
+            }
+        }
+        return a;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t offset;
+        bool key;
+    };
+
+    static const size_t kNone = ~size_t(0);
+
+    std::FILE *file = nullptr;
+    TrajectoryFileHeader header = {};
+    std::vector<Entry> index;
+    TrajectoryPredictor predictor;
+    TrajectoryFrame current, previous; // Klatki decoded i decoded - 1
+    size_t decoded = kNone;
+    std::vector<unsigned char> payload;
+    std::vector<int64_t> q;
+
+    // Dekoduje tak, żeby decoded = f, a previous zawierało klatkę f - 1
+    void DecodeTo(size_t f)
+    {
+        if (decoded != kNone && f == decoded)
+            return;
+        size_t from;
+        if (decoded != kNone && f > decoded && f - decoded <= header.keyframeInterval)
+            from = decoded + 1; // Dalej od bieżącej klatki
+        else
+        {
+            from = f > 0 ? f - 1 : 0; // Od klatki kluczowej przed f - 1, żeby poprzednia klatka też była gotowa
+            while (!index[from].key)
+                --from;
+        }
+        for (size_t k = from; k <= f; ++k)
+            DecodeNext(k);
+    }
+
+    void DecodeNext(size_t f)
+    {
+        TrajectoryFrameHeader frame;
+        if (!SeekFile(file, index[f].offset, SEEK_SET) || std::fread(&frame, sizeof(frame), 1, file) != 1)
+        {
+            LOG_ERROR(General, "cannot read trajectory frame %zu", f); // Klatka f jak f - 1: bez nagłówka nie ma z czego dekodować
+            previous = current;
+            decoded = f;
+            return;
+        }
+        payload.resize(frame.payloadBytes);
+        bool ok = (payload.empty() || std::fread(payload.data(), 1, payload.size(), file) == payload.size());
+        const unsigned char *p = payload.data(), *end = p + payload.size();
+        const size_t n = frame.bodyCount;
+        const bool key = index[f].key;
+
+        std::swap(previous.bodies, current.bodies);
+        previous.ids.swap(current.ids);
+        previous.colors.swap(current.colors);
+        previous.glow.swap(current.glow);
+        std::swap(previous.time, current.time);
+        std::swap(previous.stepCount, current.stepCount);
+        if (key)
+        {
+            current.bodies.resize(n);
+            current.ids.resize(n);
+            uint64_t id = 0, delta = 0;
+            for (size_t i = 0; i < n && ok; ++i)
+            {
+                ok = GetVarint(p, end, delta);
+                current.ids[i] = id += uint64_t(UnZigZag(delta));
+            }
+            current.colors.resize(n);
+            current.glow.resize(n);
+            ok = ok && size_t(end - p) >= n * (2 * sizeof(float) + sizeof(uint32_t) + 1);
+            if (ok)
+            {
+                std::memcpy(current.bodies.mass.data(), p, n * sizeof(float));
+                std::memcpy(current.bodies.radius.data(), p + n * sizeof(float), n * sizeof(float));
+                std::memcpy(current.colors.data(), p + 2 * n * sizeof(float), n * sizeof(uint32_t));
+                std::memcpy(current.glow.data(), p + n * (2 * sizeof(float) + sizeof(uint32_t)), n);
+                p += n * (2 * sizeof(float) + sizeof(uint32_t) + 1);
+            }
+            predictor.history = 0;
+        }
+        else // Ciała i wygląd jak w poprzedniej klatce
+        {
+            current.bodies = previous.bodies;
+            current.ids = previous.ids;
+            current.colors = previous.colors;
+            current.glow = previous.glow;
+        }
+        q.resize(3 * n);
+        for (size_t k = 0; k < q.size() && ok; ++k)
+        {
+            uint64_t v = 0;
+            ok = GetVarint(p, end, v);
+            q[k] = key ? int64_t(v) : predictor.Predict(k) + UnZigZag(v);
+        }
+        if (!ok)
+        {
+            LOG_ERROR(General, "corrupt trajectory frame %zu", f);
+            std::fill(q.begin(), q.end(), 0);
+        }
+        FloatArray *axes[3] = {&current.bodies.x, &current.bodies.y, &current.bodies.z};
+        for (int d = 0; d < 3; ++d)
+        {
+            for (size_t i = 0; i < n; ++i)
+                (*axes[d])[i] = float(frame.origin[d] + double(q[d * n + i]) * frame.cell[d]);
+        }
+        current.time = frame.time;
+        current.stepCount = frame.stepCount;
+        predictor.Push(q);
+        decoded = f;
+    }
+};
@@ -0,0 +1,80 @@
+// Test odtwarzania trajektorii: Sample w przód i wstecz musi interpolować między klatkami f i f + 1
+#include <cstdio> // std::printf, std::fprintf, std::remove
+#include <cmath> // std::fabs
+#include <string> // std::string
+#include <filesystem> // std::filesystem::resize_file: urwany zapis
+
+#include "trajectory.h" // TrajectoryRecorder, TrajectoryPlayer
+
+int main()
+{
+    const char *path = "trajectory_test.traj";
+    const int frames = 200; // Kilka klatek kluczowych (co 64)
+    {
+        TrajectoryRecorder recorder;
+        if (!recorder.Open(path, 1, 1.0f))
+        {
+            std::fprintf(stderr, "cannot write %s\n", path);
+            return 1;
+        }
+        for (int f = 0; f < frames; ++f) // Ciało 0: x = 100 f, ciało 1: x = -100 f
+        {
+            TrajectoryFrame frame;
+            frame.bodies.Add(Body(100.0f * f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1e20f));
+            frame.bodies.Add(Body(-100.0f * f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1e20f));
+            frame.ids = {1, 2};
+            frame.stepCount = f;
+            recorder.Submit(std::move(frame));
+        }
+        if (!recorder.Close())
+            return 1;
+    }
+
+    TrajectoryPlayer player;
+    std::string error;
+    if (!player.Open(path, error))
+    {
+        std::fprintf(stderr, "cannot read %s: %s\n", path, error.c_str());
+        return 1;
+    }
+    int failures = 0;
+    BodyStore out;
+    auto check = [&](double cursor, const char *direction)
+    {
+        const TrajectoryFrame &frame = player.Sample(cursor, out);
+        double expected = 100.0 * cursor;
+        if (std::fabs(out.x[0] - expected) > 1.0 || std::fabs(out.x[1] + expected) > 1.0 || frame.stepCount != (long long)cursor)
+        {
+            std::fprintf(stderr, "%s cursor %.2f: x %g, %g (expected %g), frame step %lld\n", direction, cursor, out.x[0], out.x[1],
+                         expected, frame.stepCount);
+            ++failures;
+        }
+    };
+    for (double cursor = 0.0; cursor <= frames - 1; cursor += 0.25) // W przód, po ćwierć klatki
+        check(cursor, "forward");
+    for (double cursor = frames - 1; cursor >= 0.0; cursor -= 0.25) // Wstecz
+        check(cursor, "backward");
+    for (double cursor : {150.5, 11.5, 9.5, 180.75, 63.5, 64.5, 0.5}) // Skoki, także przez klatki kluczowe
+        check(cursor, "seek");
+
+    // Urwana ostatnia klatka (np. przerwany zapis): pominięta przy otwarciu, ostatnią jest poprzednia cała klatka
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    TrajectoryPlayer truncated;
+    if (!truncated.Open(path, error) || truncated.size() != size_t(frames - 1))
+    {
+        std::fprintf(stderr, "truncated: %zu frames (expected %d) %s\n", truncated.size(), frames - 1, error.c_str());
+        ++failures;
+    }
+    else
+    {
+        const TrajectoryFrame &last = truncated.Sample(double(frames), out); // Kursor za końcem: ostatnia klatka
+        if (last.stepCount != frames - 2 || std::fabs(out.x[0] - 100.0 * (frames - 2)) > 1.0)
+        {
+            std::fprintf(stderr, "truncated: last frame step %lld, x %g\n", last.stepCount, out.x[0]);
+            ++failures;
+        }
+    }
+    std::remove(path);
+    std::printf("trajectory_test: %d failure(s)\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+// Potrójny bufor bez blokad: jeden pisarz, jeden czytelnik, czytelnik zawsze dostaje najnowszy opublikowany stan
+#pragma once
+
+#include <atomic> // std::atomic
+
+// Trzy egzemplarze T: tylny (pisarz), środkowy (ostatnio opublikowany), przedni (czytelnik).
+// Publikacja i odbiór to jedna wymiana atomowa indeksu środkowego; nikt nigdy nie czeka.
+// Stany opublikowane, których czytelnik nie zdążył odebrać, są nadpisywane (liczy się tylko najnowszy).
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Egzemplarz do wypełnienia przez pisarza
+    T &Back()
+    {
+        return slots[back];
+    }
+
+    // Oddaje tylny egzemplarz czytelnikowi i bierze w zamian środkowy
+    void Publish()
+    {
+        back = middle.exchange(back | kFresh, std::memory_order_acq_rel) & kIndex;
+    }
+
+    // Jeśli jest nowy stan, zamienia go z przednim; zwraca true, gdy przedni się zmienił
+    bool Acquire()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & kFresh))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & kIndex;
+        return true;
+    }
+
+    // Egzemplarz czytany przez czytelnika (ważny do następnego Acquire)
+    const T &Front() const
+    {
+        return slots[front];
+    }
+
+private:
+    static const unsigned kIndex = 3; // Bity indeksu w middle
+    static const unsigned kFresh = 4; // Bit "nieodebrany stan" w middle
+
+    T slots[3];
+    unsigned back = 0; // Tylko pisarz
+    unsigned front = 1; // Tylko czytelnik
+    std::atomic<unsigned> middle{2};
+};